@@ -0,0 +1,143 @@
+#pragma once
+// Audio output abstraction: the mixer writes its output to an AudioSink
+
+#include <climits>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "WaveFile.h"
+
+/*
+    Offline sinks (files, memory, ...) can take any amount of data at any
+    time, they return this value from getFramesWritable().
+*/
+const unsigned AUDIOSINK_UNLIMITED = UINT_MAX;
+
+/*
+    An AudioSink receives interleaved 32 bit float sample frames in the range
+    -1.0 .. +1.0 from the mixer. The mixer does not own its sink, the caller
+    is responsible for keeping it alive while the mixer uses it. All state
+    lives in the sink object itself, so several mixers can each write to
+    their own sink in the same process.
+
+    The mixer passes its block size (in frames) and the nr of blocks that a
+    real time sink should buffer when it opens the sink. Offline sinks 
+    ignore these.
+
+    All functions that can fail return 0 on success and -1 on error.
+*/
+class AudioSink {
+public:
+    virtual ~AudioSink() {}
+
+    virtual int         open( 
+        unsigned mixRate,
+        unsigned nrChannels,
+        unsigned framesPerBlock,
+        unsigned blockCount ) = 0;
+    virtual int         close() = 0;
+
+    /*
+        The nr of frames that can be written right now without blocking.
+        Real time sinks return the free space in their output queue.
+    */
+    virtual unsigned    getFramesWritable() = 0;
+    virtual int         write( const float* buffer,unsigned nrFrames ) = 0;
+};
+
+/*
+    Discards everything, but keeps count. Useful for benchmarking the mixer.
+*/
+class NullSink : public AudioSink {
+public:
+    int             open( 
+        unsigned /*mixRate*/,
+        unsigned /*nrChannels*/,
+        unsigned /*framesPerBlock*/,
+        unsigned /*blockCount*/ ) override
+    {
+        framesWritten_ = 0;
+        return 0;
+    }
+    int             close() override { return 0; }
+    unsigned        getFramesWritable() override { return AUDIOSINK_UNLIMITED; }
+    int             write( const float* /*buffer*/,unsigned nrFrames ) override
+    {
+        framesWritten_ += nrFrames;
+        return 0;
+    }
+    std::uint64_t   getFramesWritten() const { return framesWritten_; }
+
+private:
+    std::uint64_t   framesWritten_ = 0;
+};
+
+/*
+    Collects the rendered audio in memory, e.g. for comparing the output of
+    two mixers.
+*/
+class MemorySink : public AudioSink {
+public:
+    int             open( 
+        unsigned mixRate,
+        unsigned nrChannels,
+        unsigned /*framesPerBlock*/,
+        unsigned /*blockCount*/ ) override
+    {
+        mixRate_ = mixRate;
+        nrChannels_ = nrChannels;
+        buffer_.clear();
+        return 0;
+    }
+    int             close() override { return 0; }
+    unsigned        getFramesWritable() override { return AUDIOSINK_UNLIMITED; }
+    int             write( const float* buffer,unsigned nrFrames ) override
+    {
+        buffer_.insert( buffer_.end(),buffer,buffer + nrFrames * nrChannels_ );
+        return 0;
+    }
+    const std::vector< float >& getBuffer() const { return buffer_; }
+    std::uint64_t   getFramesWritten() const
+    {
+        return nrChannels_ ? buffer_.size() / nrChannels_ : 0;
+    }
+    unsigned        getMixRate() const { return mixRate_; }
+
+private:
+    unsigned        mixRate_ = 0;
+    unsigned        nrChannels_ = 0;
+    std::vector< float > buffer_;
+};
+
+/*
+    Writes the audio to a .wav file, see WaveFile.h for the sample formats.
+*/
+class WaveFileSink : public AudioSink {
+public:
+    WaveFileSink( const std::string& fileName,int sampleFormat ) :
+        fileName_( fileName ),
+        sampleFormat_( sampleFormat )
+    {}
+
+    int             open( 
+        unsigned mixRate,
+        unsigned nrChannels,
+        unsigned /*framesPerBlock*/,
+        unsigned /*blockCount*/ ) override
+    {
+        return waveFile_.open( fileName_,mixRate,nrChannels,sampleFormat_ );
+    }
+    int             close() override { return waveFile_.close(); }
+    unsigned        getFramesWritable() override { return AUDIOSINK_UNLIMITED; }
+    int             write( const float* buffer,unsigned nrFrames ) override
+    {
+        return waveFile_.write( buffer,nrFrames );
+    }
+    std::uint64_t   getFramesWritten() const { return waveFile_.getFramesWritten(); }
+
+private:
+    std::string     fileName_;
+    int             sampleFormat_;
+    WaveFile        waveFile_;
+};
@@ -0,0 +1,365 @@
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <algorithm>
+#include <numeric>
+#include <thread>
+#include <cctype>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#include <dirent.h>
+#endif
+
+#include "Module.h"
+#include "AudioSink.h"
+#include "BatchRenderer.h"
+
+namespace BatchRendererHelperFn {
+    /*
+        Returns 1 for a directory, 0 for a file, -1 if the path does not
+        exist
+    */
+    int getPathType( const std::string& path )
+    {
+#ifdef _WIN32
+        DWORD attributes = GetFileAttributesA( path.c_str() );
+        if ( attributes == INVALID_FILE_ATTRIBUTES )
+            return -1;
+        return (attributes & FILE_ATTRIBUTE_DIRECTORY) ? 1 : 0;
+#else
+        struct stat pathStat;
+        if ( stat( path.c_str(),&pathStat ) != 0 )
+            return -1;
+        return S_ISDIR( pathStat.st_mode ) ? 1 : 0;
+#endif
+    }
+
+    std::uintmax_t getFileSize( const std::string& fileName )
+    {
+        std::ifstream file( fileName,std::ios::binary | std::ios::ate );
+        if ( !file.is_open() )
+            return 0;
+        return (std::uintmax_t)file.tellg();
+    }
+
+    bool isModuleFileName( const std::string& fileName )
+    {
+        const char* extensions[] = { "mod","s3m","xm","it","wow" };
+        std::size_t dotPos = fileName.find_last_of( '.' );
+        if ( dotPos == std::string::npos )
+            return false;
+        std::string extension = fileName.substr( dotPos + 1 );
+        for ( char& c : extension )
+            c = (char)std::tolower( (unsigned char)c );
+        for ( const char* moduleExtension : extensions )
+            if ( extension == moduleExtension )
+                return true;
+        return false;
+    }
+
+    /*
+        The names of the files and subdirectories in a directory, without
+        "." and "..", sorted so that the order of a batch does not depend
+        on the file system. Returns 0 on success, -1 on error.
+    */
+    int listDirectory( const std::string& dirName,std::vector< std::string >& entryNames )
+    {
+        entryNames.clear();
+#ifdef _WIN32
+        WIN32_FIND_DATAA findData;
+        HANDLE findHandle = FindFirstFileA( (dirName + "\\*").c_str(),&findData );
+        if ( findHandle == INVALID_HANDLE_VALUE )
+            return -1;
+        do {
+            entryNames.push_back( findData.cFileName );
+        } while ( FindNextFileA( findHandle,&findData ) );
+        FindClose( findHandle );
+#else
+        DIR* dir = opendir( dirName.c_str() );
+        if ( dir == nullptr )
+            return -1;
+        for ( struct dirent* entry = readdir( dir ); entry != nullptr; entry = readdir( dir ) )
+            entryNames.push_back( entry->d_name );
+        closedir( dir );
+#endif
+        entryNames.erase(
+            std::remove_if( entryNames.begin(),entryNames.end(),
+                []( const std::string& name ) { return name == "." || name == ".."; } ),
+            entryNames.end() );
+        std::sort( entryNames.begin(),entryNames.end() );
+        return 0;
+    }
+}
+
+int BatchRenderer::setNrWorkers( unsigned nrWorkers )
+{
+    if ( (nrWorkers < 1) || (nrWorkers > BATCH_MAX_WORKERS) ) {
+        std::cout << "\nInvalid nr of batch workers: " << nrWorkers << "\n";
+        return -1;
+    }
+    nrWorkers_ = nrWorkers;
+    return 0;
+}
+
+int BatchRenderer::addPath( const std::string& path )
+{
+    using namespace BatchRendererHelperFn;
+    int pathType = getPathType( path );
+    if ( pathType < 0 ) {
+        std::cout << "\nUnable to find " << path << "\n";
+        return -1;
+    }
+    if ( pathType == 0 ) {
+        BatchRenderResult result;
+        result.fileName = path;
+        result.fileSize = getFileSize( path );
+        results_.push_back( result );
+        return 0;
+    }
+    std::vector< std::string > entryNames;
+    if ( listDirectory( path,entryNames ) ) {
+        std::cout << "\nUnable to read directory " << path << "\n";
+        return -1;
+    }
+#ifdef _WIN32
+    const char separator = '\\';
+#else
+    const char separator = '/';
+#endif
+    std::string dirName( path );
+    if ( (dirName.back() != '/') && (dirName.back() != separator) )
+        dirName += separator;
+    for ( const std::string& entryName : entryNames ) {
+        std::string entryPath = dirName + entryName;
+        int entryType = getPathType( entryPath );
+        if ( (entryType == 1) || ((entryType == 0) && isModuleFileName( entryName )) )
+            if ( addPath( entryPath ) )
+                return -1;
+    }
+    return 0;
+}
+
+int BatchRenderer::addFileList( const std::string& listFileName )
+{
+    std::ifstream listFile( listFileName );
+    if ( !listFile.is_open() ) {
+        std::cout << "\nUnable to read file list " << listFileName << "\n";
+        return -1;
+    }
+    std::string line;
+    while ( std::getline( listFile,line ) ) {
+        while ( !line.empty() && std::isspace( (unsigned char)line.back() ) )
+            line.pop_back();
+        if ( line.empty() )
+            continue;
+        if ( addPath( line ) )
+            return -1;
+    }
+    return 0;
+}
+
+int BatchRenderer::run()
+{
+    if ( results_.empty() ) {
+        std::cout << "\nNo module files to render\n";
+        return -1;
+    }
+    unsigned nrWorkers = (unsigned)std::min( (std::size_t)nrWorkers_,results_.size() );
+    nrFreeSlots_ = maxModulesInFlight_ ? maxModulesInFlight_ : nrWorkers;
+    nrModulesInFlight_ = 0;
+    peakModulesInFlight_ = 0;
+    nrFilesDone_ = 0;
+
+    // largest files first, so that no worker starts a big one at the end:
+    std::vector< std::size_t > taskNrs( results_.size() );
+    std::iota( taskNrs.begin(),taskNrs.end(),(std::size_t)0 );
+    std::stable_sort( taskNrs.begin(),taskNrs.end(),
+        [this]( std::size_t a,std::size_t b )
+            { return results_[a].fileSize > results_[b].fileSize; } );
+    workQueues_.clear();
+    for ( unsigned workerNr = 0; workerNr < nrWorkers; workerNr++ )
+        workQueues_.push_back( std::unique_ptr< WorkQueue >( new WorkQueue ) );
+    for ( std::size_t i = 0; i < taskNrs.size(); i++ )
+        workQueues_[i % nrWorkers]->taskNrs.push_back( taskNrs[i] );
+
+    std::cout
+        << "\nRendering " << results_.size() << " files on " << nrWorkers
+        << " workers, at most " << std::min( nrFreeSlots_,nrWorkers )
+        << " modules in memory\n";
+    auto startTime = std::chrono::steady_clock::now();
+    std::vector< std::thread > threads;
+    for ( unsigned workerNr = 1; workerNr < nrWorkers; workerNr++ )
+        threads.push_back( std::thread( &BatchRenderer::workerLoop,this,workerNr ) );
+    workerLoop( 0 );
+    for ( std::thread& thread : threads )
+        thread.join();
+    auto stopTime = std::chrono::steady_clock::now();
+    workQueues_.clear();
+
+    printSummary( std::chrono::duration< double >( stopTime - startTime ).count(),nrWorkers );
+    for ( const BatchRenderResult& result : results_ )
+        if ( !result.isRendered )
+            return -1;
+    return 0;
+}
+
+void BatchRenderer::workerLoop( unsigned workerNr )
+{
+    std::size_t taskNr;
+    while ( getTask( workerNr,taskNr ) )
+        renderFile( workerNr,taskNr );
+}
+
+/*
+    No tasks are added while the workers run, so once every queue is empty
+    the worker is done.
+*/
+bool BatchRenderer::getTask( unsigned workerNr,std::size_t& taskNr )
+{
+    {
+        WorkQueue& ownQueue = *workQueues_[workerNr];
+        std::lock_guard< std::mutex > lock( ownQueue.mutex );
+        if ( !ownQueue.taskNrs.empty() ) {
+            taskNr = ownQueue.taskNrs.front();
+            ownQueue.taskNrs.pop_front();
+            return true;
+        }
+    }
+    unsigned nrQueues = (unsigned)workQueues_.size();
+    for ( unsigned i = 1; i < nrQueues; i++ ) {
+        WorkQueue& victimQueue = *workQueues_[(workerNr + i) % nrQueues];
+        std::lock_guard< std::mutex > lock( victimQueue.mutex );
+        if ( !victimQueue.taskNrs.empty() ) {
+            taskNr = victimQueue.taskNrs.back();
+            victimQueue.taskNrs.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
+
+void BatchRenderer::renderFile( unsigned workerNr,std::size_t taskNr )
+{
+    BatchRenderResult& result = results_[taskNr];
+    result.workerNr = workerNr;
+    acquireSlot();
+    {
+        auto startTime = std::chrono::steady_clock::now();
+        Module  module;
+        std::string fileName( result.fileName );
+        module.loadFile( fileName );
+        auto loadedTime = std::chrono::steady_clock::now();
+        result.loadTime = std::chrono::duration< double >( loadedTime - startTime ).count();
+        if ( module.isLoaded() ) {
+            Mixer   mixer;
+            WaveFileSink waveFileSink( result.fileName + ".wav",settings_.waveSampleFormat );
+            if ( configureMixer( mixer ) == 0 ) {
+                mixer.setAudioSink( &waveFileSink );
+                mixer.assignModule( &module );
+                result.isRendered = (mixer.renderSong() == 0);
+                mixer.setAudioSink( nullptr );
+                result.songTime =
+                    (double)waveFileSink.getFramesWritten() / (double)mixer.getMixRate();
+            }
+            auto stopTime = std::chrono::steady_clock::now();
+            result.renderTime = std::chrono::duration< double >( stopTime - loadedTime ).count();
+        }
+    }
+    releaseSlot();
+    printResult( result );
+}
+
+/*
+    The settings were checked on the mixer of main() already, so this
+    should not fail
+*/
+int BatchRenderer::configureMixer( Mixer& mixer ) const
+{
+    mixer.setLatencyProfile( settings_.latencyProfile );
+    if ( settings_.blockSize && mixer.setBlockSize( settings_.blockSize ) )
+        return -1;
+    if ( mixer.setMixRate( settings_.mixRate ) )
+        return -1;
+    mixer.setInterpolationType( settings_.interpolationType );
+    if ( mixer.setIsa( settings_.isa ) )
+        return -1;
+    if ( mixer.setMaxVoices( settings_.maxVoices ) )
+        return -1;
+    mixer.setVoiceStealingPolicy( settings_.voiceStealingPolicy );
+    mixer.setFloatSampleData( settings_.useFloatSampleData );
+    return mixer.setNrThreads( settings_.nrMixerThreads );
+}
+
+void BatchRenderer::acquireSlot()
+{
+    std::unique_lock< std::mutex > lock( slotMutex_ );
+    slotIsFree_.wait( lock,[this] { return nrFreeSlots_ > 0; } );
+    nrFreeSlots_--;
+    nrModulesInFlight_++;
+    peakModulesInFlight_ = std::max( peakModulesInFlight_,nrModulesInFlight_ );
+}
+
+void BatchRenderer::releaseSlot()
+{
+    {
+        std::lock_guard< std::mutex > lock( slotMutex_ );
+        nrFreeSlots_++;
+        nrModulesInFlight_--;
+    }
+    slotIsFree_.notify_one();
+}
+
+void BatchRenderer::printResult( const BatchRenderResult& result )
+{
+    std::lock_guard< std::mutex > lock( printMutex_ );
+    nrFilesDone_++;
+    std::cout
+        << "\n[" << nrFilesDone_ << "/" << results_.size() << "] "
+        << result.fileName << ": ";
+    if ( !result.isRendered ) {
+        std::cout << "Error!";
+        return;
+    }
+    double taskTime = result.loadTime + result.renderTime;
+    std::cout
+        << std::fixed << std::setprecision( 2 ) << result.songTime << " s in "
+        << taskTime << " s ("
+        << (taskTime > 0.0 ? result.songTime / taskTime : 0.0)
+        << "x real time), worker " << result.workerNr << std::defaultfloat;
+}
+
+/*
+    The real time factor of the batch is the song time of all files over
+    the wall clock time. The sum of the task times over the wall clock
+    time tells how busy the workers were.
+*/
+void BatchRenderer::printSummary( double wallTime,unsigned nrWorkers ) const
+{
+    std::size_t nrRendered = 0;
+    double songTime = 0.0;
+    double loadTime = 0.0;
+    double renderTime = 0.0;
+    for ( const BatchRenderResult& result : results_ ) {
+        if ( result.isRendered )
+            nrRendered++;
+        songTime += result.songTime;
+        loadTime += result.loadTime;
+        renderTime += result.renderTime;
+    }
+    std::cout
+        << "\n\nRendered " << nrRendered << " of " << results_.size() << " files, "
+        << std::fixed << std::setprecision( 2 ) << songTime << " s of audio in "
+        << wallTime << " s (" << (wallTime > 0.0 ? songTime / wallTime : 0.0)
+        << "x real time)"
+        << "\nLoading took " << loadTime << " s, rendering " << renderTime
+        << " s, the workers were busy " << (wallTime > 0.0 ?
+            (loadTime + renderTime) / wallTime : 0.0)
+        << " of " << nrWorkers << " workers on average"
+        << "\nPeak nr of modules in memory: " << peakModulesInFlight_
+        << "\n" << std::defaultfloat;
+}
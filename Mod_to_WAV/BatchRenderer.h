@@ -0,0 +1,132 @@
+#pragma once
+// Renders many modules to .wav files at the same time, for catalog conversion
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "Mixer.h"
+#include "WaveFile.h"
+
+/*
+    Every file is a task with a Module and a Mixer of its own, that loads
+    the file, renders it to <file>.wav and frees both again. The tasks are
+    dealt out to the workers largest file first, each worker takes the
+    tasks from the front of its own queue and, when that is empty, steals
+    from the back of the queue of another worker.
+
+    A task needs a slot before it loads its module and gives it back after
+    the module is freed, so no more than the nr of slots of modules are in
+    memory at any time, whatever the nr of workers. A module that does
+    not load, or a .wav file that can not be written, fails the task but
+    not the batch.
+*/
+const unsigned BATCH_MAX_WORKERS = 64;
+
+/*
+    The mixer settings of every task, see the set functions of the Mixer
+*/
+struct BatchRenderSettings {
+    int             latencyProfile = MXR_LATENCY_BATCH;
+    unsigned        blockSize = 0;              // 0: that of the latency profile
+    unsigned        mixRate = MXR_DEFAULT_MIXRATE;
+    int             interpolationType = MXR_CUBIC_INTERPOLATION;
+    int             isa = cpuGetSupportedIsa();    // see cpuSelectIsa()
+    unsigned        maxVoices = MXR_MAX_PHYSICAL_CHANNELS;
+    int             voiceStealingPolicy = MXR_STEAL_BACKGROUND_FIRST;
+    bool            useFloatSampleData = false;
+    unsigned        nrMixerThreads = 1;
+    int             waveSampleFormat = WAV_SAMPLE_FORMAT_FLOAT32;
+};
+
+/*
+    Times in seconds. The real time factor of a file is its song time
+    divided by its load and render time.
+*/
+struct BatchRenderResult {
+    std::string     fileName;
+    std::uintmax_t  fileSize = 0;
+    bool            isRendered = false;
+    unsigned        workerNr = 0;
+    double          songTime = 0.0;
+    double          loadTime = 0.0;
+    double          renderTime = 0.0;
+};
+
+class BatchRenderer {
+public:
+    BatchRenderer( const BatchRenderSettings& settings ) : settings_( settings ) {}
+
+    /*
+        1 .. BATCH_MAX_WORKERS workers, 1 by default. Returns 0 on
+        success, -1 if the nr is out of range.
+    */
+    int             setNrWorkers( unsigned nrWorkers );
+    unsigned        getNrWorkers() const { return nrWorkers_; }
+
+    /*
+        Max nr of modules that are loaded at the same time, 0 for as many
+        as there are workers (the default).
+    */
+    void            setMaxModulesInFlight( unsigned maxModulesInFlight )
+                    { maxModulesInFlight_ = maxModulesInFlight; }
+
+    /*
+        Adds a module file, or all module files (.mod, .s3m, .xm, .it,
+        .wow) in a directory and its subdirectories. Returns 0 on success,
+        -1 if the path does not exist.
+    */
+    int             addPath( const std::string& path );
+
+    /*
+        Adds the paths in a text file, one per line. Returns 0 on success,
+        -1 if the list or a path in it could not be read.
+    */
+    int             addFileList( const std::string& listFileName );
+    std::size_t     getNrFiles() const { return results_.size(); }
+
+    /*
+        Renders all files, prints a line for every file that is done and a
+        summary at the end. Returns 0 if every file was rendered, -1 if not.
+    */
+    int             run();
+    const std::vector< BatchRenderResult >& getResults() const { return results_; }
+
+private:
+    /*
+        The queue of a worker, the mutex is needed for the thieves
+    */
+    struct WorkQueue {
+        std::mutex                  mutex;
+        std::deque< std::size_t >   taskNrs;
+    };
+
+    void            workerLoop( unsigned workerNr );
+    bool            getTask( unsigned workerNr,std::size_t& taskNr );
+    void            renderFile( unsigned workerNr,std::size_t taskNr );
+    int             configureMixer( Mixer& mixer ) const;
+    void            acquireSlot();
+    void            releaseSlot();
+    void            printResult( const BatchRenderResult& result );
+    void            printSummary( double wallTime,unsigned nrWorkers ) const;
+
+private:
+    BatchRenderSettings settings_;
+    unsigned        nrWorkers_ = 1;
+    unsigned        maxModulesInFlight_ = 0;
+    std::vector< BatchRenderResult > results_;
+    std::vector< std::unique_ptr< WorkQueue > > workQueues_;
+
+    std::mutex      slotMutex_;
+    std::condition_variable slotIsFree_;
+    unsigned        nrFreeSlots_ = 0;
+    unsigned        nrModulesInFlight_ = 0;
+    unsigned        peakModulesInFlight_ = 0;
+
+    std::mutex      printMutex_;
+    std::size_t     nrFilesDone_ = 0;
+};
@@ -0,0 +1,1651 @@
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <vector>
+#include <random>
+#include <cstring>
+#include <cmath>
+#include <thread>
+
+#include "Module.h"
+#include "Mixer.h"
+#include "AudioSink.h"
+#include "Benchmark.h"
+
+/*
+    Every measurement is repeated BENCH_NR_RUNS times, the fastest run
+    counts. At most BENCH_NR_SECONDS of the song are mixed per run.
+*/
+const int BENCH_NR_RUNS = 5;
+const int BENCH_NR_SECONDS = 30;
+
+namespace MixerBenchmarkHelperFn {
+    bool loadModule( Module& module,const std::string& fileName )
+    {
+        if ( fileName.empty() ) {
+            std::cout << "\nThis benchmark needs a module file\n";
+            return false;
+        }
+        std::string name( fileName );
+        module.loadFile( name );
+        if ( !module.isLoaded() ) {
+            std::cout << "\nUnable to load " << fileName << "\n";
+            return false;
+        }
+        return true;
+    }
+
+    /*
+        Assigns the module and looks for the end of the song, so that a
+        timed renderSong() only mixes, see Mixer::isSongEnded()
+    */
+    void assignSong( Mixer& mixer,Module& module )
+    {
+        mixer.assignModule( &module );
+        SongAnalysis analysis;
+        mixer.analyzeSong( analysis );
+    }
+
+    /*
+        Mixes block after block into a null sink, like a real time sink
+        would get them, until nrFrames frames are done or the song ends.
+        Returns the time it took in seconds.
+    */
+    double timeBlocks( 
+        Mixer& mixer,
+        Module& module,
+        unsigned nrFrames,
+        std::uint64_t& framesMixed )
+    {
+        NullSink nullSink;
+        mixer.setAudioSink( &nullSink );
+        mixer.assignModule( &module );
+        mixer.startReplay();
+        auto startTime = std::chrono::steady_clock::now();
+        while ( (nullSink.getFramesWritten() < nrFrames) && !mixer.isSongEnded() )
+            mixer.updateWaveBuffers();
+        auto stopTime = std::chrono::steady_clock::now();
+        framesMixed = nullSink.getFramesWritten();
+        mixer.stopReplay();
+        mixer.setAudioSink( nullptr );
+        return std::chrono::duration< double >( stopTime - startTime ).count();
+    }
+
+    /*
+        Mixes nrFrames frames, or up to the end of the song, in chunks of
+        at most the size of buffer and adds them to output. Where a chunk
+        starts changes the float rounding of the mixer in the last bit, so
+        two runs that are compared must be chunked the same way.
+    */
+    void appendFrames( 
+        Mixer& mixer,
+        std::vector< float >& buffer,
+        std::uint64_t nrFrames,
+        std::vector< float >& output )
+    {
+        const std::uint64_t chunkSize = buffer.size() / MXR_NR_OUTPUT_CHANNELS;
+        while ( (nrFrames > 0) && !mixer.isSongEnded() ) {
+            unsigned nrFramesMixed = mixer.render( 
+                buffer.data(),(std::size_t)std::min( chunkSize,nrFrames ) );
+            output.insert( output.end(),buffer.begin(),
+                buffer.begin() + nrFramesMixed * MXR_NR_OUTPUT_CHANNELS );
+            nrFrames -= nrFramesMixed;
+        }
+    }
+
+    /*
+        Mixes the whole song in chunks of at most the size of buffer, the
+        last one ending exactly at the end of the song. So the replay is 
+        left at the first tick of the next pass rather than somewhere past
+        it, at every mix rate. Returns the nr of frames, 0 if the song did
+        not end where the analysis says it does.
+    */
+    std::uint64_t renderToSongEnd( 
+        Mixer& mixer,
+        Module& module,
+        std::vector< float >& buffer )
+    {
+        mixer.assignModule( &module );
+        SongAnalysis analysis;
+        mixer.analyzeSong( analysis );
+        const std::uint64_t chunkSize = buffer.size() / MXR_NR_OUTPUT_CHANNELS;
+        std::uint64_t nrFrames = 0;
+        while ( (nrFrames < analysis.nrFrames) && !mixer.isSongEnded() )
+            nrFrames += mixer.render( buffer.data(),
+                (std::size_t)std::min( chunkSize,analysis.nrFrames - nrFrames ) );
+        return mixer.isSongEnded() ? nrFrames : 0;
+    }
+
+    /*
+        Counts the frames and the zero crossings of the left + right signal.
+        Zero crossings per second are a cheap measure of the pitch.
+    */
+    class ZeroCrossingSink : public AudioSink {
+    public:
+        int             open(
+            unsigned /*mixRate*/,
+            unsigned nrChannels,
+            unsigned /*framesPerBlock*/,
+            unsigned /*blockCount*/ ) override
+        {
+            nrChannels_ = nrChannels;
+            framesWritten_ = 0;
+            nrZeroCrossings_ = 0;
+            isPositive_ = true;
+            return 0;
+        }
+        int             close() override { return 0; }
+        unsigned        getFramesWritable() override { return AUDIOSINK_UNLIMITED; }
+        int             write( const float* buffer,unsigned nrFrames ) override
+        {
+            for ( unsigned i = 0; i < nrFrames; i++ ) {
+                float t = 0.0f;
+                for ( unsigned c = 0; c < nrChannels_; c++ )
+                    t += *buffer++;
+                if ( (t > 0.0f && !isPositive_) || (t < 0.0f && isPositive_) ) {
+                    isPositive_ = !isPositive_;
+                    nrZeroCrossings_++;
+                }
+            }
+            framesWritten_ += nrFrames;
+            return 0;
+        }
+        std::uint64_t   getFramesWritten() const { return framesWritten_; }
+        std::uint64_t   getNrZeroCrossings() const { return nrZeroCrossings_; }
+
+    private:
+        unsigned        nrChannels_ = 0;
+        std::uint64_t   framesWritten_ = 0;
+        std::uint64_t   nrZeroCrossings_ = 0;
+        bool            isPositive_ = true;
+    };
+
+    /*
+        Mixes one voice that plays through a long sample of random noise, at
+        a slightly different pitch for every block, every other block is
+        played backwards. Returns the time in seconds and leaves the result
+        in mixBuffer. SampleType is std::int16_t, float for the 
+        MXR_MIX_FLOAT_DATA routines or std::int8_t for the MXR_MIX_8BIT_DATA
+        routines.
+    */
+    template< typename SampleType >
+    double timeMixRoutine( 
+        MixRoutine forwardMixRoutine,
+        MixRoutine backwardMixRoutine,
+        std::vector< SampleType >& sampleData,
+        unsigned sampleLength,
+        bool isStereo,
+        std::vector< float >& mixBuffer,
+        unsigned framesPerBlock,
+        unsigned nrBlocks )
+    {
+        SampleType* pSmpData = sampleData.data() + 
+            (isStereo ? (INTERPOLATION_SPACER << 1) : INTERPOLATION_SPACER);
+        std::fill( mixBuffer.begin(),mixBuffer.end(),0.0f );
+        auto startTime = std::chrono::steady_clock::now();
+        unsigned smpOffset = 0;
+        for ( unsigned block = 0; block < nrBlocks; block++ ) {
+            std::int64_t positionStep = (std::int64_t)
+                ((0.5 + (double)(block % 16) * 0.0937) * MXR_POSITION_ONE);
+            std::int64_t position = (std::int64_t)((double)(block % 7) * 0.13 * MXR_POSITION_ONE);
+            unsigned blockLength = (unsigned)
+                ((framesPerBlock * positionStep) >> MXR_POSITION_FRACTION_BITS);
+            if ( smpOffset + blockLength + 4 >= sampleLength )
+                smpOffset = 0;
+            if ( block & 1 )
+                position += framesPerBlock * positionStep;
+            ((block & 1) ? backwardMixRoutine : forwardMixRoutine)(
+                mixBuffer.data() + (block & 0x7) * framesPerBlock * 2,
+                pSmpData + (isStereo ? smpOffset << 1 : smpOffset),
+                framesPerBlock,
+                0.4f,
+                0.3f,
+                0.0f,
+                0.0f,
+                position,
+                positionStep );
+            smpOffset += blockLength;
+        }
+        auto stopTime = std::chrono::steady_clock::now();
+        return std::chrono::duration< double >( stopTime - startTime ).count();
+    }
+
+    /*
+        A sample point of the given value, in the range of 16 bit sample 
+        data. 8 bit sample points are shifted up by the mixing routines.
+    */
+    template< typename SampleType >
+    SampleType makeSamplePoint( double value )
+    {
+        return (sizeof( SampleType ) == 1) ? 
+            (SampleType)std::lround( value / 256.0 ) : (SampleType)std::lround( value );
+    }
+
+    /*
+        Resamples a sine wave with the given period (in samples) and returns
+        the signal to noise ratio in dB of the left channel of the result.
+        A stereo sample gets the same sine in both channels.
+    */
+    template< typename SampleType >
+    double measureSnr( MixRoutine mixRoutine,bool isStereo,double period )
+    {
+        const double pi = 3.14159265358979323846;
+        const double amplitude = 16000.0;
+        const unsigned sampleLength = 4096;
+        const unsigned nrFrames = 4096;
+        const std::int64_t positionStep = (std::int64_t)(0.37 * MXR_POSITION_ONE);
+        const std::int64_t startPosition = 100 * MXR_POSITION_ONE;
+        std::vector< SampleType > sampleData( 
+            (sampleLength + 2 * INTERPOLATION_SPACER) * 2 );
+        SampleType* pSmpData = sampleData.data() + INTERPOLATION_SPACER * 2;
+        for ( int i = -INTERPOLATION_SPACER; i < (int)sampleLength + INTERPOLATION_SPACER; i++ ) {
+            SampleType smp = makeSamplePoint< SampleType >( amplitude * sin( 2.0 * pi * i / period ) );
+            if ( isStereo ) {
+                pSmpData[i << 1] = smp;
+                pSmpData[(i << 1) + 1] = smp;
+            } else
+                pSmpData[i] = smp;
+        }
+        std::vector< float > mixBuffer( nrFrames * 2 );
+        mixRoutine( mixBuffer.data(),pSmpData,nrFrames,1.0f,1.0f,0.0f,0.0f,startPosition,positionStep );
+
+        double signal = 0.0;
+        double noise = 0.0;
+        std::int64_t position = startPosition;
+        for ( unsigned i = 0; i < nrFrames; i++ ) {
+            double expected = amplitude * 
+                sin( 2.0 * pi * ((double)position / MXR_POSITION_ONE) / period );
+            double error = mixBuffer[i << 1] - expected;
+            signal += expected * expected;
+            noise += error * error;
+            position += positionStep;
+        }
+        return 10.0 * log10( signal / std::max( noise,1.0e-20 ) );
+    }
+
+    /*
+        Prints speed, quality and correctness of a list of mixing routines.
+        sampleData is 0 for 16 bit sample data, or MXR_MIX_FLOAT_DATA or
+        MXR_MIX_8BIT_DATA.
+    */
+    struct MixRoutineInfo {
+        const char* name;
+        int         isa;
+        int         interpolationType;
+        bool        isStereo;
+        int         sampleData;
+        bool        isReference;
+    };
+
+    template< typename SampleType >
+    void timeAndMeasure(
+        const MixRoutineInfo& routine,
+        MixRoutine forwardMixRoutine,
+        MixRoutine backwardMixRoutine,
+        std::vector< SampleType >& sampleData,
+        unsigned sampleLength,
+        std::vector< float >& mixBuffer,
+        unsigned framesPerBlock,
+        unsigned nrBlocks,
+        double lowPeriod,
+        double highPeriod,
+        double& bestTime,
+        double& snrLow,
+        double& snrHigh )
+    {
+        bestTime = 1.0e30;
+        for ( int i = 0; i < BENCH_NR_RUNS; i++ )
+            bestTime = std::min( bestTime,timeMixRoutine( forwardMixRoutine,backwardMixRoutine,
+                sampleData,sampleLength,routine.isStereo,mixBuffer,framesPerBlock,nrBlocks ) );
+        snrLow = measureSnr< SampleType >( forwardMixRoutine,routine.isStereo,lowPeriod );
+        snrHigh = measureSnr< SampleType >( forwardMixRoutine,routine.isStereo,highPeriod );
+    }
+
+    int compareMixRoutines( 
+        const char* title,
+        const MixRoutineInfo* routines,
+        unsigned nrRoutines,
+        int isa )
+    {
+        const unsigned framesPerBlock = 1024;
+        const unsigned nrBlocks = 4096;
+        const unsigned sampleLength = 0x40000;
+        const double lowPeriod = 23.7;
+        const double highPeriod = 5.3;
+
+        std::mt19937 random( 1 );
+        std::uniform_int_distribution< int > distribution( -32768,32767 );
+        std::vector< std::int16_t > sampleData( 
+            (sampleLength + 2 * INTERPOLATION_SPACER + SAMPLEDATA_EXTENSION) * 2 );
+        for ( auto& smp : sampleData )
+            smp = (std::int16_t)distribution( random );
+        std::vector< float > floatSampleData( sampleData.begin(),sampleData.end() );
+        std::vector< std::int8_t > sampleData8( sampleData.size() );
+        for ( std::size_t i = 0; i < sampleData.size(); i++ )
+            sampleData8[i] = (std::int8_t)(sampleData[i] >> 8);
+
+        std::vector< float > referenceBuffer( framesPerBlock * 2 * 8 );
+        std::vector< float > mixBuffer( framesPerBlock * 2 * 8 );
+        int result = 0;
+        std::cout
+            << "\n" << title << ", " << nrBlocks << " blocks of " << framesPerBlock
+            << " frames per run. SNR of a sine at " 
+            << std::setprecision( 3 ) << 1.0 / lowPeriod << " and " 
+            << 1.0 / highPeriod << " x the sample rate."
+            << "\n"
+            << "\nRoutine          | ns / frame | Voices / core | SNR low (dB) | SNR high (dB) | Output"
+            << "\n-----------------+------------+---------------+--------------+---------------+-----------"
+            << std::fixed;
+        for ( unsigned r = 0; r < nrRoutines; r++ ) {
+            const MixRoutineInfo& routine = routines[r];
+            std::cout << "\n" << std::left << std::setw( 16 ) << routine.name << std::right;
+            if ( routine.isa > isa ) {
+                std::cout << " | " << cpuGetIsaName( routine.isa ) << " is not available";
+                continue;
+            }
+            int variant = routine.sampleData | (routine.isStereo ? MXR_MIX_STEREO : 0);
+            MixRoutine forwardMixRoutine = 
+                Mixer::getMixRoutine( routine.isa,routine.interpolationType,variant );
+            MixRoutine backwardMixRoutine = Mixer::getMixRoutine( 
+                routine.isa,routine.interpolationType,variant | MXR_MIX_BACKWARDS );
+            double bestTime;
+            double snrLow;
+            double snrHigh;
+            if ( routine.sampleData == MXR_MIX_FLOAT_DATA )
+                timeAndMeasure( routine,forwardMixRoutine,backwardMixRoutine,floatSampleData,
+                    sampleLength,mixBuffer,framesPerBlock,nrBlocks,lowPeriod,highPeriod,
+                    bestTime,snrLow,snrHigh );
+            else if ( routine.sampleData == MXR_MIX_8BIT_DATA )
+                timeAndMeasure( routine,forwardMixRoutine,backwardMixRoutine,sampleData8,
+                    sampleLength,mixBuffer,framesPerBlock,nrBlocks,lowPeriod,highPeriod,
+                    bestTime,snrLow,snrHigh );
+            else
+                timeAndMeasure( routine,forwardMixRoutine,backwardMixRoutine,sampleData,
+                    sampleLength,mixBuffer,framesPerBlock,nrBlocks,lowPeriod,highPeriod,
+                    bestTime,snrLow,snrHigh );
+            double frameTime = bestTime / ((double)nrBlocks * framesPerBlock);
+
+            std::cout
+                << " | " << std::setw( 10 ) << std::setprecision( 2 ) << frameTime * 1.0e9
+                << " | " << std::setw( 13 ) << std::setprecision( 0 ) 
+                    << 1.0 / (frameTime * MXR_DEFAULT_MIXRATE)
+                << " | " << std::setw( 12 ) << std::setprecision( 1 ) << snrLow
+                << " | " << std::setw( 13 ) << std::setprecision( 1 ) << snrHigh;
+            if ( routine.isReference ) {
+                referenceBuffer = mixBuffer;
+                std::cout << " | reference";
+            } else if ( referenceBuffer == mixBuffer )
+                std::cout << " | identical";
+            else {
+                std::cout << " | DIFFERENT";
+                result = -1;
+            }
+        }
+        std::cout << "\n" << std::defaultfloat;
+        return result;
+    }
+
+    /*
+        A voice keeps its key pressed for ENVELOPE_KEY_OFF_TICK ticks, then
+        it is released and the envelope runs on till ENVELOPE_NR_TICKS.
+    */
+    const unsigned ENVELOPE_NR_TICKS = 2048;
+    const unsigned ENVELOPE_KEY_OFF_TICK = 1024;
+
+    /*
+        Plays every envelope nrRepeats times like a voice would, with the 
+        node search or with the rasterized table. Stores every value and 
+        every position of the first repeat in values, if values is not 
+        a nullptr. Returns the time it took in seconds.
+    */
+    template< bool useNodes >
+    double timeEnvelopes(
+        const std::vector< const Envelope* >& envelopes,
+        unsigned nrRepeats,
+        std::int64_t& checkSum,
+        std::vector< unsigned >* values )
+    {
+        auto startTime = std::chrono::steady_clock::now();
+        for ( unsigned repeat = 0; repeat < nrRepeats; repeat++ ) {
+            for ( const Envelope* envelope : envelopes ) {
+                unsigned frameNr = 0;
+                for ( unsigned tick = 0; tick < ENVELOPE_NR_TICKS; tick++ ) {
+                    bool keyIsReleased = tick >= ENVELOPE_KEY_OFF_TICK;
+                    int value = useNodes ?
+                        envelope->getEnvelopeValFromNodes( frameNr,keyIsReleased ) :
+                        envelope->getEnvelopeVal( frameNr,keyIsReleased );
+                    checkSum += value;
+                    if ( values && (repeat == 0) ) {
+                        values->push_back( (unsigned)value );
+                        values->push_back( frameNr );
+                    }
+                    frameNr++;
+                }
+            }
+        }
+        auto stopTime = std::chrono::steady_clock::now();
+        return std::chrono::duration< double >( stopTime - startTime ).count();
+    }
+
+    /*
+        An envelope with evenly spaced nodes that go up and down, for when
+        there is no module file
+    */
+    Envelope makeEnvelope(
+        bool envelopeStyle,
+        unsigned char flags,
+        int nrNodes,
+        int sustainStart,
+        int sustainEnd,
+        int loopStart,
+        int loopEnd )
+    {
+        Envelope envelope;
+        envelope.setEnvelopeStyle( envelopeStyle );
+        envelope.setFlags( ENVELOPE_IS_ENABLED_FLAG | flags );
+        envelope.nrNodes = (unsigned char)nrNodes;
+        for ( int nodeNr = 0; nodeNr < nrNodes; nodeNr++ ) {
+            envelope.nodes[nodeNr].x = (unsigned short)(nodeNr * 23 + (nodeNr & 3));
+            envelope.nodes[nodeNr].y = (unsigned char)((nodeNr * 37) % 65);
+        }
+        envelope.sustainStart = (unsigned char)sustainStart;
+        envelope.sustainEnd = (unsigned char)sustainEnd;
+        envelope.loopStart = (unsigned char)loopStart;
+        envelope.loopEnd = (unsigned char)loopEnd;
+        envelope.rasterize();
+        return envelope;
+    }
+
+    /*
+        Mixer::noteToPeriod() and Mixer::periodToFrequency(), with the 
+        tables or with the formulas they are made of
+    */
+    template< bool useTable >
+    unsigned noteToPeriod( bool linear,unsigned note,int finetune )
+    {
+        if ( linear )
+            return (7680 - ((note - 1) << 6) - (finetune >> 1));
+        return useTable ?
+            PeriodTable::get().getAmigaPeriod( note,finetune ) :
+            PeriodTable::calcAmigaPeriod( note,finetune );
+    }
+    template< bool useTable >
+    unsigned periodToFrequency( bool linear,unsigned period )
+    {
+        if ( linear )
+            return useTable ?
+                PeriodTable::get().getLinearFrequency( period ) :
+                PeriodTable::calcLinearFrequency( period );
+        return period ? ((8363 * 1712) / period) : 0;
+    }
+
+    /*
+        The period and frequency work of nrTicks ticks on MXR_MAX_LOGICAL_CHANNELS
+        channels that all play an arpeggio, a vibrato and a portamento, like
+        the effect handling in Mixer::updateEffects() does it. Returns the
+        time it took in seconds.
+    */
+    const int PERIOD_VIBRATO_DEPTH = 64;
+
+    template< bool useTable >
+    double timeEffectTicks( bool linear,unsigned nrTicks,std::uint64_t& checkSum )
+    {
+        const int arpeggio[] = { 0,4,7 };
+        auto startTime = std::chrono::steady_clock::now();
+        for ( unsigned tick = 0; tick < nrTicks; tick++ ) {
+            for ( unsigned channelNr = 0; channelNr < MXR_MAX_LOGICAL_CHANNELS; channelNr++ ) {
+                unsigned note = 24 + (channelNr + tick / 64) % 72;
+                int finetune = (int)((channelNr * 37) & 0xFF) - 128;
+                unsigned period = noteToPeriod< useTable >(
+                    linear,note + arpeggio[tick % 3],finetune );
+                checkSum += periodToFrequency< useTable >( linear,period );
+
+                int vibrato = (int)((tick + channelNr) % (2 * PERIOD_VIBRATO_DEPTH)) 
+                    - PERIOD_VIBRATO_DEPTH;
+                period = noteToPeriod< useTable >( linear,note,finetune );
+                checkSum += periodToFrequency< useTable >( linear,period + vibrato );
+                checkSum += periodToFrequency< useTable >( linear,period - (tick & 0xFF) );
+            }
+        }
+        auto stopTime = std::chrono::steady_clock::now();
+        return std::chrono::duration< double >( stopTime - startTime ).count();
+    }
+}
+
+int MixerBenchmark::run( 
+    const std::string& benchmarkName,const std::vector< std::string >& fileNames,int isa )
+{
+    // only the benchmarks on a corpus take more than one file:
+    if ( benchmarkName == "8bit" )
+        return eightBitSampleData( fileNames,isa );
+    if ( benchmarkName == "analyze" )
+        return songAnalysis( fileNames,isa );
+    if ( fileNames.size() > 1 ) {
+        std::cout << "\nThe " << benchmarkName << " benchmark takes one file\n";
+        return -1;
+    }
+    std::string fileName = fileNames.empty() ? std::string() : fileNames[0];
+    if ( benchmarkName == "blocksize" )
+        return blockSize( fileName,isa );
+    if ( benchmarkName == "mixrate" )
+        return mixRate( fileName,isa );
+    if ( benchmarkName == "voices" )
+        return voiceCost( fileName,isa );
+    if ( benchmarkName == "polyphony" )
+        return polyphony( fileName,isa );
+    if ( benchmarkName == "cubic" )
+        return cubicInterpolation( isa );
+    if ( benchmarkName == "sinc" )
+        return sincInterpolation( isa );
+    if ( benchmarkName == "envelopes" )
+        return envelopes( fileName );
+    if ( benchmarkName == "periods" )
+        return periodConversion();
+    if ( benchmarkName == "sampledata" )
+        return sampleData( fileName,isa );
+    if ( benchmarkName == "threads" )
+        return threadScaling( fileName,isa );
+    if ( benchmarkName == "snapshot" )
+        return replayStateSnapshots( fileName,isa );
+    if ( benchmarkName == "seek" )
+        return seekIndex( fileName,isa );
+
+    std::cout 
+        << "\nUnknown benchmark: " << benchmarkName
+        << "\nAvailable benchmarks:"
+        << "\n    blocksize   mixing time against block size"
+        << "\n    mixrate     song length, pitch and mixing time against mix rate"
+        << "\n    voices      mixing time per voice for each interpolation type"
+        << "\n    polyphony   voices and mixing time per block, e.g. 4 against 64 channels"
+        << "\n    cubic       scalar against AVX2 cubic interpolation, no file needed"
+        << "\n    sinc        sinc interpolation against the others, no file needed"
+        << "\n    envelopes   envelope node search against the rasterized tables"
+        << "\n    periods     period and frequency tables against pow(), no file needed"
+        << "\n    sampledata  mixing from 16 bit against float sample data"
+        << "\n    8bit        memory and mixing time of 8 bit samples kept as 8 bit, on"
+        << "\n                one or more files"
+        << "\n    threads     rendering time with 1 to 8 mixer threads"
+        << "\n    snapshot    seeking with replay state snapshots against replaying"
+        << "\n    analyze     song length and loop point without mixing against"
+        << "\n                rendering, on one or more files"
+        << "\n    seek        seeking with a seek index against replaying"
+        << "\n";
+    return -1;
+}
+
+/*
+    Every block has a fixed cost (function calls, sink overhead, splitting
+    the ticks) on top of the cost per frame, so for a fixed amount of audio
+    time = frameTime + blockCost * nrBlocks. blockCost is estimated with a 
+    least squares fit over all block sizes.
+*/
+int MixerBenchmark::blockSize( const std::string& fileName,int isa )
+{
+    using namespace MixerBenchmarkHelperFn;
+    Module  module;
+    if ( !loadModule( module,fileName ) )
+        return -1;
+
+    const unsigned minBlockSize = 64;
+    const unsigned maxBlockSize = 65536;
+    const unsigned maxNrFrames = BENCH_NR_SECONDS * MXR_DEFAULT_MIXRATE;
+    std::uint64_t nrFrames = maxNrFrames;
+    std::vector< double >   nrBlocks;
+    std::vector< double >   times;
+    Mixer   mixer;
+    mixer.setIsa( isa );
+    for ( unsigned blockSize = minBlockSize; blockSize <= maxBlockSize; blockSize <<= 1 ) {
+        mixer.setBlockSize( blockSize );
+        double bestTime = 1.0e30;
+        for ( int i = 0; i < BENCH_NR_RUNS; i++ )
+            bestTime = std::min( bestTime,timeBlocks( mixer,module,maxNrFrames,nrFrames ) );
+        nrBlocks.push_back( (double)((nrFrames + blockSize - 1) / blockSize) );
+        times.push_back( bestTime );
+    }
+
+    double avgBlocks = 0.0;
+    double avgTime = 0.0;
+    for ( unsigned i = 0; i < times.size(); i++ ) {
+        avgBlocks += nrBlocks[i];
+        avgTime += times[i];
+    }
+    avgBlocks /= times.size();
+    avgTime /= times.size();
+    double covariance = 0.0;
+    double variance = 0.0;
+    for ( unsigned i = 0; i < times.size(); i++ ) {
+        covariance += (nrBlocks[i] - avgBlocks) * (times[i] - avgTime);
+        variance += (nrBlocks[i] - avgBlocks) * (nrBlocks[i] - avgBlocks);
+    }
+    double blockCost = std::max( covariance / variance,0.0 );
+
+    std::cout
+        << "\nMixing " << std::fixed << std::setprecision( 2 ) 
+        << (double)nrFrames / MXR_DEFAULT_MIXRATE << " s of " << fileName
+        << ", estimated cost per block: " << std::setprecision( 3 ) 
+        << blockCost * 1.0e6 << " us"
+        << "\n"
+        << "\nBlock size | Blocks | Time (ms) | ns / frame | Block cost (%)"
+        << "\n-----------+--------+-----------+------------+---------------";
+    unsigned blockSize = minBlockSize;
+    for ( unsigned i = 0; i < times.size(); i++ ) {
+        std::cout
+            << "\n" << std::setw( 10 ) << blockSize
+            << " | " << std::setw( 6 ) << std::setprecision( 0 ) << nrBlocks[i]
+            << " | " << std::setw( 9 ) << std::setprecision( 2 ) << times[i] * 1.0e3
+            << " | " << std::setw( 10 ) << std::setprecision( 2 ) 
+                << times[i] * 1.0e9 / (double)nrFrames
+            << " | " << std::setw( 13 ) << std::setprecision( 1 ) 
+                << 100.0 * blockCost * nrBlocks[i] / times[i];
+        blockSize <<= 1;
+    }
+    std::cout << "\n" << std::defaultfloat;
+    return 0;
+}
+
+/*
+    Renders the whole song at several mix rates. The tempo and the pitch 
+    must not depend on the rate: the song must be as long as at the default
+    rate, give or take the frame its length is rounded to, and at the end
+    of the song every voice must play at the frequency its channel has at
+    the default rate, to the last bit of its position step. The zero 
+    crossings per second only show how much the interpolation and the
+    aliasing change with the rate.
+*/
+int MixerBenchmark::mixRate( const std::string& fileName,int isa )
+{
+    using namespace MixerBenchmarkHelperFn;
+    Module  module;
+    if ( !loadModule( module,fileName ) )
+        return -1;
+
+    const unsigned mixRates[] = { 22050,32000,44100,48000,96000,192000 };
+    const unsigned nrChannels = module.getnChannels();
+    Mixer   mixer;
+    mixer.setIsa( isa );
+    mixer.setLatencyProfile( MXR_LATENCY_BATCH );
+    std::vector< float > buffer( mixer.getBlockSize() * MXR_NR_OUTPUT_CHANNELS );
+    const std::uint64_t referenceNrFrames = renderToSongEnd( mixer,module,buffer );
+    std::vector< unsigned > referenceFrequencies( nrChannels );
+    for ( unsigned i = 0; i < nrChannels; i++ )
+        referenceFrequencies[i] = mixer.getChannelFrequency( i );
+
+    std::cout
+        << "\nRendering " << fileName
+        << "\n"
+        << "\n  Mix rate |    Frames | Length (s) | Crossings / s | Time (ms) | x Real time | Tempo & pitch"
+        << "\n-----------+-----------+------------+---------------+-----------+-------------+--------------"
+        << std::fixed;
+    int result = 0;
+    for ( unsigned mixRate : mixRates ) {
+        ZeroCrossingSink zeroCrossingSink;
+        mixer.setMixRate( mixRate );
+        mixer.setAudioSink( &zeroCrossingSink );
+        double bestTime = 1.0e30;
+        for ( int i = 0; i < BENCH_NR_RUNS; i++ ) {
+            assignSong( mixer,module );
+            auto startTime = std::chrono::steady_clock::now();
+            mixer.renderSong();
+            auto stopTime = std::chrono::steady_clock::now();
+            bestTime = std::min( bestTime,
+                std::chrono::duration< double >( stopTime - startTime ).count() );
+        }
+        mixer.setAudioSink( nullptr );
+        double songTime = (double)zeroCrossingSink.getFramesWritten() / (double)mixRate;
+        std::cout
+            << "\n" << std::setw( 10 ) << mixRate
+            << " | " << std::setw( 9 ) << zeroCrossingSink.getFramesWritten()
+            << " | " << std::setw( 10 ) << std::setprecision( 4 ) << songTime
+            << " | " << std::setw( 13 ) << std::setprecision( 1 ) 
+                << (double)zeroCrossingSink.getNrZeroCrossings() / songTime
+            << " | " << std::setw( 9 ) << std::setprecision( 2 ) << bestTime * 1.0e3
+            << " | " << std::setw( 11 ) << std::setprecision( 1 ) << songTime / bestTime
+            << " | ";
+
+        /*
+            Both lengths are rounded to whole frames, so they may differ by 
+            less than a frame at either rate: (nrFrames / mixRate - 
+            referenceNrFrames / MXR_DEFAULT_MIXRATE) * mixRate * 
+            MXR_DEFAULT_MIXRATE is less than MXR_DEFAULT_MIXRATE + mixRate
+        */
+        std::int64_t lengthError = 
+            (std::int64_t)(renderToSongEnd( mixer,module,buffer ) * MXR_DEFAULT_MIXRATE) - 
+            (std::int64_t)(referenceNrFrames * mixRate);
+        const std::int64_t maxLengthError = MXR_DEFAULT_MIXRATE + mixRate;
+        unsigned nrVoices = 0;
+        bool isPitchRight = true;
+        for ( unsigned i = 0; i < nrChannels; i++ ) {
+            std::int64_t positionStep = mixer.getChannelPositionStep( i );
+            if ( positionStep == 0 )
+                continue;
+            nrVoices++;
+            if ( positionStep != ((std::int64_t)referenceFrequencies[i] 
+                    << MXR_POSITION_FRACTION_BITS) / mixRate )
+                isPitchRight = false;
+        }
+        if ( isPitchRight && (lengthError > -maxLengthError) && 
+            (lengthError < maxLengthError) )
+            std::cout << "ok, " << nrVoices << " voices";
+        else {
+            std::cout << "DIFFERENT";
+            result = -1;
+        }
+    }
+    std::cout << "\n" << std::defaultfloat;
+    return result;
+}
+
+/*
+    Renders the whole song once per interpolation type. The time per voice
+    frame includes everything the mixer does (effects, channel bookkeeping, 
+    final scaling), so it is a little higher than in the kernel benchmarks.
+*/
+int MixerBenchmark::voiceCost( const std::string& fileName,int isa )
+{
+    using namespace MixerBenchmarkHelperFn;
+    Module  module;
+    if ( !loadModule( module,fileName ) )
+        return -1;
+
+    const char* interpolationNames[MXR_INTERPOLATION_TYPES] = 
+        { "none","linear","cubic","sinc" };
+    Mixer   mixer;
+    mixer.setIsa( isa );
+    NullSink nullSink;
+    mixer.setLatencyProfile( MXR_LATENCY_BATCH );
+    mixer.setAudioSink( &nullSink );
+    std::cout
+        << "\nRendering " << fileName << " with the " 
+        << cpuGetIsaName( mixer.getIsa() ) << " routines"
+        << "\n"
+        << "\nInterpolation | Avg voices | Frames / call | Time (ms) | ns / voice frame | Voices / core"
+        << "\n--------------+------------+---------------+-----------+------------------+--------------"
+        << std::fixed;
+    for ( int interpolationType = 0; interpolationType < MXR_INTERPOLATION_TYPES; 
+        interpolationType++ ) {
+        mixer.setInterpolationType( interpolationType );
+        double bestTime = 1.0e30;
+        for ( int i = 0; i < BENCH_NR_RUNS; i++ ) {
+            assignSong( mixer,module );
+            auto startTime = std::chrono::steady_clock::now();
+            mixer.renderSong();
+            auto stopTime = std::chrono::steady_clock::now();
+            bestTime = std::min( bestTime,
+                std::chrono::duration< double >( stopTime - startTime ).count() );
+        }
+        double nrVoiceFrames = (double)std::max( mixer.getNrVoiceFramesMixed(),(std::uint64_t)1 );
+        double voiceFrameTime = bestTime / nrVoiceFrames;
+        std::cout
+            << "\n" << std::left << std::setw( 13 ) << interpolationNames[interpolationType] 
+                << std::right
+            << " | " << std::setw( 10 ) << std::setprecision( 2 ) 
+                << nrVoiceFrames / (double)std::max( nullSink.getFramesWritten(),(std::uint64_t)1 )
+            << " | " << std::setw( 13 ) << std::setprecision( 1 ) 
+                << nrVoiceFrames / (double)std::max( mixer.getNrMixRoutineCalls(),(std::uint64_t)1 )
+            << " | " << std::setw( 9 ) << std::setprecision( 2 ) << bestTime * 1.0e3
+            << " | " << std::setw( 16 ) << std::setprecision( 2 ) << voiceFrameTime * 1.0e9
+            << " | " << std::setw( 13 ) << std::setprecision( 0 ) 
+                << 1.0 / (voiceFrameTime * mixer.getMixRate());
+    }
+    mixer.setAudioSink( nullptr );
+    std::cout << "\n" << std::defaultfloat;
+    return 0;
+}
+
+/*
+    The voices are counted in a separate run, so that counting them does 
+    not add to the time. Channels is the nr of channels of the song.
+*/
+int MixerBenchmark::polyphony( const std::string& fileName,int isa )
+{
+    using namespace MixerBenchmarkHelperFn;
+    Module  module;
+    if ( !loadModule( module,fileName ) )
+        return -1;
+
+    const unsigned minBlockSize = 64;
+    const unsigned maxBlockSize = MXR_DEFAULT_FRAMES_PER_BLOCK;
+    const unsigned maxNrFrames = BENCH_NR_SECONDS * MXR_DEFAULT_MIXRATE;
+    Mixer   mixer;
+    mixer.setIsa( isa );
+    mixer.setInterpolationType( MXR_NO_INTERPOLATION );
+    std::cout
+        << "\nMixing " << fileName << ": " << module.getnChannels() 
+        << " channels, no interpolation"
+        << "\n"
+        << "\nBlock size | Avg voices | Peak voices | us / block | ns / frame | ns / voice frame"
+        << "\n-----------+------------+-------------+------------+------------+-----------------"
+        << std::fixed;
+    for ( unsigned blockSize = minBlockSize; blockSize <= maxBlockSize; blockSize <<= 1 ) {
+        mixer.setBlockSize( blockSize );
+
+        NullSink nullSink;
+        mixer.setAudioSink( &nullSink );
+        mixer.assignModule( &module );
+        mixer.startReplay();
+        std::uint64_t nrBlocks = 0;
+        std::uint64_t nrVoices = 0;
+        unsigned peakVoices = 0;
+        while ( (nullSink.getFramesWritten() < maxNrFrames) && !mixer.isSongEnded() ) {
+            mixer.updateWaveBuffers();
+            nrBlocks++;
+            nrVoices += mixer.getNrActiveVoices();
+            peakVoices = std::max( peakVoices,mixer.getNrActiveVoices() );
+        }
+        mixer.stopReplay();
+        mixer.setAudioSink( nullptr );
+
+        std::uint64_t nrFrames = 0;
+        double bestTime = 1.0e30;
+        for ( int i = 0; i < BENCH_NR_RUNS; i++ )
+            bestTime = std::min( bestTime,timeBlocks( mixer,module,maxNrFrames,nrFrames ) );
+        double nrVoiceFrames = (double)std::max( mixer.getNrVoiceFramesMixed(),(std::uint64_t)1 );
+        nrBlocks = std::max( nrBlocks,(std::uint64_t)1 );
+        std::cout
+            << "\n" << std::setw( 10 ) << blockSize
+            << " | " << std::setw( 10 ) << std::setprecision( 2 ) 
+                << (double)nrVoices / (double)nrBlocks
+            << " | " << std::setw( 11 ) << peakVoices
+            << " | " << std::setw( 10 ) << std::setprecision( 2 ) 
+                << bestTime * 1.0e6 / (double)nrBlocks
+            << " | " << std::setw( 10 ) << std::setprecision( 2 ) 
+                << bestTime * 1.0e9 / (double)std::max( nrFrames,(std::uint64_t)1 )
+            << " | " << std::setw( 16 ) << std::setprecision( 2 ) 
+                << bestTime * 1.0e9 / nrVoiceFrames;
+    }
+    std::cout << "\n" << std::defaultfloat;
+    return 0;
+}
+
+/*
+    Voices per core is the nr of voices one core could mix in real time at 
+    the default mix rate. Every routine that is not a reference is checked
+    against the last reference routine before it: the output must be bit 
+    identical. The f32 routines read float sample data: for cubic they 
+    have references of their own, as they leave out the rounding of the 16
+    bit routines. The i8 routines read 8 bit sample data, which is another
+    signal, so they have references of their own as well.
+*/
+int MixerBenchmark::cubicInterpolation( int isa )
+{
+    using namespace MixerBenchmarkHelperFn;
+    const int f32 = MXR_MIX_FLOAT_DATA;
+    const int i8 = MXR_MIX_8BIT_DATA;
+    const MixRoutineInfo routines[] = {
+        { "mono scalar",     CPU_ISA_SCALAR,MXR_CUBIC_INTERPOLATION,false,0,  true  },
+        { "mono AVX2",       CPU_ISA_AVX2,  MXR_CUBIC_INTERPOLATION,false,0,  false },
+        { "stereo scalar",   CPU_ISA_SCALAR,MXR_CUBIC_INTERPOLATION,true, 0,  true  },
+        { "stereo AVX2",     CPU_ISA_AVX2,  MXR_CUBIC_INTERPOLATION,true, 0,  false },
+        { "mono f32",        CPU_ISA_SCALAR,MXR_CUBIC_INTERPOLATION,false,f32,true  },
+        { "mono AVX2 f32",   CPU_ISA_AVX2,  MXR_CUBIC_INTERPOLATION,false,f32,false },
+        { "stereo f32",      CPU_ISA_SCALAR,MXR_CUBIC_INTERPOLATION,true, f32,true  },
+        { "stereo AVX2 f32", CPU_ISA_AVX2,  MXR_CUBIC_INTERPOLATION,true, f32,false },
+        { "mono i8",         CPU_ISA_SCALAR,MXR_CUBIC_INTERPOLATION,false,i8, true  },
+        { "mono AVX2 i8",    CPU_ISA_AVX2,  MXR_CUBIC_INTERPOLATION,false,i8, false },
+        { "stereo i8",       CPU_ISA_SCALAR,MXR_CUBIC_INTERPOLATION,true, i8, true  },
+        { "stereo AVX2 i8",  CPU_ISA_AVX2,  MXR_CUBIC_INTERPOLATION,true, i8, false }
+    };
+    return compareMixRoutines( 
+        "Cubic interpolation",routines,sizeof( routines ) / sizeof( routines[0] ),isa );
+}
+
+/*
+    The no, linear and cubic interpolation routines are there to compare the
+    speed and the quality with. The f32 routines must give the same output 
+    as the 16 bit ones, the i8 routines have references of their own.
+*/
+int MixerBenchmark::sincInterpolation( int isa )
+{
+    using namespace MixerBenchmarkHelperFn;
+    const int f32 = MXR_MIX_FLOAT_DATA;
+    const int i8 = MXR_MIX_8BIT_DATA;
+    const MixRoutineInfo routines[] = {
+        { "mono none",       CPU_ISA_SCALAR,MXR_NO_INTERPOLATION,    false,0,  true  },
+        { "mono linear",     CPU_ISA_SCALAR,MXR_LINEAR_INTERPOLATION,false,0,  true  },
+        { "mono SSE4.1",     CPU_ISA_SSE41, MXR_LINEAR_INTERPOLATION,false,0,  false },
+        { "mono linear f32", CPU_ISA_SCALAR,MXR_LINEAR_INTERPOLATION,false,f32,false },
+        { "mono SSE4.1 f32", CPU_ISA_SSE41, MXR_LINEAR_INTERPOLATION,false,f32,false },
+        { "mono linear i8",  CPU_ISA_SCALAR,MXR_LINEAR_INTERPOLATION,false,i8, true  },
+        { "mono SSE4.1 i8",  CPU_ISA_SSE41, MXR_LINEAR_INTERPOLATION,false,i8, false },
+        { "mono cubic",      CPU_ISA_SCALAR,MXR_CUBIC_INTERPOLATION, false,0,  true  },
+        { "mono sinc",       CPU_ISA_SCALAR,MXR_SINC_INTERPOLATION,  false,0,  true  },
+        { "mono SSE2",       CPU_ISA_SSE2,  MXR_SINC_INTERPOLATION,  false,0,  false },
+        { "mono AVX2",       CPU_ISA_AVX2,  MXR_SINC_INTERPOLATION,  false,0,  false },
+        { "mono sinc f32",   CPU_ISA_SCALAR,MXR_SINC_INTERPOLATION,  false,f32,false },
+        { "mono SSE2 f32",   CPU_ISA_SSE2,  MXR_SINC_INTERPOLATION,  false,f32,false },
+        { "mono AVX2 f32",   CPU_ISA_AVX2,  MXR_SINC_INTERPOLATION,  false,f32,false },
+        { "mono sinc i8",    CPU_ISA_SCALAR,MXR_SINC_INTERPOLATION,  false,i8, true  },
+        { "mono SSE2 i8",    CPU_ISA_SSE2,  MXR_SINC_INTERPOLATION,  false,i8, false },
+        { "mono AVX2 i8",    CPU_ISA_AVX2,  MXR_SINC_INTERPOLATION,  false,i8, false },
+        { "stereo sinc",     CPU_ISA_SCALAR,MXR_SINC_INTERPOLATION,  true, 0,  true  },
+        { "stereo SSE2",     CPU_ISA_SSE2,  MXR_SINC_INTERPOLATION,  true, 0,  false },
+        { "stereo AVX2",     CPU_ISA_AVX2,  MXR_SINC_INTERPOLATION,  true, 0,  false },
+        { "stereo sinc f32", CPU_ISA_SCALAR,MXR_SINC_INTERPOLATION,  true, f32,false },
+        { "stereo SSE2 f32", CPU_ISA_SSE2,  MXR_SINC_INTERPOLATION,  true, f32,false },
+        { "stereo AVX2 f32", CPU_ISA_AVX2,  MXR_SINC_INTERPOLATION,  true, f32,false },
+        { "stereo sinc i8",  CPU_ISA_SCALAR,MXR_SINC_INTERPOLATION,  true, i8, true  },
+        { "stereo SSE2 i8",  CPU_ISA_SSE2,  MXR_SINC_INTERPOLATION,  true, i8, false },
+        { "stereo AVX2 i8",  CPU_ISA_AVX2,  MXR_SINC_INTERPOLATION,  true, i8, false }
+    };
+    return compareMixRoutines( 
+        "Sinc interpolation",routines,sizeof( routines ) / sizeof( routines[0] ),isa );
+}
+
+/*
+    Without a file (or if the module has no envelopes), XM and IT style 
+    envelopes with every combination of sustain and loop are generated.
+    Both ways must give the same values and leave frameNr at the same 
+    position for every tick.
+*/
+int MixerBenchmark::envelopes( const std::string& fileName )
+{
+    using namespace MixerBenchmarkHelperFn;
+    Module module;
+    std::vector< Envelope > generatedEnvelopes;
+    std::vector< const Envelope* > envelopes;
+    if ( !fileName.empty() ) {
+        if ( !loadModule( module,fileName ) )
+            return -1;
+        for ( unsigned instrumentNr = 1; instrumentNr <= module.getnInstruments(); instrumentNr++ ) {
+            const Instrument& instrument = module.getInstrument( instrumentNr );
+            const Envelope* instrumentEnvelopes[] = {
+                &instrument.getVolumeEnvelope(),
+                &instrument.getPanningEnvelope(),
+                &instrument.getPitchFltrEnvelope()
+            };
+            for ( const Envelope* envelope : instrumentEnvelopes )
+                if ( envelope->isEnabled() )
+                    envelopes.push_back( envelope );
+        }
+        if ( envelopes.empty() )
+            std::cout << "\n" << fileName << " has no envelopes, using generated ones";
+    }
+    if ( envelopes.empty() ) {
+        const bool styles[] = { xmEnvelopeStyle,itEnvelopeStyle };
+        for ( bool style : styles ) {
+            generatedEnvelopes.push_back( makeEnvelope( style,0,12,0,0,0,0 ) );
+            generatedEnvelopes.push_back( makeEnvelope( 
+                style,ENVELOPE_IS_SUSTAINED_FLAG,12,4,6,0,0 ) );
+            generatedEnvelopes.push_back( makeEnvelope( 
+                style,ENVELOPE_IS_LOOPED_FLAG,12,0,0,3,9 ) );
+            generatedEnvelopes.push_back( makeEnvelope( 
+                style,ENVELOPE_IS_SUSTAINED_FLAG | ENVELOPE_IS_LOOPED_FLAG,12,2,4,5,9 ) );
+            generatedEnvelopes.push_back( makeEnvelope( 
+                style,ENVELOPE_IS_SUSTAINED_FLAG | ENVELOPE_IS_LOOPED_FLAG,12,9,9,5,9 ) );
+            generatedEnvelopes.push_back( makeEnvelope( 
+                style,ENVELOPE_IS_SUSTAINED_FLAG | ENVELOPE_IS_LOOPED_FLAG,25,7,11,3,20 ) );
+        }
+        for ( const Envelope& envelope : generatedEnvelopes )
+            envelopes.push_back( &envelope );
+    }
+    unsigned nrRasterized = 0;
+    unsigned tableSize = 0;
+    for ( const Envelope* envelope : envelopes ) {
+        if ( envelope->isRasterized() )
+            nrRasterized++;
+        tableSize += envelope->getRasterizedLength() * sizeof( std::int16_t );
+    }
+
+    // about 8 million calls per run:
+    unsigned nrRepeats = std::max( 1u,
+        (unsigned)(8000000 / (ENVELOPE_NR_TICKS * envelopes.size())) );
+    std::int64_t nodesCheckSum = 0;
+    std::int64_t tableCheckSum = 0;
+    std::vector< unsigned > nodesValues;
+    std::vector< unsigned > tableValues;
+    timeEnvelopes< true >( envelopes,1,nodesCheckSum,&nodesValues );
+    timeEnvelopes< false >( envelopes,1,tableCheckSum,&tableValues );
+    double nodesTime = 1.0e30;
+    double tableTime = 1.0e30;
+    for ( int i = 0; i < BENCH_NR_RUNS; i++ ) {
+        nodesTime = std::min( nodesTime,
+            timeEnvelopes< true >( envelopes,nrRepeats,nodesCheckSum,nullptr ) );
+        tableTime = std::min( tableTime,
+            timeEnvelopes< false >( envelopes,nrRepeats,tableCheckSum,nullptr ) );
+    }
+    double nrCalls = (double)nrRepeats * ENVELOPE_NR_TICKS * envelopes.size();
+    std::cout
+        << "\n" << envelopes.size() << " envelopes, " << nrRasterized 
+        << " rasterized into " << tableSize << " bytes. Key off at tick " 
+        << ENVELOPE_KEY_OFF_TICK << " of " << ENVELOPE_NR_TICKS << ", "
+        << (std::uint64_t)nrCalls << " calls per run."
+        << "\n"
+        << "\nMethod         | ns / call | Speed up"
+        << "\n---------------+-----------+---------"
+        << std::fixed << std::setprecision( 2 )
+        << "\nnode search    | " << std::setw( 9 ) << nodesTime * 1.0e9 / nrCalls
+        << " | " << std::setw( 8 ) << 1.0
+        << "\nrasterized     | " << std::setw( 9 ) << tableTime * 1.0e9 / nrCalls
+        << " | " << std::setw( 8 ) << nodesTime / tableTime
+        << "\n" << std::defaultfloat;
+    if ( (nodesValues != tableValues) || (nodesCheckSum != tableCheckSum) ) {
+        std::cout << "\nThe rasterized envelopes give DIFFERENT values\n";
+        return -1;
+    }
+    std::cout << "\nThe values and positions are identical\n";
+    return 0;
+}
+
+/*
+    First checks every note and finetune, and every linear period the 
+    tables cover (and a few beyond), against the formulas. Then times the
+    effect work of a tick, with 1 channel tick being the arpeggio, vibrato 
+    and portamento of one channel.
+*/
+int MixerBenchmark::periodConversion()
+{
+    using namespace MixerBenchmarkHelperFn;
+    unsigned nrDifferences = 0;
+    for ( unsigned note = 0; note <= MAXIMUM_NOTES + 4; note++ )
+        for ( int finetune = -2 * PERIOD_TABLE_MAX_FINETUNE;
+            finetune < 2 * PERIOD_TABLE_MAX_FINETUNE; finetune++ )
+            if ( PeriodTable::get().getAmigaPeriod( note,finetune ) !=
+                PeriodTable::calcAmigaPeriod( note,finetune ) )
+                nrDifferences++;
+    for ( unsigned period = 0; period < PERIOD_TABLE_LINEAR_SIZE + 1024; period++ )
+        if ( PeriodTable::get().getLinearFrequency( period ) !=
+            PeriodTable::calcLinearFrequency( period ) )
+            nrDifferences++;
+
+    const unsigned nrTicks = 20000;
+    const double nrChannelTicks = (double)nrTicks * MXR_MAX_LOGICAL_CHANNELS;
+    std::cout
+        << "\n" << nrTicks << " ticks of " << MXR_MAX_LOGICAL_CHANNELS 
+        << " channels with arpeggio, vibrato and portamento per run."
+        << "\n"
+        << "\nFrequencies | Method | ns / channel tick | Speed up"
+        << "\n------------+--------+-------------------+---------"
+        << std::fixed << std::setprecision( 2 );
+    const bool linearModes[] = { false,true };
+    for ( bool linear : linearModes ) {
+        std::uint64_t powCheckSum = 0;
+        std::uint64_t tableCheckSum = 0;
+        double powTime = 1.0e30;
+        double tableTime = 1.0e30;
+        for ( int i = 0; i < BENCH_NR_RUNS; i++ ) {
+            powTime = std::min( powTime,
+                timeEffectTicks< false >( linear,nrTicks,powCheckSum ) );
+            tableTime = std::min( tableTime,
+                timeEffectTicks< true >( linear,nrTicks,tableCheckSum ) );
+        }
+        if ( powCheckSum != tableCheckSum )
+            nrDifferences++;
+        const char* frequencies = linear ? "linear     " : "amiga      ";
+        std::cout
+            << "\n" << frequencies << " | pow()  | " 
+            << std::setw( 17 ) << powTime * 1.0e9 / nrChannelTicks
+            << " | " << std::setw( 8 ) << 1.0
+            << "\n" << frequencies << " | table  | " 
+            << std::setw( 17 ) << tableTime * 1.0e9 / nrChannelTicks
+            << " | " << std::setw( 8 ) << powTime / tableTime;
+    }
+    std::cout << "\n" << std::defaultfloat;
+    if ( nrDifferences ) {
+        std::cout << "\nThe tables give " << nrDifferences << " DIFFERENT values\n";
+        return -1;
+    }
+    std::cout << "\nThe tables give exactly the same periods and frequencies\n";
+    return 0;
+}
+
+/*
+    The output of both is compared in a separate run. The largest 
+    difference is relative to the largest value in the output.
+*/
+int MixerBenchmark::sampleData( const std::string& fileName,int isa )
+{
+    using namespace MixerBenchmarkHelperFn;
+    Module  module;
+    if ( !loadModule( module,fileName ) )
+        return -1;
+
+    const char* interpolationNames[MXR_INTERPOLATION_TYPES] = 
+        { "none","linear","cubic","sinc" };
+    Mixer   mixer;
+    mixer.setIsa( isa );
+    NullSink nullSink;
+    MemorySink memorySinks[2];
+    mixer.setLatencyProfile( MXR_LATENCY_BATCH );
+    mixer.setFloatSampleData( true );
+    mixer.assignModule( &module );
+    std::size_t dataSize = module.getSampleDataSize();
+    std::size_t floatDataSize = module.getFloatSampleDataSize();
+    std::cout
+        << "\nRendering " << fileName << " with the " 
+        << cpuGetIsaName( mixer.getIsa() ) << " routines. Sample data: "
+        << dataSize / 1024 << " kB, with the float copy " 
+        << (dataSize + floatDataSize) / 1024 << " kB."
+        << "\n"
+        << "\nInterpolation | 16 bit ns / voice frame | float ns / voice frame | Speed up | Output"
+        << "\n--------------+-------------------------+------------------------+----------+-----------------"
+        << std::fixed;
+    int result = 0;
+    for ( int interpolationType = 0; interpolationType < MXR_INTERPOLATION_TYPES; 
+        interpolationType++ ) {
+        mixer.setInterpolationType( interpolationType );
+        double voiceFrameTimes[2];
+        for ( int useFloatData = 0; useFloatData < 2; useFloatData++ ) {
+            mixer.setFloatSampleData( useFloatData != 0 );
+            mixer.setAudioSink( &memorySinks[useFloatData] );
+            mixer.assignModule( &module );
+            mixer.renderSong();
+
+            mixer.setAudioSink( &nullSink );
+            double bestTime = 1.0e30;
+            for ( int i = 0; i < BENCH_NR_RUNS; i++ ) {
+                assignSong( mixer,module );
+                auto startTime = std::chrono::steady_clock::now();
+                mixer.renderSong();
+                auto stopTime = std::chrono::steady_clock::now();
+                bestTime = std::min( bestTime,
+                    std::chrono::duration< double >( stopTime - startTime ).count() );
+            }
+            voiceFrameTimes[useFloatData] = bestTime / 
+                (double)std::max( mixer.getNrVoiceFramesMixed(),(std::uint64_t)1 );
+        }
+        const std::vector< float >& output = memorySinks[0].getBuffer();
+        const std::vector< float >& floatOutput = memorySinks[1].getBuffer();
+        std::cout
+            << "\n" << std::left << std::setw( 13 ) << interpolationNames[interpolationType] 
+                << std::right
+            << " | " << std::setw( 23 ) << std::setprecision( 2 ) << voiceFrameTimes[0] * 1.0e9
+            << " | " << std::setw( 22 ) << std::setprecision( 2 ) << voiceFrameTimes[1] * 1.0e9
+            << " | " << std::setw( 8 ) << std::setprecision( 2 ) 
+                << voiceFrameTimes[0] / voiceFrameTimes[1]
+            << " | ";
+        if ( output == floatOutput )
+            std::cout << "identical";
+        else if ( output.size() != floatOutput.size() ) {
+            std::cout << "DIFFERENT length";
+            result = -1;
+        } else {
+            float peak = 1.0e-20f;
+            float maxDifference = 0.0f;
+            for ( std::size_t i = 0; i < output.size(); i++ ) {
+                peak = std::max( peak,fabs( output[i] ) );
+                maxDifference = std::max( maxDifference,fabs( output[i] - floatOutput[i] ) );
+            }
+            std::cout << "max diff " << std::setprecision( 1 ) 
+                << 20.0 * log10( std::max( maxDifference / peak,1.0e-20f ) ) << " dB";
+        }
+    }
+    mixer.setAudioSink( nullptr );
+    std::cout << "\n" << std::defaultfloat;
+    return result;
+}
+
+/*
+    Every file is loaded twice: once as it is, once with its 8 bit samples
+    widened to 16 bit like older versions did at load time. The output of
+    both is compared in a separate run, the click removal at the end of 8
+    bit samples makes it differ a little (see Sample::addSpacersAndTail()).
+*/
+int MixerBenchmark::eightBitSampleData( const std::vector< std::string >& fileNames,int isa )
+{
+    using namespace MixerBenchmarkHelperFn;
+    if ( fileNames.empty() ) {
+        std::cout << "\nThis benchmark needs one or more module files\n";
+        return -1;
+    }
+    Mixer   mixer;
+    mixer.setIsa( isa );
+    NullSink nullSink;
+    mixer.setLatencyProfile( MXR_LATENCY_BATCH );
+    std::cout
+        << "\nRendering with the " << cpuGetIsaName( mixer.getIsa() ) << " routines."
+        << "\n"
+        << "\nFile                 | 16 bit kB | 8 bit kB | Saved | 16 bit ns / voice frame | 8 bit ns / voice frame | Speed up | Output"
+        << "\n---------------------+-----------+----------+-------+-------------------------+------------------------+----------+-----------------"
+        << std::fixed;
+    int result = 0;
+    std::size_t totalDataSizes[2] = { 0,0 };
+    double totalTimes[2] = { 0.0,0.0 };
+    std::uint64_t totalVoiceFrames[2] = { 0,0 };
+    for ( const std::string& fileName : fileNames ) {
+        // modules[0] has its 8 bit samples widened, modules[1] not:
+        Module modules[2];
+        if ( !loadModule( modules[0],fileName ) || !loadModule( modules[1],fileName ) ) {
+            result = -1;
+            continue;
+        }
+        modules[0].widenSampleData();
+        MemorySink memorySinks[2];
+        std::size_t dataSizes[2];
+        double voiceFrameTimes[2];
+        for ( int keep8Bit = 0; keep8Bit < 2; keep8Bit++ ) {
+            Module& module = modules[keep8Bit];
+            dataSizes[keep8Bit] = module.getSampleDataSize();
+            totalDataSizes[keep8Bit] += dataSizes[keep8Bit];
+            mixer.setAudioSink( &memorySinks[keep8Bit] );
+            mixer.assignModule( &module );
+            mixer.renderSong();
+
+            mixer.setAudioSink( &nullSink );
+            double bestTime = 1.0e30;
+            for ( int i = 0; i < BENCH_NR_RUNS; i++ ) {
+                assignSong( mixer,module );
+                auto startTime = std::chrono::steady_clock::now();
+                mixer.renderSong();
+                auto stopTime = std::chrono::steady_clock::now();
+                bestTime = std::min( bestTime,
+                    std::chrono::duration< double >( stopTime - startTime ).count() );
+            }
+            std::uint64_t voiceFrames = std::max( mixer.getNrVoiceFramesMixed(),(std::uint64_t)1 );
+            voiceFrameTimes[keep8Bit] = bestTime / (double)voiceFrames;
+            totalTimes[keep8Bit] += bestTime;
+            totalVoiceFrames[keep8Bit] += voiceFrames;
+        }
+        std::string name = fileName.substr( fileName.find_last_of( "/\\" ) + 1 ).substr( 0,20 );
+        std::cout
+            << "\n" << std::left << std::setw( 20 ) << name << std::right
+            << " | " << std::setw( 9 ) << dataSizes[0] / 1024
+            << " | " << std::setw( 8 ) << dataSizes[1] / 1024
+            << " | " << std::setw( 4 ) << std::setprecision( 0 ) 
+                << 100.0 * (1.0 - (double)dataSizes[1] / (double)std::max( dataSizes[0],(std::size_t)1 ))
+                << "%"
+            << " | " << std::setw( 23 ) << std::setprecision( 2 ) << voiceFrameTimes[0] * 1.0e9
+            << " | " << std::setw( 22 ) << std::setprecision( 2 ) << voiceFrameTimes[1] * 1.0e9
+            << " | " << std::setw( 8 ) << std::setprecision( 2 ) 
+                << voiceFrameTimes[0] / voiceFrameTimes[1]
+            << " | ";
+        const std::vector< float >& output = memorySinks[0].getBuffer();
+        const std::vector< float >& output8 = memorySinks[1].getBuffer();
+        if ( output == output8 )
+            std::cout << "identical";
+        else if ( output.size() != output8.size() ) {
+            std::cout << "DIFFERENT length";
+            result = -1;
+        } else {
+            float peak = 1.0e-20f;
+            float maxDifference = 0.0f;
+            for ( std::size_t i = 0; i < output.size(); i++ ) {
+                peak = std::max( peak,fabs( output[i] ) );
+                maxDifference = std::max( maxDifference,fabs( output[i] - output8[i] ) );
+            }
+            std::cout << "max diff " << std::setprecision( 1 ) 
+                << 20.0 * log10( std::max( maxDifference / peak,1.0e-20f ) ) << " dB";
+        }
+    }
+    mixer.setAudioSink( nullptr );
+    double voiceFrameTimes[2];
+    for ( int keep8Bit = 0; keep8Bit < 2; keep8Bit++ )
+        voiceFrameTimes[keep8Bit] = totalTimes[keep8Bit] / 
+            (double)std::max( totalVoiceFrames[keep8Bit],(std::uint64_t)1 );
+    std::cout
+        << "\n---------------------+-----------+----------+-------+-------------------------+------------------------+----------+-----------------"
+        << "\n" << std::left << std::setw( 20 ) << "All files" << std::right
+        << " | " << std::setw( 9 ) << totalDataSizes[0] / 1024
+        << " | " << std::setw( 8 ) << totalDataSizes[1] / 1024
+        << " | " << std::setw( 4 ) << std::setprecision( 0 ) 
+            << 100.0 * (1.0 - (double)totalDataSizes[1] / 
+                (double)std::max( totalDataSizes[0],(std::size_t)1 ))
+            << "%"
+        << " | " << std::setw( 23 ) << std::setprecision( 2 ) << voiceFrameTimes[0] * 1.0e9
+        << " | " << std::setw( 22 ) << std::setprecision( 2 ) << voiceFrameTimes[1] * 1.0e9
+        << " | " << std::setw( 8 ) << std::setprecision( 2 ) 
+            << voiceFrameTimes[0] / voiceFrameTimes[1]
+        << " |"
+        << "\n" << std::defaultfloat;
+    return result;
+}
+
+/*
+    The output with one thread is the reference: the mixer adds the voices
+    in lanes that do not depend on the nr of threads (see MXR_MIX_LANES), 
+    so every other nr of threads must give exactly the same samples. The
+    speed up can not be larger than the nr of cores the machine has.
+*/
+int MixerBenchmark::threadScaling( const std::string& fileName,int isa )
+{
+    using namespace MixerBenchmarkHelperFn;
+    Module  module;
+    if ( !loadModule( module,fileName ) )
+        return -1;
+
+    const unsigned nrThreadsList[] = { 1,2,4,8 };
+    Mixer   mixer;
+    mixer.setIsa( isa );
+    NullSink nullSink;
+    MemorySink referenceSink;
+    MemorySink memorySink;
+    mixer.setLatencyProfile( MXR_LATENCY_BATCH );
+    mixer.setInterpolationType( MXR_SINC_INTERPOLATION );
+    std::cout
+        << "\nRendering " << fileName << " with sinc interpolation and the "
+        << cpuGetIsaName( mixer.getIsa() ) << " routines on a machine with "
+        << std::thread::hardware_concurrency() << " hardware threads."
+        << "\n"
+        << "\nThreads | Time (ms) | x real time | Speed up | Output"
+        << "\n--------+-----------+-------------+----------+----------"
+        << std::fixed;
+    int result = 0;
+    double singleThreadTime = 0.0;
+    for ( unsigned nrThreads : nrThreadsList ) {
+        mixer.setNrThreads( nrThreads );
+        MemorySink& sink = (nrThreads == 1) ? referenceSink : memorySink;
+        mixer.setAudioSink( &sink );
+        mixer.assignModule( &module );
+        mixer.renderSong();
+        double songTime = (double)sink.getFramesWritten() / (double)mixer.getMixRate();
+
+        mixer.setAudioSink( &nullSink );
+        double bestTime = 1.0e30;
+        for ( int i = 0; i < BENCH_NR_RUNS; i++ ) {
+            assignSong( mixer,module );
+            auto startTime = std::chrono::steady_clock::now();
+            mixer.renderSong();
+            auto stopTime = std::chrono::steady_clock::now();
+            bestTime = std::min( bestTime,
+                std::chrono::duration< double >( stopTime - startTime ).count() );
+        }
+        if ( nrThreads == 1 )
+            singleThreadTime = bestTime;
+        std::cout
+            << "\n" << std::setw( 7 ) << nrThreads
+            << " | " << std::setw( 9 ) << std::setprecision( 1 ) << bestTime * 1000.0
+            << " | " << std::setw( 11 ) << std::setprecision( 1 ) << songTime / bestTime
+            << " | " << std::setw( 8 ) << std::setprecision( 2 ) << singleThreadTime / bestTime
+            << " | ";
+        if ( nrThreads == 1 )
+            std::cout << "reference";
+        else if ( memorySink.getBuffer() == referenceSink.getBuffer() )
+            std::cout << "identical";
+        else {
+            std::cout << "DIFFERENT";
+            result = -1;
+        }
+    }
+    mixer.setNrThreads( 1 );
+    mixer.setAudioSink( nullptr );
+    std::cout << "\n" << std::defaultfloat;
+    return result;
+}
+
+/*
+    The snapshots are saved while the song is mixed from the start, at odd
+    frame nrs so that most fall within a tick. The same mixer then plays 
+    on to the end of the song, and seeks back to each snapshot: the rest
+    of the song must be exactly the same as the first time. Both times
+    the chunks start anew at every snapshot, see appendFrames().
+*/
+int MixerBenchmark::replayStateSnapshots( const std::string& fileName,int isa )
+{
+    using namespace MixerBenchmarkHelperFn;
+    Module  module;
+    if ( !loadModule( module,fileName ) )
+        return -1;
+
+    const int nrSnapshots = 8;
+    Mixer   mixer;
+    mixer.setIsa( isa );
+    mixer.setLatencyProfile( MXR_LATENCY_BATCH );
+    unsigned blockSize = mixer.getBlockSize();
+    std::vector< float > buffer( blockSize * MXR_NR_OUTPUT_CHANNELS );
+    std::vector< float > reference;
+
+    // the length of the song, this starts it over from the beginning:
+    mixer.assignModule( &module );
+    SongAnalysis analysis;
+    if ( mixer.analyzeSong( analysis ) )
+        return -1;
+    const std::uint64_t songLength = analysis.nrFrames;
+
+    ReplayState snapshots[nrSnapshots];
+    std::uint64_t snapshotFrameNrs[nrSnapshots];
+    double saveTimes[nrSnapshots];
+    double replayTimes[nrSnapshots];
+    auto startTime = std::chrono::steady_clock::now();
+    for ( int snapshotNr = 0; snapshotNr < nrSnapshots; snapshotNr++ ) {
+        std::uint64_t frameNr = (songLength * snapshotNr) / nrSnapshots + 7 * snapshotNr;
+        frameNr = std::min( frameNr,songLength - 1 );
+        appendFrames( mixer,buffer,
+            frameNr - reference.size() / MXR_NR_OUTPUT_CHANNELS,reference );
+        auto saveTime = std::chrono::steady_clock::now();
+        replayTimes[snapshotNr] = std::chrono::duration< double >( saveTime - startTime ).count();
+        snapshotFrameNrs[snapshotNr] = frameNr;
+        mixer.saveReplayState( snapshots[snapshotNr] );
+        saveTimes[snapshotNr] = std::chrono::duration< double >( 
+            std::chrono::steady_clock::now() - saveTime ).count();
+        startTime += std::chrono::steady_clock::now() - saveTime;
+    }
+    appendFrames( mixer,buffer,songLength,reference );
+
+    std::cout
+        << "\nSeeking in " << fileName << " (" << std::fixed << std::setprecision( 2 )
+        << (double)songLength / (double)mixer.getMixRate() << " s)"
+        << "\n"
+        << "\nPosition (s) | Order | Row | Snapshot (bytes) | Save (us) | Restore (us) | Replay (ms) | Output"
+        << "\n-------------+-------+-----+------------------+-----------+--------------+-------------+----------";
+    int result = 0;
+    std::vector< float > output;
+    for ( int snapshotNr = 0; snapshotNr < nrSnapshots; snapshotNr++ ) {
+        auto restoreTime = std::chrono::steady_clock::now();
+        int restoreResult = mixer.restoreReplayState( snapshots[snapshotNr] );
+        double restoreDuration = std::chrono::duration< double >( 
+            std::chrono::steady_clock::now() - restoreTime ).count();
+        unsigned orderNr = mixer.getOrderNr();
+        unsigned rowNr = mixer.getRowNr();
+        output.assign( reference.begin(),
+            reference.begin() + snapshotFrameNrs[snapshotNr] * MXR_NR_OUTPUT_CHANNELS );
+        if ( restoreResult == 0 ) {
+            for ( int nextNr = snapshotNr + 1; nextNr < nrSnapshots; nextNr++ )
+                appendFrames( mixer,buffer,
+                    snapshotFrameNrs[nextNr] - snapshotFrameNrs[nextNr - 1],output );
+            appendFrames( mixer,buffer,songLength,output );
+        }
+
+        std::cout
+            << "\n" << std::setw( 12 ) << std::setprecision( 2 )
+                << (double)snapshotFrameNrs[snapshotNr] / (double)mixer.getMixRate()
+            << " | " << std::setw( 5 ) << orderNr
+            << " | " << std::setw( 3 ) << rowNr
+            << " | " << std::setw( 16 ) << snapshots[snapshotNr].getSize()
+            << " | " << std::setw( 9 ) << std::setprecision( 1 ) << saveTimes[snapshotNr] * 1.0e6
+            << " | " << std::setw( 12 ) << std::setprecision( 1 ) << restoreDuration * 1.0e6
+            << " | " << std::setw( 11 ) << std::setprecision( 2 ) << replayTimes[snapshotNr] * 1.0e3
+            << " | ";
+        if ( restoreResult != 0 ) {
+            std::cout << "NOT RESTORED";
+            result = -1;
+        } else if ( output == reference )
+            std::cout << "identical";
+        else {
+            std::cout << "DIFFERENT";
+            result = -1;
+        }
+    }
+    std::cout << "\n" << std::defaultfloat;
+    return result;
+}
+
+/*
+    render() is called until the song ends, for at most one more pass 
+    through the loop if it does not end where the analysis says it does
+*/
+int MixerBenchmark::songAnalysis( const std::vector< std::string >& fileNames,int isa )
+{
+    using namespace MixerBenchmarkHelperFn;
+    if ( fileNames.empty() ) {
+        std::cout << "\nThis benchmark needs one or more module files\n";
+        return -1;
+    }
+    Mixer   mixer;
+    mixer.setIsa( isa );
+    mixer.setLatencyProfile( MXR_LATENCY_BATCH );
+    unsigned blockSize = mixer.getBlockSize();
+    std::vector< float > buffer( blockSize * MXR_NR_OUTPUT_CHANNELS );
+    double mixRate = (double)mixer.getMixRate();
+    std::cout
+        << "\nFile                 | Length (s) | Loops to (s) | Order | Row | Rows | Analyze (ms) | x real time | Render (ms) | render() stops"
+        << "\n---------------------+------------+--------------+-------+-----+------+--------------+-------------+-------------+-----------------"
+        << std::fixed;
+    int result = 0;
+    double totalSongTime = 0.0;
+    double totalAnalysisTime = 0.0;
+    double totalRenderTime = 0.0;
+    for ( const std::string& fileName : fileNames ) {
+        Module module;
+        if ( !loadModule( module,fileName ) ) {
+            result = -1;
+            continue;
+        }
+        mixer.assignModule( &module );
+        SongAnalysis analysis;
+        double bestTime = 1.0e30;
+        for ( int i = 0; i < BENCH_NR_RUNS; i++ ) {
+            auto startTime = std::chrono::steady_clock::now();
+            int analysisResult = mixer.analyzeSong( analysis );
+            auto stopTime = std::chrono::steady_clock::now();
+            if ( analysisResult != 0 )
+                break;
+            bestTime = std::min( bestTime,
+                std::chrono::duration< double >( stopTime - startTime ).count() );
+        }
+        if ( analysis.nrFrames == 0 ) {
+            result = -1;
+            continue;
+        }
+
+        std::uint64_t maxNrFrames = 2 * analysis.nrFrames - analysis.loopFrameNr;
+        std::uint64_t nrFramesRendered = 0;
+        auto startTime = std::chrono::steady_clock::now();
+        while ( !mixer.isSongEnded() && (nrFramesRendered < maxNrFrames) )
+            nrFramesRendered += mixer.render( buffer.data(),blockSize );
+        double renderTime = std::chrono::duration< double >( 
+            std::chrono::steady_clock::now() - startTime ).count();
+
+        double songTime = (double)analysis.nrFrames / mixRate;
+        totalSongTime += songTime;
+        totalAnalysisTime += bestTime;
+        totalRenderTime += renderTime;
+        std::string name = fileName.substr( fileName.find_last_of( "/\\" ) + 1 ).substr( 0,20 );
+        std::cout
+            << "\n" << std::left << std::setw( 20 ) << name << std::right
+            << " | " << std::setw( 10 ) << std::setprecision( 3 ) << songTime
+            << " | " << std::setw( 12 ) << std::setprecision( 3 ) 
+                << (double)analysis.loopFrameNr / mixRate
+            << " | " << std::setw( 5 ) << analysis.loopOrderNr
+            << " | " << std::setw( 3 ) << analysis.loopRowNr
+            << " | " << std::setw( 4 ) << analysis.nrRows
+            << " | " << std::setw( 12 ) << std::setprecision( 3 ) << bestTime * 1000.0
+            << " | " << std::setw( 11 ) << std::setprecision( 0 ) << songTime / bestTime
+            << " | " << std::setw( 11 ) << std::setprecision( 1 ) << renderTime * 1000.0
+            << " | ";
+        if ( mixer.isSongEnded() && (nrFramesRendered == analysis.nrFrames) )
+            std::cout << "at the loop";
+        else {
+            std::cout << "DIFFERENT";
+            result = -1;
+        }
+    }
+    std::cout
+        << "\n---------------------+------------+--------------+-------+-----+------+--------------+-------------+-------------+-----------------"
+        << "\n" << std::left << std::setw( 20 ) << "All files" << std::right
+        << " | " << std::setw( 10 ) << std::setprecision( 3 ) << totalSongTime
+        << " |              |       |     |     "
+        << " | " << std::setw( 12 ) << std::setprecision( 3 ) << totalAnalysisTime * 1000.0
+        << " | " << std::setw( 11 ) << std::setprecision( 0 ) 
+            << totalSongTime / std::max( totalAnalysisTime,1.0e-9 )
+        << " | " << std::setw( 11 ) << std::setprecision( 1 ) << totalRenderTime * 1000.0
+        << " |"
+        << "\n" << std::defaultfloat;
+    return result;
+}
+
+/*
+    The replay to each position is chunked as buildSeekIndex() and seek() 
+    chunk the song: in blocks that start anew at every keyframe, so that 
+    the output after the seek is exactly the same. One second of it is 
+    compared.
+*/
+int MixerBenchmark::seekIndex( const std::string& fileName,int isa )
+{
+    using namespace MixerBenchmarkHelperFn;
+    Module  module;
+    if ( !loadModule( module,fileName ) )
+        return -1;
+
+    const int nrSeeks = 8;
+    Mixer   mixer;
+    mixer.setIsa( isa );
+    mixer.setLatencyProfile( MXR_LATENCY_BATCH );
+    mixer.assignModule( &module );
+    unsigned blockSize = mixer.getBlockSize();
+    unsigned mixRate = mixer.getMixRate();
+    std::vector< float > buffer( blockSize * MXR_NR_OUTPUT_CHANNELS );
+
+    auto startTime = std::chrono::steady_clock::now();
+    if ( mixer.buildSeekIndex() )
+        return -1;
+    double buildTime = std::chrono::duration< double >( 
+        std::chrono::steady_clock::now() - startTime ).count();
+    const SeekIndex& seekIndex = module.getSeekIndex();
+    const std::uint64_t interval = seekIndex.getInterval();
+    SongAnalysis analysis;
+    mixer.analyzeSong( analysis );
+    const std::uint64_t songLength = analysis.nrFrames;
+
+    std::cout
+        << "\nSeeking in " << fileName << " (" << std::fixed << std::setprecision( 2 )
+        << (double)songLength / (double)mixRate << " s)"
+        << "\nSeek index: " << seekIndex.getNrKeyframes() << " keyframes, one every "
+        << interval / mixRate << " s, " << seekIndex.getSize() / 1024 << " kB, built in "
+        << buildTime * 1.0e3 << " ms"
+        << "\n"
+        << "\nPosition (s) | Keyframe (s) | Seek (ms) | Replay (ms) | Faster | Output"
+        << "\n-------------+--------------+-----------+-------------+--------+----------";
+    std::mt19937 randomGenerator( 1234 );
+    std::uniform_int_distribution< std::uint64_t > distribution( 0,songLength - 1 );
+    int result = 0;
+    double maxSeekTime = 0.0;
+    std::vector< float > reference;
+    std::vector< float > output;
+    for ( int seekNr = 0; seekNr < nrSeeks; seekNr++ ) {
+        std::uint64_t frameNr = distribution( randomGenerator );
+        std::uint64_t keyframeNr = seekIndex.findKeyframe( frameNr )->frameNr;
+
+        reference.clear();
+        mixer.assignModule( &module );
+        startTime = std::chrono::steady_clock::now();
+        for ( std::uint64_t nextKeyframeNr = interval; 
+            nextKeyframeNr <= keyframeNr; nextKeyframeNr += interval )
+            appendFrames( mixer,buffer,
+                nextKeyframeNr - reference.size() / MXR_NR_OUTPUT_CHANNELS,reference );
+        appendFrames( mixer,buffer,frameNr - keyframeNr,reference );
+        double replayTime = std::chrono::duration< double >( 
+            std::chrono::steady_clock::now() - startTime ).count();
+        reference.clear();
+        appendFrames( mixer,buffer,mixRate,reference );
+
+        double seekTime = 1.0e30;
+        for ( int i = 0; i < BENCH_NR_RUNS; i++ ) {
+            startTime = std::chrono::steady_clock::now();
+            mixer.seek( frameNr );
+            seekTime = std::min( seekTime,std::chrono::duration< double >( 
+                std::chrono::steady_clock::now() - startTime ).count() );
+        }
+        maxSeekTime = std::max( maxSeekTime,seekTime );
+        output.clear();
+        appendFrames( mixer,buffer,mixRate,output );
+
+        std::cout
+            << "\n" << std::setw( 12 ) << std::setprecision( 2 ) << (double)frameNr / mixRate
+            << " | " << std::setw( 12 ) << (double)keyframeNr / mixRate
+            << " | " << std::setw( 9 ) << std::setprecision( 3 ) << seekTime * 1.0e3
+            << " | " << std::setw( 11 ) << replayTime * 1.0e3
+            << " | " << std::setw( 6 ) << std::setprecision( 1 ) 
+                << replayTime / std::max( seekTime,1.0e-9 )
+            << " | ";
+        if ( output == reference )
+            std::cout << "identical";
+        else {
+            std::cout << "DIFFERENT";
+            result = -1;
+        }
+    }
+    std::cout
+        << "\n\nSlowest seek: " << std::setprecision( 3 ) << maxSeekTime * 1.0e3 << " ms"
+        << "\n" << std::defaultfloat;
+    return result;
+}
@@ -0,0 +1,138 @@
+#pragma once
+// Benchmarks for the mixer, run from the command line with -bench=<name>
+
+#include <string>
+#include <vector>
+
+/*
+    Each benchmark loads the module file, runs and prints a table with the
+    results. They return 0 on success, -1 if the file could not be loaded.
+*/
+namespace MixerBenchmark {
+    /*
+        Runs the benchmark with the given name, or lists the available
+        benchmarks if there is no benchmark with that name. Only the 
+        benchmarks that run on a corpus take more than one file. The
+        benchmarks mix with the routines of instruction set isa, see 
+        cpuSelectIsa(), the ones that compare routines leave out those
+        of a higher instruction set.
+    */
+    int             run( 
+        const std::string& benchmarkName,const std::vector< std::string >& fileNames,int isa );
+
+    /*
+        Time needed to mix the same stretch of the song with block sizes 
+        from 64 to 65536 frames, and the estimated fixed cost per block.
+    */
+    int             blockSize( const std::string& fileName,int isa );
+
+    /*
+        Renders the song at mix rates from 22050 to 192000 Hz. Fails if the
+        song length or the position step of a voice at the end of the song
+        differs from the one at the default rate.
+    */
+    int             mixRate( const std::string& fileName,int isa );
+
+    /*
+        Renders the song with each interpolation type and prints the time
+        needed per voice per frame, and how many voices one core could mix
+        in real time. Frames per call is the average nr of frames a mixing
+        routine mixes in one go: songs with short sample loops show the 
+        fixed cost of every call.
+    */
+    int             voiceCost( const std::string& fileName,int isa );
+
+    /*
+        Mixes the song in blocks of 64 frames up to the default block size,
+        and prints the average and the peak nr of voices and the time per 
+        block, per frame and per voice frame. The mixer only visits the 
+        voices that play, so the cost per block should follow the nr of 
+        voices rather than the 256 mixer channels: compare a 4 channel MOD
+        with a 64 channel IT.
+    */
+    int             polyphony( const std::string& fileName,int isa );
+
+    /*
+        Speed of the scalar and AVX2 cubic interpolation routines, in ns per
+        frame and voices per core, their signal to noise ratio, and whether
+        their output is identical, for 16 bit and for float sample data. 
+        Works on generated sample data, so it needs no file.
+    */
+    int             cubicInterpolation( int isa );
+
+    /*
+        The same for the scalar, SSE2 and AVX2 sinc interpolation routines,
+        with the other interpolation types for comparison.
+    */
+    int             sincInterpolation( int isa );
+
+    /*
+        Time per tick needed to get the value of an envelope by searching
+        its nodes, against reading it from the table rasterized at load 
+        time, and whether both give the same values. Uses the envelopes of
+        the module, or generated ones if no file is given.
+    */
+    int             envelopes( const std::string& fileName );
+
+    /*
+        Time per channel per tick for the period and frequency conversions
+        of effects such as arpeggio, vibrato and portamento, with the
+        tables in PeriodTable.h and with pow(). Also checks that the tables
+        give the same values. Needs no file.
+    */
+    int             periodConversion();
+
+    /*
+        Renders the song with each interpolation type from the 16 bit 
+        sample data and from the float copy (see Sample::createFloatData()),
+        and prints the time per voice frame, the memory the sample data 
+        takes and how much the output differs.
+    */
+    int             sampleData( const std::string& fileName,int isa );
+
+    /*
+        For every file and for all of them together: the memory the sample
+        data takes and the time per voice frame, with the 8 bit samples 
+        kept as 8 bit (see Sample::get8BitData()) and widened to 16 bit, 
+        and how much the output differs. Run it on a corpus of MOD and S3M
+        files to see what keeping them resident costs.
+    */
+    int             eightBitSampleData( const std::vector< std::string >& fileNames,int isa );
+
+    /*
+        Renders the song with sinc interpolation on 1, 2, 4 and 8 mixer 
+        threads (see Mixer::setNrThreads()), and prints the time, how much
+        faster than real time and than one thread it is, and whether the 
+        output is the same as with one thread.
+    */
+    int             threadScaling( const std::string& fileName,int isa );
+
+    /*
+        Saves replay state snapshots (see Mixer::saveReplayState()) at 
+        eight points in the song, and prints their size, the time it takes
+        to save and restore them against the time it takes to replay the
+        song up to there, and whether the song plays on from a restored 
+        snapshot exactly as it did the first time.
+    */
+    int             replayStateSnapshots( const std::string& fileName,int isa );
+
+    /*
+        For every file: the length and the loop point that 
+        Mixer::analyzeSong() finds, the time it takes against the time it
+        takes to render the song, and whether render() stops where the 
+        analysis said it would. Run it on a corpus to see how fast a whole
+        archive can be indexed.
+    */
+    int             songAnalysis( const std::vector< std::string >& fileNames,int isa );
+
+    /*
+        Builds the seek index of the song (see Mixer::buildSeekIndex()) and
+        prints the time that takes and the size of the keyframes. Then 
+        seeks to random positions with Mixer::seek(), and prints the time 
+        each seek takes against replaying the song up to there, and whether
+        the song plays on exactly as it does after the replay.
+    */
+    int             seekIndex( const std::string& fileName,int isa );
+
+
+}
@@ -1,7 +1,19 @@
 #pragma once
 
+#ifdef _WIN32
 #define NOMINMAX
 #include <windows.h> // for the color constants
+#else
+// the windows console color bits, the debug output ignores them elsewhere:
+const int FOREGROUND_BLUE         = 0x01;
+const int FOREGROUND_GREEN        = 0x02;
+const int FOREGROUND_RED          = 0x04;
+const int FOREGROUND_INTENSITY    = 0x08;
+const int BACKGROUND_BLUE         = 0x10;
+const int BACKGROUND_GREEN        = 0x20;
+const int BACKGROUND_RED          = 0x40;
+const int BACKGROUND_INTENSITY    = 0x80;
+#endif
 #include <cstdint>
 
 // color constants for functions that show debug info
@@ -33,6 +45,16 @@ const int BACKGROUND_LIGHTMAGENTA = (BACKGROUND_MAGENTA     | BACKGROUND_INTENSI
 const int BACKGROUND_YELLOW       = (BACKGROUND_BROWN       | BACKGROUND_INTENSITY);
 const int BACKGROUND_WHITE        = (BACKGROUND_LIGHTGRAY   | BACKGROUND_INTENSITY);
 
+// changes the color of the debug output, only in the windows console:
+inline void setConsoleTextColor( int color )
+{
+#ifdef _WIN32
+    SetConsoleTextAttribute( GetStdHandle( STD_OUTPUT_HANDLE ),(WORD)color );
+#else
+    (void)color;
+#endif
+}
+
 // for debugging only:
 const char* const noteStrings[] = { // 2 + MAXIMUM_NOTES entries
     "---",
@@ -168,6 +190,12 @@ const int S3M_SET_PATTERN_LOOP             = 0xB; // S3M effect SB
 const int S3M_NOTE_CUT                     = 0xC; // S3M effect SC
 const int S3M_NOTE_DELAY                   = 0xD; // S3M effect SD
 const int S3M_PATTERN_DELAY                = 0xE; // S3M effect SE, end of S3M extended effects
+const int IT_NNA_CONTROL                   = 0x7; // IT effect S7
+const int IT_PAST_NOTE_CUT                 = 0x0; // IT effect S70
+const int IT_PAST_NOTE_FADE                = 0x2; // IT effect S72
+const int IT_SET_NNA_NOTE_CUT              = 0x3; // IT effect S73
+const int IT_SET_NNA_NOTE_FADE             = 0x6; // IT effect S76
+
 const int SET_TEMPO                        = 0xF; 
 const int SET_GLOBAL_VOLUME                = 0x10;// XM effect G
 const int GLOBAL_VOLUME_SLIDE              = 0x11;// XM effect H
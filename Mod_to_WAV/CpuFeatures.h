@@ -0,0 +1,124 @@
+#pragma once
+// Run time detection of the instruction set extensions the mixer can use
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+/*
+    The instruction sets the mixing routines are written for, from slow to
+    fast. Each level includes the ones below it.
+*/
+const int CPU_ISA_SCALAR    = 0;
+const int CPU_ISA_SSE2      = 1;
+const int CPU_ISA_SSE41     = 2;
+const int CPU_ISA_AVX2      = 3;
+const int CPU_NR_ISAS       = 4;
+
+/*
+    Set this environment variable to scalar, sse2, sse4.1 or avx2 to limit
+    the instruction set the mixer uses, e.g. to compare the speed of the
+    mixing routines on the same machine.
+*/
+const char CPU_ISA_ENVIRONMENT_VARIABLE[] = "MXR_ISA";
+
+/*
+    Functions that use SSE4.1 or AVX2 intrinsics must be marked with
+    MXR_TARGET_SSE41 or MXR_TARGET_AVX2. GCC and Clang only allow these
+    intrinsics in functions that are compiled for them, while the rest of
+    the program must still run on cpu's without them. Visual Studio accepts
+    the intrinsics anywhere. SSE2 is part of every x64 cpu.
+*/
+#if defined( __GNUC__ ) || defined( __clang__ )
+#define MXR_TARGET_SSE41 __attribute__(( target( "sse4.1" ) ))
+#define MXR_TARGET_AVX2 __attribute__(( target( "avx2" ) ))
+#else
+#define MXR_TARGET_SSE41
+#define MXR_TARGET_AVX2
+#endif
+
+/*
+    Returns the best instruction set that both the cpu and the operating
+    system support (for AVX2 the OS has to save the 256 bit registers on a
+    task switch).
+*/
+inline int cpuGetSupportedIsa()
+{
+#if defined( __GNUC__ ) || defined( __clang__ )
+    __builtin_cpu_init();
+    if ( __builtin_cpu_supports( "avx2" ) )
+        return CPU_ISA_AVX2;
+    if ( __builtin_cpu_supports( "sse4.1" ) )
+        return CPU_ISA_SSE41;
+    if ( __builtin_cpu_supports( "sse2" ) )
+        return CPU_ISA_SSE2;
+    return CPU_ISA_SCALAR;
+#elif defined( _MSC_VER )
+    int regs[4];
+    __cpuid( regs,0 );
+    int maxLeaf = regs[0];
+    __cpuid( regs,1 );
+    if ( !(regs[3] & (1 << 26)) )                       // SSE2
+        return CPU_ISA_SCALAR;
+    if ( !(regs[2] & (1 << 19)) )                       // SSE4.1
+        return CPU_ISA_SSE2;
+    bool osSavesYmm = (regs[2] & (1 << 27)) &&          // OSXSAVE
+        ((_xgetbv( 0 ) & 0x6) == 0x6);                  // XMM and YMM state
+    if ( !osSavesYmm || (maxLeaf < 7) )
+        return CPU_ISA_SSE41;
+    __cpuidex( regs,7,0 );
+    return (regs[1] & (1 << 5)) ? CPU_ISA_AVX2 : CPU_ISA_SSE41;
+#else
+    return CPU_ISA_SCALAR;
+#endif
+}
+
+inline const char* cpuGetIsaName( int isa )
+{
+    static const char* isaNames[CPU_NR_ISAS] = { "scalar","sse2","sse4.1","avx2" };
+    return ((isa >= 0) && (isa < CPU_NR_ISAS)) ? isaNames[isa] : "unknown";
+}
+
+/*
+    Returns -1 if the name is not one of the names above
+*/
+inline int cpuGetIsaByName( const char* name )
+{
+    for ( int isa = 0; isa < CPU_NR_ISAS; isa++ )
+        if ( strcmp( name,cpuGetIsaName( isa ) ) == 0 )
+            return isa;
+    return -1;
+}
+
+/*
+    The instruction set to mix with: the best supported one, limited to 
+    requestedIsa (-1 for no limit, e.g. from a command line option) or else
+    to the one the MXR_ISA environment variable names. A request for more 
+    than the cpu supports is ignored. Meant to be called once, by main(), 
+    which hands the result to its mixers with Mixer::setIsa(): it prints 
+    why a request is ignored.
+*/
+inline int cpuSelectIsa( int requestedIsa )
+{
+    int isa = cpuGetSupportedIsa();
+    if ( requestedIsa < 0 ) {
+        const char* name = getenv( CPU_ISA_ENVIRONMENT_VARIABLE );
+        if ( name != nullptr ) {
+            requestedIsa = cpuGetIsaByName( name );
+            if ( requestedIsa < 0 )
+                std::cout << "\nUnknown instruction set in "
+                    << CPU_ISA_ENVIRONMENT_VARIABLE << ": " << name << "\n";
+        }
+    }
+    if ( requestedIsa > isa )
+        std::cout << "\nThis cpu does not support " << cpuGetIsaName( requestedIsa )
+            << ", using " << cpuGetIsaName( isa ) << "\n";
+    else if ( requestedIsa >= 0 )
+        isa = requestedIsa;
+    return isa;
+}
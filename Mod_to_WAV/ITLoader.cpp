@@ -26,11 +26,14 @@ ranges, however most other players have no problems with the following:
 This code requires a byte to be 8 bits wide
 #endif
 
+#ifdef _WIN32
 #define NOMINMAX
 #include <windows.h>
 #include <conio.h>
 #include <mmsystem.h>
 #pragma comment (lib, "winmm.lib") 
+#endif
+#include <cmath>
 #include <iostream>
 #include <fstream>
 #include <vector>
@@ -652,6 +655,8 @@ int Module::loadItInstrument(
     }
     // tell the envelope functions we want IT style envelope processing:
     instrumentHeader.volumeEnvelope.setEnvelopeStyle( itEnvelopeStyle );
+    instrumentHeader.panningEnvelope.setEnvelopeStyle( itEnvelopeStyle );
+    instrumentHeader.pitchFltrEnvelope.setEnvelopeStyle( itEnvelopeStyle );
 
     // create the instrument
     instruments_[instrumentNr] = std::make_unique <Instrument>( instrumentHeader );
@@ -1379,44 +1384,38 @@ void ItDebugShow::pattern( Pattern& pattern )
     for ( unsigned rowNr = 0; rowNr < pattern.getnRows(); rowNr++ ) {
         std::cout << "\n";
         for ( int channelNr = 0; channelNr < IT_DEBUG_SHOW_MAX_CHN; channelNr++ ) {
-            // colors in console requires weird shit in windows
-            HANDLE hStdin = GetStdHandle( STD_INPUT_HANDLE );
-            HANDLE hStdout = GetStdHandle( STD_OUTPUT_HANDLE );
-            CONSOLE_SCREEN_BUFFER_INFO csbiInfo;
-            GetConsoleScreenBufferInfo( hStdout,&csbiInfo );
-            // **************************************************
             Note noteData = pattern.getNote( rowNr * nChannels_ + channelNr );
             unsigned note = noteData.note;
             unsigned instrument = noteData.instrument;
 
             // display note
-            SetConsoleTextAttribute( hStdout,FOREGROUND_LIGHTGRAY );
+            setConsoleTextColor( FOREGROUND_LIGHTGRAY );
             std::cout << "|";
-            SetConsoleTextAttribute( hStdout,FOREGROUND_LIGHTCYAN );
+            setConsoleTextColor( FOREGROUND_LIGHTCYAN );
 
             if ( note <= MAXIMUM_NOTES ) std::cout << noteStrings[note];
             else if ( note == KEY_OFF ) std::cout << "===";
             else if ( note == KEY_NOTE_CUT ) std::cout << "^^^";
             else std::cout << "--\\"; // KEY_NOTE_FADE
             /*
-            SetConsoleTextAttribute( hStdout,FOREGROUND_LIGHTGRAY );
+            setConsoleTextColor( FOREGROUND_LIGHTGRAY );
             std::cout << std::setw( 5 ) << noteToPeriod( note,channel.pSample->getFinetune() );
 
-            SetConsoleTextAttribute( hStdout,FOREGROUND_LIGHTBLUE );
+            setConsoleTextColor( FOREGROUND_LIGHTBLUE );
             std::cout << "," << std::setw( 5 ) << channel.period;
 
-            SetConsoleTextAttribute( hStdout,FOREGROUND_LIGHTMAGENTA );
+            setConsoleTextColor( FOREGROUND_LIGHTMAGENTA );
             std::cout << "," << std::setw( 5 ) << channel.portaDestPeriod;
             */
             // display instrument
-            SetConsoleTextAttribute( hStdout,FOREGROUND_YELLOW );
+            setConsoleTextColor( FOREGROUND_YELLOW );
             if ( instrument )
                 std::cout << std::dec << std::setw( 2 ) << instrument;
             else 
                 std::cout << "  ";
             /*
             // display volume column
-            SetConsoleTextAttribute( hStdout,FOREGROUND_GREEN | FOREGROUND_INTENSITY );
+            setConsoleTextColor( FOREGROUND_GREEN | FOREGROUND_INTENSITY );
             if ( iNote->effects[0].effect )
             std::cout << std::hex << std::uppercase
             << std::setw( 1 ) << iNote->effects[0].effect
@@ -1425,27 +1424,27 @@ void ItDebugShow::pattern( Pattern& pattern )
             */
             /*
             // display volume:
-            SetConsoleTextAttribute( hStdout,FOREGROUND_GREEN | FOREGROUND_INTENSITY );
+            setConsoleTextColor( FOREGROUND_GREEN | FOREGROUND_INTENSITY );
             std::cout << std::hex << std::uppercase
             << std::setw( 2 ) << channel.volume;
             */
 
             /*
             // effect
-            SetConsoleTextAttribute( hStdout,FOREGROUND_LIGHTGRAY );
+            setConsoleTextColor( FOREGROUND_LIGHTGRAY );
             for ( unsigned fxloop = 1; fxloop < MAX_EFFECT_COLUMNS; fxloop++ ) {
             if ( noteData.effects[fxloop].effect )
             std::cout
             << std::hex << std::uppercase
             << std::setw( 2 ) << noteData.effects[fxloop].effect;
             else std::cout << "--";
-            SetConsoleTextAttribute( hStdout,FOREGROUND_BROWN );
+            setConsoleTextColor( FOREGROUND_BROWN );
             std::cout
             << std::setw( 2 ) << (noteData.effects[fxloop].argument)
             << std::dec;
             }
             */
-            SetConsoleTextAttribute( hStdout,FOREGROUND_LIGHTGRAY );
+            setConsoleTextColor( FOREGROUND_LIGHTGRAY );
         }
     }
 }
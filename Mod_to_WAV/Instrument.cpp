@@ -2,10 +2,8 @@
 #include <iostream>
 #include <cassert>
 
-#include "constants.h"
-#include "instrument.h"
-
-bool Envelope::envelopeStyle_;
+#include "Constants.h"
+#include "Instrument.h"
 
 Instrument::Instrument( const InstrumentHeader &instrumentHeader ) 
 {
@@ -52,6 +50,9 @@ Instrument::Instrument( const InstrumentHeader &instrumentHeader )
     volumeEnvelope_         = instrumentHeader.volumeEnvelope;
     panningEnvelope_        = instrumentHeader.panningEnvelope;
     pitchFltrEnvelope_      = instrumentHeader.pitchFltrEnvelope;
+    volumeEnvelope_.rasterize();
+    panningEnvelope_.rasterize();
+    pitchFltrEnvelope_.rasterize();
 
     if ( volumeEnvelope_.isEnabled() ) {
         std::cout
@@ -15,6 +15,8 @@ unsigned char   randPanningVariation;// not implemented
 
 
 #include <string>
+#include <vector>
+#include <cstdint>
 #include <cassert>
 
 // both below are for debugging:
@@ -22,7 +24,7 @@ unsigned char   randPanningVariation;// not implemented
 #include <iomanip>
 
 
-#include "constants.h"
+#include "Constants.h"
 
 
 const bool xmEnvelopeStyle = true;
@@ -194,11 +196,53 @@ public:
         if ( !isEnabled() )
             return MAX_VOLUME;
 
+        if ( isRasterized() ) {
+            if ( envelopeStyle_ == xmEnvelopeStyle )
+                return getRasterizedXmEnvelopeVal( frameNr,keyIsReleased );
+            else
+                return getRasterizedItEnvelopeVal( frameNr,keyIsReleased );
+        }
+        return getEnvelopeValFromNodes( frameNr,keyIsReleased );
+    }
+    /*
+        The same, but searches the nodes for every call. For envelopes that
+        could not be rasterized, and to benchmark against.
+    */
+    int         getEnvelopeValFromNodes( unsigned& frameNr,bool keyIsReleased ) const
+    {
+        if ( !isEnabled() )
+            return MAX_VOLUME;
+
         if ( envelopeStyle_ == xmEnvelopeStyle )
             return getXmEnvelopeVal( frameNr,keyIsReleased );
-        else 
+        else
             return getItEnvelopeVal( frameNr,keyIsReleased );
     }
+
+    /*
+        Computes the value of the envelope for every tick up to its last
+        node, so that getEnvelopeVal() needs neither the node search nor
+        the divide. Instrument does this when it is created. The table
+        holds exactly what getInterpolatedVal() returns, plus the value of
+        the last node for all ticks beyond it. Envelopes whose nodes are not
+        in order are left to the node search.
+    */
+    void        rasterize()
+    {
+        rasterizedVals_.clear();
+        if ( nrNodes <= 1 )
+            return;
+        for ( int nodeNr = 1; nodeNr < nrNodes; nodeNr++ )
+            if ( nodes[nodeNr].x < nodes[nodeNr - 1].x )
+                return;
+        unsigned lastFrameNr = nodes[nrNodes - 1].x;
+        rasterizedVals_.resize( lastFrameNr + 2 );
+        for ( unsigned frameNr = 0; frameNr <= lastFrameNr; frameNr++ )
+            rasterizedVals_[frameNr] = (std::int16_t)getInterpolatedVal( frameNr );
+        rasterizedVals_[lastFrameNr + 1] = nodes[nrNodes - 1].y;
+    }
+    bool        isRasterized() const { return !rasterizedVals_.empty(); }
+    unsigned    getRasterizedLength() const { return (unsigned)rasterizedVals_.size(); }
     bool        isLastNode( int nodeNr ) const  
     {
         if ( nrNodes <= 1 )
@@ -318,6 +362,8 @@ public:
                     frameNr = nodes[sustainStart].x;
                     return nodes[sustainStart].y;
                 }
+                // not at the sustain point yet:
+                return getInterpolatedVal( frameNr );
             }
         }
         return 0; // to get rid of compiler warning
@@ -349,6 +395,72 @@ public:
         return getInterpolatedVal( frameNr );
     }
 
+    /*
+        The rasterized versions of the functions above: they give the same
+        values and move frameNr the same way. As the nodes are in order,
+        getPrecedingNode( frameNr ) >= nodeNr is a comparison with the x of
+        that node, see isPastNode().
+    */
+    int         getRasterizedVal( unsigned frameNr ) const
+    {
+        unsigned lastIdx = (unsigned)rasterizedVals_.size() - 1;
+        return rasterizedVals_[frameNr < lastIdx ? frameNr : lastIdx];
+    }
+    bool        isPastNode( unsigned frameNr,int nodeNr ) const
+    {
+        if ( nodeNr >= nrNodes )
+            return false;
+        return (nodeNr == 0) || (frameNr > nodes[nodeNr].x);
+    }
+    int         getRasterizedXmEnvelopeVal( unsigned& frameNr,bool keyIsReleased ) const
+    {
+        bool checkSustain = isSustained() && (!keyIsReleased);
+        bool xmSustainRule = sustainStart == loopEnd;
+        int lastNode = nrNodes - 1;
+
+        if ( isLooped() ) {
+            if ( !checkSustain ) {
+                if ( xmSustainRule && isSustained() ) {
+                    if ( !isPastNode( frameNr,lastNode ) )
+                        return getRasterizedVal( frameNr );
+                    frameNr = nodes[lastNode].x;
+                    return nodes[lastNode].y;
+                }
+                if ( isPastNode( frameNr,loopEnd ) )
+                    frameNr = nodes[loopStart].x;
+                return getRasterizedVal( frameNr );
+            }
+            if ( isPastNode( frameNr,sustainStart ) && (!xmSustainRule) ) {
+                frameNr = nodes[sustainStart].x;
+                return nodes[sustainStart].y;
+            }
+            if ( isPastNode( frameNr,loopEnd ) )
+                frameNr = nodes[loopStart].x + frameNr - nodes[loopEnd].x;
+            return getRasterizedVal( frameNr );
+        }
+        if ( !checkSustain ) {
+            if ( !isPastNode( frameNr,lastNode ) )
+                return getRasterizedVal( frameNr );
+            frameNr = nodes[lastNode].x;
+            return nodes[lastNode].y;
+        }
+        if ( isPastNode( frameNr,sustainStart ) ) {
+            frameNr = nodes[sustainStart].x;
+            return nodes[sustainStart].y;
+        }
+        return getRasterizedVal( frameNr );
+    }
+    int         getRasterizedItEnvelopeVal( unsigned& frameNr,bool keyIsReleased ) const
+    {
+        if ( isSustained() && (!keyIsReleased) ) {
+            if ( isPastNode( frameNr,sustainEnd ) )
+                frameNr = nodes[sustainStart].x;
+        }
+        else if ( isLooped() && isPastNode( frameNr,loopEnd ) )
+            frameNr = nodes[loopStart].x;
+        return getRasterizedVal( frameNr );
+    }
+
     void        setFlags( unsigned char flags ) 
     { 
         flags_ = flags & 
@@ -398,10 +510,12 @@ public:
 
 private:
     unsigned char   flags_ = 0;
-    static bool     envelopeStyle_;
+    bool            envelopeStyle_ = itEnvelopeStyle;
+    std::vector< std::int16_t > rasterizedVals_;    // one per tick, see rasterize()
 };
 
 
+
 class VibratoConfig {
 public:
     unsigned char   type = 0;
@@ -466,6 +580,8 @@ public:
     unsigned char   getNnaType() const { return nnaType_; }
     unsigned char   getDctType() const { return dctType_; }
     unsigned char   getDcaType() const { return dcaType_; }
+    unsigned        getVolumeFadeOut() const { return volumeFadeOut_; }
+
     const Envelope& getVolumeEnvelope() const { return volumeEnvelope_; }
     const Envelope& getPanningEnvelope() const { return panningEnvelope_; }
     const Envelope& getPitchFltrEnvelope() const { return pitchFltrEnvelope_; }
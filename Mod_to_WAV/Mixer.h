@@ -1,27 +1,19 @@
 #pragma once
 // Floating point mixer
 
-#include <conio.h>
-
 #include <climits>
 #if CHAR_BIT != 8 
 This code requires a byte to be 8 bits wide
 #endif
 
-#pragma comment (lib,"winmm.lib") 
-
-#define NOMINMAX
-#include <windows.h>
 #include <algorithm>
-
-#include <mmreg.h>
 #include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
 #include <assert.h>
 #include <functional>
-#include <mmsystem.h>
-#include <mmreg.h>
-#include <ks.h>
-#include <Ksmedia.h>
 
 
 // FOR SSE 4.1 mixing routines:
@@ -32,7 +24,7 @@ This code requires a byte to be 8 bits wide
 #include <smmintrin.h>
 #include <immintrin.h>
 
-#define ALIGNED __declspec(align(16)) // for SSE mixing
+#define ALIGNED alignas(16) // for SSE mixing
 
 // Some helper macros: _mm_set_* functions pass arguments in reverse
 // order, which is really confusing.
@@ -49,6 +41,12 @@ This code requires a byte to be 8 bits wide
 #include "Instrument.h"
 #include "Sample.h"
 #include "Module.h"
+#include "AudioSink.h"
+#include "CpuFeatures.h"
+#include "ReplayState.h"
+#include "SincTable.h"
+#include "PeriodTable.h"
+#include "MixerWorkerPool.h"
 
 #define debug_mixer   // enable to get pattern debuginfo :)
 #define enable_volume_ramps
@@ -63,6 +61,12 @@ This code requires a byte to be 8 bits wide
 const bool  MXR_VOLUME_RAMP_UP                  = false;
 const bool  MXR_VOLUME_RAMP_DOWN                = true;
 const int   MXR_VOLUME_RAMP_MAX_STEPS = 160;
+/*
+    A voice that fades out (IT note fade) starts at this fade out level,
+    each tick it goes down by the fade out speed of its instrument. The
+    loaders scale the speed to this range.
+*/
+const int   MXR_MAX_FADE_OUT = 65535;
 const float MXR_VOLUME_RAMP_STEP_SIZE = (float)MAX_VOLUME / 
                         ((float)MXR_VOLUME_RAMP_MAX_STEPS * (float)MAX_VOLUME);
 const int   MXR_PANNING_FULL_LEFT               = 0;
@@ -70,9 +74,24 @@ const int   MXR_PANNING_CENTER                  = 127;
 const int   MXR_PANNING_FULL_RIGHT              = 255;
 const int   MXR_NO_PHYSICAL_CHANNEL_ATTACHED    = -1;
 
-// below is wrong, should be 44100, not * 2
-const float MXR_MIN_FREQUENCY_INC = 00002.26757e-4f; // 20 Hz == 20 / (44100 * 2)
-const float MXR_EPSILON = 1.0e-19f;
+/*
+    Channels that play slower than this are not mixed (div by zero safety).
+    The minimum position step is MXR_MIN_FREQUENCY / mix rate.
+*/
+const float MXR_MIN_FREQUENCY = 10.0f;   // in Hz
+
+/*
+    Sample positions and the position step per frame (frequency / mix rate)
+    are 32.32 fixed point numbers: the sample index in the upper 32 bits,
+    the fraction in the lower 32 bits. Unlike a float position, they don't
+    drift when they are added up over long blocks, and the loop boundaries
+    are exact. The interpolators use the upper MXR_FRACTION_BITS bits of 
+    the fraction, which convert to float without rounding.
+*/
+const int   MXR_POSITION_FRACTION_BITS = 32;
+const std::int64_t MXR_POSITION_ONE = (std::int64_t)1 << MXR_POSITION_FRACTION_BITS;
+const int   MXR_FRACTION_BITS = 24;
+const float MXR_FRACTION_SCALE = 1.0f / (float)(1 << MXR_FRACTION_BITS);
 
 /*
 possible flags:
@@ -100,19 +119,74 @@ const int   MXR_CHANNEL_IS_DYING_FLAG           = 512;
 *   GLOBAL CONSTANTS FOR THE MIXER:                                       *
 *                                                                         *
 **************************************************************************/
-const int MXR_MIXRATE = 44100;          // in Hz                                            
+/*
+    The mix rate can be changed at run time with Mixer::setMixRate(), the
+    tick length and the sample increments follow it.
+*/
+const int MXR_DEFAULT_MIXRATE = 44100;  // in Hz
+const int MXR_MIN_MIXRATE = 22050;
+const int MXR_MAX_MIXRATE = 192000;
 const int MXR_MAX_PHYSICAL_CHANNELS = 256;
 const int MXR_MAX_LOGICAL_CHANNELS = 64;
 
+/*
+    When a note starts while the polyphony cap is reached (see 
+    Mixer::setMaxVoices()), the mixer steals a voice: it fades out the
+    voice the policy picks and gives the note a new one.
+    - MXR_STEAL_OLDEST: the voice that has played the longest
+    - MXR_STEAL_QUIETEST: the voice that plays at the lowest volume
+    - MXR_STEAL_BACKGROUND_FIRST: the quietest of the voices that no longer
+      belong to the current note of their logical channel (e.g. the notes
+      the IT NNA leaves playing), the quietest voice if there are none
+    Voices that fade out to stop don't count against the cap, they are 
+    gone within MXR_VOLUME_RAMP_MAX_STEPS frames.
+*/
+const int MXR_STEAL_OLDEST = 0;
+const int MXR_STEAL_QUIETEST = 1;
+const int MXR_STEAL_BACKGROUND_FIRST = 2;
+const int MXR_STEALING_POLICIES = 3;
+
 // for internal mixing, 32 bit will do for now
 //typedef std::int32_t MixBufferType;      
 typedef float MixBufferType;
 
-const int MXR_BLOCK_SIZE = 0x4000;      // normally 0x4000
-const int MXR_BLOCK_COUNT = 4;          // at least 2, or 4 (?) for float mixing
 #define   MXR_BITS_PER_SAMPLE      32   //  (sizeof( MixBufferType ) / 8) // can't use constexpr here
-const int MXR_SAMPLES_PER_BLOCK = MXR_BLOCK_SIZE /
-            (MXR_BITS_PER_SAMPLE / 8);  // 32 bit = 4 bytes / sample
+const int MXR_NR_OUTPUT_CHANNELS = 2;   // stereo
+
+/*
+    The mixer works in blocks of framesPerBlock frames, real time sinks 
+    buffer blockCount blocks. Both can be changed at run time, see
+    Mixer::setBlockSize(), Mixer::setBlockCount() and the latency profiles
+    below. Small blocks give a low latency, large blocks spread the fixed
+    cost per block over more frames.
+*/
+const int MXR_DEFAULT_FRAMES_PER_BLOCK = 2048;  // 16 kB of stereo float data
+const int MXR_DEFAULT_BLOCK_COUNT = 4;
+const int MXR_MIN_FRAMES_PER_BLOCK = 16;
+const int MXR_MAX_FRAMES_PER_BLOCK = 0x40000;   // about 6 seconds
+const int MXR_MIN_BLOCK_COUNT = 2;
+const int MXR_MAX_BLOCK_COUNT = 64;
+
+/*
+    The voices are mixed in MXR_MIX_LANES lanes: voice i of the active 
+    voices goes to lane i % MXR_MIX_LANES. Every lane has a buffer of its 
+    own, lane 0 mixes straight into the output, the other lanes are added
+    to it in their order. As the lanes do not depend on the nr of threads
+    that mix them (1 .. MXR_MAX_MIX_THREADS, see Mixer::setNrThreads()),
+    the output is exactly the same for any nr of threads. With up to 
+    MXR_MIX_LANES voices it is the same as that of a mixer that adds the 
+    voices one after the other. The voices that ended are only taken out
+    of the active list at the end of a tick, so that the lane of a voice
+    does not depend on the block size either. The lane buffers are 
+    MXR_LANE_ALIGNMENT floats (a cache line) apart.
+*/
+const int MXR_MIX_LANES = 8;
+const int MXR_MAX_MIX_THREADS = MXR_MIX_LANES;
+const int MXR_LANE_ALIGNMENT = 16;
+
+const int MXR_LATENCY_INTERACTIVE = 0;  //    64 frames * 4 blocks, about 6 ms
+const int MXR_LATENCY_NORMAL = 1;       //  2048 frames * 4 blocks, about 186 ms
+const int MXR_LATENCY_BATCH = 2;        // 65536 frames * 2 blocks, for rendering
 
 #if MXR_BITS_PER_SAMPLE == 32
 typedef float DestBufferType;           // DestBufferType must be float for 32 bit mixing
@@ -128,6 +202,34 @@ const int MXR_CUBIC_INTERPOLATION = 2;
 const int MXR_SINC_INTERPOLATION = 3;
 const int MXR_INTERPOLATION_TYPES = 4;
 
+/*
+    All mixing routines have this signature, see the mixing routines in 
+    mixer.cpp. There is a routine for every interpolation type and every
+    variant: a combination of the flags below. The position is relative to
+    pSmpData, which points to 16 bit sample data, to the float copy of it 
+    for the MXR_MIX_FLOAT_DATA variants (see Sample::createFloatData()), or 
+    to 8 bit sample data for the MXR_MIX_8BIT_DATA variants (see 
+    Sample::get8BitData()). A sample with a float copy is mixed from the 
+    copy, so the variants with both flags are the float variants.
+*/
+typedef void (*MixRoutine)(
+    DestBufferType* pBuffer,
+    const void* pSmpData,
+    int nrSamples,
+    float leftGain,
+    float rightGain,
+    float leftGainDelta,
+    float rightGainDelta,
+    std::int64_t position,
+    std::int64_t positionStep );
+
+const int MXR_MIX_BACKWARDS = 1;
+const int MXR_MIX_VOLUME_RAMP = 2;
+const int MXR_MIX_STEREO = 4;
+const int MXR_MIX_FLOAT_DATA = 8;
+const int MXR_MIX_8BIT_DATA = 16;
+const int MXR_MIX_ROUTINE_VARIANTS = 32;
+
 /******************************************************************************
 *******************************************************************************
 *                                                                             *
@@ -145,19 +247,27 @@ public:
     {
         flags_ = 0;
         parentLogicalChannel_ = 0;
+        leftRampStartVolume_ = 0;
+        rightRampStartVolume_ = 0;
+        leftRampStepSize_ = 0;
+        rightRampStepSize_ = 0;
+        volumeRampIdx_ = 0;
+        volumeRampLength_ = 0;
         leftVolume_ = 0;
         rightVolume_ = 0;
         finalLeftVolume_ = 0;
         finalRightVolume_ = 0;
-        frequencyInc_ = 0;
+        positionStep_ = 0;
         fadeOut_ = 0;
         volEnvIdx_ = 0;
         panEnvIdx_ = 0;
         PitchEnvIdx_ = 0;
-        offset_ = 0;
-        fracOffset_ = 0;
+        nnaType_ = NNA_NOTE_CUT;
+        note_ = 0;
+        position_ = 0;
         pSample_ = nullptr;
         pInstrument_ = nullptr;   // for the envelopes
+        age_ = 0;
     }
     bool            isActive() const { return (flags_ & MXR_CHANNEL_IS_ACTIVE_FLAG) != 0; }
     void            activate() 
@@ -199,67 +309,34 @@ public:
         int nrSteps = (int)(delta / (float)MXR_VOLUME_RAMP_STEP_SIZE);
         if ( nrSteps == 0 )
             return; // volume delta is too small and needs no ramping
-        float leftStepSize  = leftVolumeDelta / (float)nrSteps;
-        float rightStepSize = rightVolumeDelta / (float)nrSteps;
-        float leftScale,rightScale;
 
         /*
-        if ( isVolumeRampingDown() ) { 
-            leftScale = (leftStartVolume != 0) ?
-                (1.0f / leftStartVolume) : 0;
-            rightScale = (rightStartVolume != 0) ?
-                (1.0f / rightStartVolume) : 0;
-        } else { 
-            leftScale = (leftEndVolume != 0) ?
-                (1.0f / leftEndVolume) : 0;
-            rightScale = (rightEndVolume != 0) ?
-                (1.0f / rightEndVolume) : 0;
-        }
+            The volume goes up or down by one step per frame, the mixing 
+            routines apply the steps, see Mixer::doMixAllChannels()
         */
-
-        if ( leftVolumeDelta < 0 ) 
-            leftVolume_ = leftStartVolume;
-        if ( rightVolumeDelta < 0 )
-            rightVolume_ = rightStartVolume;
-
-        float L = std::max( leftStartVolume,leftEndVolume );
-        float R = std::max( rightStartVolume,rightEndVolume );
-
-        leftScale = (L > 0.0001) ? (1.0f / L) : 0;
-        rightScale = (R > 0.0001) ? (1.0f / R) : 0;
-
+        leftRampStartVolume_ = leftStartVolume;
+        rightRampStartVolume_ = rightStartVolume;
+        leftRampStepSize_ = leftVolumeDelta / (float)nrSteps;
+        rightRampStepSize_ = rightVolumeDelta / (float)nrSteps;
         volumeRampIdx_ = 0;
         volumeRampLength_ = nrSteps;
-        int i = 0;
-        for ( ; i < (volumeRampLength_ << 1); i += 2 ) {
-            int i2 = (i + 1) >> 1;
-            volumeRamp_[i    ] = (leftStartVolume + leftStepSize * i2) * leftScale;
-            volumeRamp_[i + 1] = (rightStartVolume + rightStepSize * i2) * rightScale;
-        }
         setFlags( MXR_VOLUME_RAMP_IS_ACTIVE_FLAG );
+        updateMixRoutine();
         
 #ifdef debug_volume_ramp
         std::cout
             << "\nVolume is ramping " << (direction ? "DOWN" : "UP")
             << "\nMXR_VOLUME_RAMP_STEP_SIZE " << MXR_VOLUME_RAMP_STEP_SIZE
             << "\nnrSteps          = " << nrSteps
-            << "\nleftStepSize      = " << leftStepSize
-            << "\nrightStepSize     = " << rightStepSize
+            << "\nleftStepSize      = " << leftRampStepSize_
+            << "\nrightStepSize     = " << rightRampStepSize_
             << "\nleftStartVolume   = " << leftStartVolume
             << "\nrightStartVolume  = " << rightStartVolume
             << "\nleftEndVolume     = " << leftEndVolume
             << "\nrightEndVolume    = " << rightEndVolume
             << "\nvolumeRampIdx     = " << volumeRampIdx_
             << "\nvolumeRampLength  = " << volumeRampLength_
-            << "\nValues = \n" 
-            ;
-        for ( int i = 0; i < volumeRampLength_; i++ ) {
-            std::cout
-                << std::setw( 10 ) << volumeRamp_[i * 2] << ":"
-                << std::setw( 10 ) << volumeRamp_[i * 2 + 1] << "\n";
-        }
-        std::cout << "\n\n";
-        _getch();
+            << "\n\n";
 #endif        
     }
     bool            isVolumeRamping() const { return isSet( MXR_VOLUME_RAMP_IS_ACTIVE_FLAG ); }
@@ -275,6 +352,7 @@ public:
     void            disableVolumeRamp()
     {
         clearFlags( MXR_VOLUME_RAMP_IS_ACTIVE_FLAG | MXR_VOLUME_RAMP_IS_DOWNWARDS_FLAG );
+        updateMixRoutine();
     }
     void            setVolume( float leftVolume, float rightVolume )
     {
@@ -308,34 +386,41 @@ public:
     void            setPlayBackwards()
     {
         setFlags( MXR_PLAYING_BACKWARDS_FLAG );
+        updateMixRoutine();
     }
     void            setPlayForwards()
     {
         clearFlags( MXR_PLAYING_BACKWARDS_FLAG );
+        updateMixRoutine();
     }
-    void            setFrequency( unsigned frequency )
+    void            setFrequency( unsigned frequency,unsigned mixRate )
     {
-        frequencyInc_ = (float)frequency / (float)MXR_MIXRATE;
+        positionStep_ = ((std::int64_t)frequency << MXR_POSITION_FRACTION_BITS) / mixRate;
     }
     void            playSample(
         int logicalChannelNr,
         Instrument* pInstrument,
         Sample* pSample,
+        unsigned note,
         unsigned offset,
         bool direction )
     {
         //clear();
         activate();
+        clearFlags( MXR_SAMPLE_IS_KEYED_OFF_FLAG | MXR_SAMPLE_IS_FADING_OUT_FLAG );
         if ( direction == FORWARD )
             setPlayForwards();
         else
             setPlayBackwards();
         pInstrument_ = pInstrument;
         pSample_ = pSample;
-        offset_ = offset;
+        position_ = (std::int64_t)offset << MXR_POSITION_FRACTION_BITS;
         age_ = 0;
         parentLogicalChannel_ = logicalChannelNr;
-        fracOffset_ = 0;
+        note_ = (std::uint8_t)note;
+        nnaType_ = pInstrument->getNnaType();
+        fadeOut_ = MXR_MAX_FADE_OUT;
+        updateMixRoutine();
         
 
         // added for envelope processing:
@@ -351,33 +436,175 @@ public:
     }
 
     int             getParentLogicalChannel() const { return parentLogicalChannel_; }
+    unsigned        getNote() const { return note_; }
+    /*
+        What happens to the note when a new note starts on its logical
+        channel: NNA_NOTE_CUT, NNA_NOTE_CONTINUE, NNA_NOTE_OFF or
+        NNA_NOTE_FADE. The instrument sets it, IT effect S73 .. S76
+        overrides it.
+    */
+    int             getNnaType() const { return nnaType_; }
+    void            setNnaType( int nnaType ) { nnaType_ = (std::uint8_t)nnaType; }
+    bool            isKeyedOff() const { return isSet( MXR_SAMPLE_IS_KEYED_OFF_FLAG ); }
+    void            keyOff() { setFlags( MXR_SAMPLE_IS_KEYED_OFF_FLAG ); }
+    bool            isFadingOut() const { return isSet( MXR_SAMPLE_IS_FADING_OUT_FLAG ); }
+    void            startFadeOut() { setFlags( MXR_SAMPLE_IS_FADING_OUT_FLAG ); }
+    unsigned        getFadeOut() const { return fadeOut_; }
+    void            setFadeOut( unsigned fadeOut ) { fadeOut_ = (std::uint16_t)fadeOut; }
+    /*
+        The nr of frames the voice has played since its note started
+    */
+    unsigned        getAge() const { return age_; }
+    void            addAge( unsigned nrFrames ) { age_ += nrFrames; }
+    /*
+        How loud the voice plays right now, for voice stealing
+    */
+    float           getLoudness() const
+    {
+        return fabs( getCurrentLeftVolume() ) + fabs( getCurrentRightVolume() );
+    }
     Sample*         getSamplePtr() const { return pSample_; }
     Instrument*     getInstrumentPtr() const { return pInstrument_; }
     float           getLeftVolume() const { return leftVolume_; }
     float           getRightVolume() const { return rightVolume_; }
-    float           getVolumeRampVal( int value ) const
+    /*
+        The volume at the current position of the volume ramp
+    */
+    float           getLeftRampVolume() const
+    {
+        return leftRampStartVolume_ + leftRampStepSize_ * (float)volumeRampIdx_;
+    }
+    float           getRightRampVolume() const
+    {
+        return rightRampStartVolume_ + rightRampStepSize_ * (float)volumeRampIdx_;
+    }
+    /*
+        The volume the channel plays at right now, the start volume for a
+        new volume ramp
+    */
+    float           getCurrentLeftVolume() const
+    {
+        return isVolumeRamping() ? getLeftRampVolume() : leftVolume_;
+    }
+    float           getCurrentRightVolume() const
     {
-        assert( value >= 0 && value < (MXR_VOLUME_RAMP_MAX_STEPS * 2) );
-        return volumeRamp_[value];
+        return isVolumeRamping() ? getRightRampVolume() : rightVolume_;
     }
+    float           getLeftRampStepSize() const { return leftRampStepSize_; }
+    float           getRightRampStepSize() const { return rightRampStepSize_; }
     int             getVolumeRampPosition() const { return volumeRampIdx_; }
     void            setVolumeRampPosition( int index )
     {
-        assert( index >= 0 && index < (MXR_VOLUME_RAMP_MAX_STEPS * 2) );
+        assert( index >= 0 && index <= volumeRampLength_ );
         volumeRampIdx_ = index;
     }
     int             getVolumeRampLength() { return volumeRampLength_; }
-    float           getFrequencyInc() const { return frequencyInc_; }
-    unsigned        getOffset() const { return offset_; }
-    float           getFracOffset() const { return fracOffset_; }
-    void            setOffset( unsigned offset )
+    /*
+        The position in the sample data and the step per frame, both 32.32
+        fixed point (see MXR_POSITION_FRACTION_BITS)
+    */
+    std::int64_t    getPositionStep() const { return positionStep_; }
+    std::int64_t    getPosition() const { return position_; }
+    unsigned        getOffset() const { return (unsigned)(position_ >> MXR_POSITION_FRACTION_BITS); }
+    void            setPosition( std::int64_t position )
     {
-        assert( offset <= pSample_->getLength() );
-        offset_ = offset;
+        assert( (position >= 0) && 
+            ((position >> MXR_POSITION_FRACTION_BITS) <= pSample_->getLength()) );
+        position_ = position;
     }
-    void            setFracOffset( float fracOffset )
+
+    /*
+        The mixer's table of mixing routines, one for each variant. The 
+        channel picks the routine that fits it whenever its direction, its
+        volume ramp or its sample changes.
+    */
+    void            setMixRoutines( const MixRoutine* mixRoutines )
     {
-        fracOffset_ = fracOffset;
+        mixRoutines_ = mixRoutines;
+        updateMixRoutine();
+    }
+    MixRoutine      getMixRoutine() const { return mixRoutine_; }
+
+    /*
+        Writes the state of the channel to a snapshot and reads it back,
+        all of it except the sample and instrument pointers: the mixer 
+        stores their nrs, see Mixer::saveReplayState(). restoreState() 
+        picks the mixing routine again from the table it is given.
+    */
+    void            saveState( ReplayState& state ) const
+    {
+        state.write( flags_ );
+        state.write( parentLogicalChannel_ );
+        state.write( leftRampStartVolume_ );
+        state.write( rightRampStartVolume_ );
+        state.write( leftRampStepSize_ );
+        state.write( rightRampStepSize_ );
+        state.write( volumeRampIdx_ );
+        state.write( volumeRampLength_ );
+        state.write( leftVolume_ );
+        state.write( rightVolume_ );
+        state.write( finalLeftVolume_ );
+        state.write( finalRightVolume_ );
+        state.write( positionStep_ );
+        state.write( fadeOut_ );
+        state.write( nnaType_ );
+        state.write( note_ );
+        state.write( volEnvIdx_ );
+        state.write( panEnvIdx_ );
+        state.write( PitchEnvIdx_ );
+        state.write( position_ );
+        state.write( age_ );
+    }
+    void            restoreState( 
+        ReplayStateReader& reader,
+        Sample* pSample,
+        Instrument* pInstrument,
+        const MixRoutine* mixRoutines )
+    {
+        reader.read( flags_ );
+        reader.read( parentLogicalChannel_ );
+        reader.read( leftRampStartVolume_ );
+        reader.read( rightRampStartVolume_ );
+        reader.read( leftRampStepSize_ );
+        reader.read( rightRampStepSize_ );
+        reader.read( volumeRampIdx_ );
+        reader.read( volumeRampLength_ );
+        reader.read( leftVolume_ );
+        reader.read( rightVolume_ );
+        reader.read( finalLeftVolume_ );
+        reader.read( finalRightVolume_ );
+        reader.read( positionStep_ );
+        reader.read( fadeOut_ );
+        reader.read( nnaType_ );
+        reader.read( note_ );
+        reader.read( volEnvIdx_ );
+        reader.read( panEnvIdx_ );
+        reader.read( PitchEnvIdx_ );
+        reader.read( position_ );
+        reader.read( age_ );
+        pSample_ = pSample;
+        pInstrument_ = pInstrument;
+        setMixRoutines( mixRoutines );
+    }
+
+private:
+    void            updateMixRoutine()
+    {
+        if ( (mixRoutines_ == nullptr) || (pSample_ == nullptr) )
+            return;
+        int variant = 0;
+        if ( isPlayingBackwards() )
+            variant |= MXR_MIX_BACKWARDS;
+        if ( isVolumeRamping() )
+            variant |= MXR_MIX_VOLUME_RAMP;
+        if ( !pSample_->isMono() )
+            variant |= MXR_MIX_STEREO;
+        if ( pSample_->hasFloatData() )
+            variant |= MXR_MIX_FLOAT_DATA;
+        else if ( pSample_->has8BitData() )
+            variant |= MXR_MIX_8BIT_DATA;
+
+        mixRoutine_ = mixRoutines_[variant];
     }
 
 private:
@@ -388,26 +615,29 @@ private:
 private:
     std::uint16_t   flags_;
     std::uint16_t   parentLogicalChannel_;// for a.o. IT effect S7x (NNA process changes)
-    float           volumeRamp_[MXR_VOLUME_RAMP_MAX_STEPS * 2]; // * 2 for stereo
+    float           leftRampStartVolume_;
+    float           rightRampStartVolume_;
+    float           leftRampStepSize_;  // volume change per frame
+    float           rightRampStepSize_;
     int             volumeRampIdx_;     // where we left off
     int             volumeRampLength_;  // number of volume changes for this ramp
+    const MixRoutine* mixRoutines_ = nullptr;
+    MixRoutine      mixRoutine_ = nullptr;
     float           leftVolume_;        //  0 .. 1
     float           rightVolume_;       // -1 .. 1: negative volume for surround
     float           finalLeftVolume_;   // to reinitialize leftVolume_ after vol ramp down
     float           finalRightVolume_;  // see above
-    float           frequencyInc_;      // frequency / mixRate
-    std::uint16_t   fadeOut_;           // 65535 .. 0 
+    std::int64_t    positionStep_;      // frequency / mixRate, 32.32 fixed point
+    std::uint16_t   fadeOut_;           // MXR_MAX_FADE_OUT .. 0
+    std::uint8_t    nnaType_;           // NNA_NOTE_CUT .. NNA_NOTE_FADE
+    std::uint8_t    note_;              // for the duplicate check
     std::uint16_t   volEnvIdx_;         // 0 .. 65535
     std::uint16_t   panEnvIdx_;         // 0 .. 65535
     std::uint16_t   PitchEnvIdx_;       // 0 .. 65535
-    unsigned        offset_;            // non fractional part of the offset
-    float           fracOffset_;        // fractional part of the offset
+    std::int64_t    position_;          // offset in the sample, 32.32 fixed point
     Sample*         pSample_;           // for the sample data
     Instrument*     pInstrument_;       // for the envelopes
-
-
-    // might be removed later:
-    unsigned        age_;
+    unsigned        age_;               // in frames, for voice stealing
 };
 
 // just a small struct to keep track of info for each logical channel
@@ -419,6 +649,7 @@ public:
         globalVolume = 1.0;
         volume = 1.0;
         panning = MXR_PANNING_CENTER;
+        frequency = 0;
         physicalChannelNr = MXR_NO_PHYSICAL_CHANNEL_ATTACHED;
     }
 
@@ -426,6 +657,7 @@ public:
     float           globalVolume;       // 0 .. 1
     float           volume;             // 0 .. 1
     int             panning;            // 0 .. 255
+    unsigned        frequency;          // in Hz, for new voices on this channel
     int             physicalChannelNr;  // 0 .. MXR_MAX_PHYSICAL_CHANNELS - 1, or -1 for none
 };
 
@@ -522,6 +754,30 @@ public:
     }
 };
 
+/*
+    The result of Mixer::analyzeSong(), the positions are frame nrs at the
+    mix rate. nrFrames is the exact length of one pass through the song:
+    at that frame the replay goes back to loopFrameNr, the frame where the
+    row at loopOrderNr, loopRowNr was read the first time, and plays the
+    same rows at the same tempo from there on, again and again. A later
+    pass can be a frame longer or shorter than the first one, as the 
+    tick lengths are rounded to whole frames.
+
+    render() ends the song at nrFrames, see Mixer::isSongEnded(). nrRows 
+    and nrTicks count the rows (repeats included) and the ticks of one 
+    pass. Songs longer than MXR_ANALYSIS_MAX_SECONDS are not analyzed.
+*/
+const int MXR_ANALYSIS_MAX_SECONDS = 24 * 60 * 60;
+
+struct SongAnalysis {
+    std::uint64_t   nrFrames = 0;
+    std::uint64_t   loopFrameNr = 0;
+    unsigned        loopOrderNr = 0;
+    unsigned        loopRowNr = 0;
+    unsigned        nrRows = 0;
+    unsigned        nrTicks = 0;
+};
+
 /******************************************************************************
 *******************************************************************************
 *                                                                             *
@@ -548,15 +804,222 @@ public:
         global functions:
     */
     void            assignModule( Module* module );
+
+    /*
+        The mixer does not own the sink: it must stay alive until
+        stopReplay() is called. startReplay() opens the sink, stopReplay()
+        closes it.
+    */
+    void            setAudioSink( AudioSink* audioSink ) { audioSink_ = audioSink; }
+
+    /*
+        Block size in frames, and the nr of blocks a real time sink should
+        buffer. Only change these while the replay is stopped: the sink is
+        set up accordingly in startReplay(). Return 0 on success, -1 if the 
+        value is out of range.
+    */
+    int             setBlockSize( unsigned framesPerBlock );
+    int             setBlockCount( unsigned blockCount );
+    int             setLatencyProfile( int latencyProfile );
+    unsigned        getBlockSize() const { return framesPerBlock_; }
+    unsigned        getBlockCount() const { return blockCount_; }
+
+    /*
+        Output rate in Hz, MXR_MIN_MIXRATE .. MXR_MAX_MIXRATE. Only change
+        it while the replay is stopped. Returns 0 on success, -1 if the
+        value is out of range.
+    */
+    int             setMixRate( unsigned mixRate );
+    unsigned        getMixRate() const { return mixRate_; }
+
     int             startReplay();
     int             stopReplay();
+
+    /*
+        For real time sinks: mixes as many frames as the sink can take right
+        now, in chunks of at most one block. Offline sinks get one block per
+        call. See RenderThread for a thread that calls this in a loop.
+    */
     void            updateWaveBuffers();
+
+    /*
+        For offline sinks: mixes the whole song into the sink as fast as
+        possible, from startReplay() to stopReplay(). If the end of the 
+        song is not known yet it is looked for first, see isSongEnded(), 
+        and the song starts over from the beginning. Returns 0 on success.
+    */
+    int             renderSong();
+
+    /*
+        Mixes nrFrames sample frames (stereo pairs) straight into buffer, which
+        must hold nrFrames * 2 floats. Any nr of frames can be requested, the
+        position within the current tick is kept from one call to the next.
+        Returns the nr of frames that belong to the song: this is less than
+        nrFrames if the song ended during this call, and zero for all calls
+        after that.
+    */
+    unsigned        render( float* buffer,size_t nrFrames );
+
+    /*
+        The song has ended when the replay routine is about to play the 
+        first row of its second pass: the row where it starts to repeat 
+        itself, with the same tempo, speed and pattern loop state, be it 
+        because of the song restart position, a position jump backwards
+        (Bxx) or an endless pattern loop. analyzeSong() finds that row,
+        until it has run on the assigned module the end is not known and
+        the song plays on, looping, as it does in the real time player.
+        renderSong(), buildSeekIndex() and seek() run it if needed.
+    */
+    bool            isSongEnded() const { return songHasEnded_; }
+    /*
+        Where the replay is in the song: the order (index in the pattern
+        table) and the row that are read next, and the tick within the row
+        that is mixed now.
+    */
+    unsigned        getOrderNr() const { return patternTableIdx_; }
+    unsigned        getRowNr() const { return patternRow_; }
+    unsigned        getTickNr() const { return tickNr_; }
+    /*
+        The pitch of a logical channel: the frequency its notes play at, in
+        Hz, and the position step of its voice (frequency / mix rate, see 
+        MXR_POSITION_ONE), 0 if the channel has no voice.
+    */
+    unsigned        getChannelFrequency( unsigned logicalChannelNr ) const
+    {
+        assert( isValidLogicalChannelNr( logicalChannelNr ) );
+        return logicalChannels_[logicalChannelNr].frequency;
+    }
+    std::int64_t    getChannelPositionStep( unsigned logicalChannelNr ) const
+    {
+        int physicalChannelNr = getPhysicalChannelNr( logicalChannelNr );
+        if ( !isValidPhysicalChannelNr( physicalChannelNr ) )
+            return 0;
+        const MixerChannel& mChn = physicalChannels_[physicalChannelNr];
+        if ( (mChn.getParentLogicalChannel() != (int)logicalChannelNr) || !mChn.isPrimary() )
+            return 0;
+        return mChn.getPositionStep();
+    }
+    /*
+        Snapshots of the replay state: the position in the song and in the
+        current tick, the tempo, the effect memory of the logical channels
+        and the voices with their position in their sample. Restoring one 
+        continues the replay at exactly that frame, with exactly the same
+        output as the mixer it was saved from, in O(nr of voices) time 
+        rather than by mixing the song up to there. 
+
+        The module must be assigned first, and must be the same module the
+        snapshot was saved with. The mix rate must be the same as well. The
+        settings (interpolation, block size, polyphony cap, gain, panning)
+        are not part of the snapshot, nor are the statistics. Save and
+        restore between two calls to render(). restoreReplayState() returns
+        0 on success, -1 if the snapshot does not fit the mixer or the 
+        module, in which case the replay starts over from the beginning.
+    */
+    int             saveReplayState( ReplayState& state ) const;
+    int             restoreReplayState( const ReplayState& state );
+    /*
+        Runs the replay routine through the song without mixing, at 
+        thousands of times real time, see SongAnalysis. Pattern jumps and
+        breaks, pattern loops and pattern delays are followed as in 
+        render(). The module must be assigned first, the replay starts over
+        from the beginning afterwards. From then on render() ends the song
+        where the pass ends, until another module is assigned. Returns 0 on
+        success, -1 if there is no module or if the song does not loop 
+        within MXR_ANALYSIS_MAX_SECONDS, in which case it ends there.
+    */
+    int             analyzeSong( SongAnalysis& analysis );
+    /*
+        Fills the seek index of the assigned module (see SeekIndex.h) with a
+        snapshot every intervalSeconds seconds. This mixes the whole song 
+        once, up to isSongEnded(). The replay starts over from the 
+        beginning afterwards. Returns 0 on success, -1 if there is no 
+        module or if the interval is not 1 .. SEEKINDEX_MAX_INTERVAL.
+    */
+    int             buildSeekIndex( unsigned intervalSeconds = SEEKINDEX_DEFAULT_INTERVAL );
+    /*
+        Continues the replay at frame frameNr of the song: from the last 
+        keyframe before it, which leaves at most one interval to mix, or
+        from the beginning if the module has no seek index for the current
+        mix rate. Past the end of the song the replay stops at the end,
+        which is looked for first if it is not known yet, see 
+        isSongEnded(). Call it between two calls to render(), not 
+        while a RenderThread is running. Returns 0 on success, -1 if there
+        is no module.
+    */
+    int             seek( std::uint64_t frameNr );
+
+    /*
+        The sum of the nr of frames mixed for each voice since the last
+        resetMixer(): a song that has 10 voices playing for 1000 frames has
+        mixed 10000 voice frames. For benchmarking the cost per voice.
+    */
+    std::uint64_t   getNrVoiceFramesMixed() const { return nrVoiceFramesMixed_; }
+    /*
+        The nr of times a mixing routine was called since the last 
+        resetMixer(). A voice needs a call for every loop it plays through,
+        so short loops mean few frames per call.
+    */
+    std::uint64_t   getNrMixRoutineCalls() const { return nrMixRoutineCalls_; }
+    /*
+        The nr of physical channels that are playing: the primary voices
+        of the logical channels and the voices that are fading out.
+    */
+    unsigned        getNrActiveVoices() const { return nrActiveChannels_; }
+    /*
+        The voices that the IT new note actions left playing in the
+        background: how many played on average since the last 
+        resetMixer(), and the most that played at the same time.
+    */
+    double          getAverageBackgroundVoices() const
+    {
+        return nrFramesMixed_ ? 
+            (double)nrBackgroundVoiceFramesMixed_ / (double)nrFramesMixed_ : 0.0;
+    }
+    unsigned        getPeakBackgroundVoices() const { return peakBackgroundVoices_; }
+
+    /*
+        The polyphony cap: how many voices may play at the same time, not
+        counting the voices that fade out to stop. 1 .. 
+        MXR_MAX_PHYSICAL_CHANNELS, which is the default. A note that starts
+        when the cap is reached steals a voice, the policy decides which
+        one (see MXR_STEAL_OLDEST). Lower caps limit the time it takes to
+        mix songs that leave many notes playing (IT NNA). Return 0 on 
+        success, -1 if the value is out of range.
+    */
+    int             setMaxVoices( unsigned maxVoices );
+    int             setVoiceStealingPolicy( int policy );
+    unsigned        getMaxVoices() const { return maxVoices_; }
+    int             getVoiceStealingPolicy() const { return voiceStealingPolicy_; }
+    /*
+        The nr of voices that were stolen since the last resetMixer()
+    */
+    std::uint64_t   getNrVoicesStolen() const { return nrVoicesStolen_; }
     void            resetMixer()
     {
         mixIndex_ = 0;
         mixCount_ = 0;
-        for ( unsigned i = 0; i < MXR_MAX_PHYSICAL_CHANNELS; i++ )
+        nrVoiceFramesMixed_ = 0;
+        nrMixRoutineCalls_ = 0;
+        nrVoicesStolen_ = 0;
+        nrFramesMixed_ = 0;
+        nrBackgroundVoiceFramesMixed_ = 0;
+        peakBackgroundVoices_ = 0;
+        /*
+            All channels, not only the active ones: a free channel keeps
+            some of its flags for when it is used again, and pointers into
+            the module it played last.
+        */
+        for ( int i = 0; i < MXR_MAX_PHYSICAL_CHANNELS; i++ )
             physicalChannels_[i].clear();
+        nrActiveChannels_ = 0;
+        /*
+            The free stack hands out the lowest channel nrs first, the same
+            way after every reset, so that a song is always mixed in the 
+            same order and renders to exactly the same output.
+        */
+        nrFreeChannels_ = MXR_MAX_PHYSICAL_CHANNELS;
+        for ( int i = 0; i < MXR_MAX_PHYSICAL_CHANNELS; i++ )
+            freeChannels_[i] = MXR_MAX_PHYSICAL_CHANNELS - 1 - i;
     }
 
     /*
@@ -598,11 +1061,44 @@ public:
     {
         assert( InterPolationType >= 0 );
         assert( InterPolationType < MXR_INTERPOLATION_TYPES );
-
+        mxr_interpolationType_ = InterPolationType;
+        updateMixRoutines();
     }
+    int             getInterpolationType() const { return mxr_interpolationType_; }
+
+    /*
+        Selects the mixing routines for an instruction set, see 
+        CpuFeatures.h. The constructor picks the best one the cpu supports,
+        cpuSelectIsa() gives the one the user asked for. Returns -1 if the
+        cpu does not support the instruction set.
+    */
+    int             setIsa( int isa );
+    int             getIsa() const { return isa_; }
+    /*
+        The nr of threads that mix the voices, 1 (the default) .. 
+        MXR_MAX_MIX_THREADS. The thread that calls render() is one of them,
+        the replay routines stay on it. A block only uses as many threads
+        as it has lanes with voices, see MXR_MIX_LANES. Returns 0 on 
+        success, -1 if the nr is out of range.
+    */
+    int             setNrThreads( unsigned nrThreads );
+    unsigned        getNrThreads() const { return workerPool_.getNrWorkers(); }
+    /*
+        Mixes from a float copy of the sample data, which saves the 
+        conversion of every sample point at the cost of three times the
+        memory. Applies to the module that is assigned, and to every module
+        assigned from then on. The output is the same, except that the 
+        cubic interpolation leaves out the rounding of its 16 bit version.
+    */
+    void            setFloatSampleData( bool useFloatData );
+    bool            isUsingFloatSampleData() const { return useFloatSampleData_; }
+    /*
+        A tick lasts 2.5 / bpm seconds. The tick length is taken up at the 
+        start of each tick, see startTick().
+    */
     void            setTempo( int tempo ) // set BPM
     {
-        callBpm_ = (MXR_MIXRATE * 5) / (tempo << 1);
+        tempo_ = tempo;
     }
     //void            setSpeed() {} // set nr of ticks / beat
     //void            delaySpeed( int nrNticks ) {}
@@ -610,7 +1106,32 @@ public:
     /*
         logical channel commands:
     */
-    void            setNNAMode( int logicalChannelNr,int NNA,int DCT ) {}
+    /*
+        Overrides the new note action of the note that plays on the logical
+        channel (IT effect S73 .. S76)
+    */
+    void            setNNAMode( int logicalChannelNr,int NNA )
+    {
+        assert( (NNA >= NNA_NOTE_CUT) && (NNA <= NNA_NOTE_FADE) );
+        if ( isPhysicalChannelAttached( logicalChannelNr ) )
+            physicalChannels_[getPhysicalChannelNr( logicalChannelNr )].setNnaType( NNA );
+    }
+    /*
+        Cuts, keys off or fades out the notes that the logical channel left
+        playing in the background (IT effect S70 .. S72, with DCA_CUT,
+        DCA_NOTE_OFF or DCA_NOTE_FADE as the action)
+    */
+    void            doPastNoteAction( int logicalChannelNr,int action )
+    {
+        assert( isValidLogicalChannelNr( logicalChannelNr ) );
+        for ( int i = 0; i < nrActiveChannels_; i++ ) {
+            int physicalChannelNr = activeChannels_[i];
+            MixerChannel& mChn = physicalChannels_[physicalChannelNr];
+            if ( mChn.isActive() && mChn.isSecondary() && !mChn.isDying() &&
+                (mChn.getParentLogicalChannel() == logicalChannelNr) )
+                doNoteAction( physicalChannelNr,action );
+        }
+    }
     /*
         volume range input: 0 .. 64
     */
@@ -627,8 +1148,8 @@ public:
             int masterChannelNr = physicalChannels_[physicalChannelNr].getParentLogicalChannel();
             if ( (masterChannelNr == logicalChannelNr) &&
                 physicalChannels_[physicalChannelNr].isPrimary() ) {
-                float leftStartVolume = physicalChannels_[physicalChannelNr].getLeftVolume();
-                float rightStartVolume = physicalChannels_[physicalChannelNr].getRightVolume();
+                float leftStartVolume = physicalChannels_[physicalChannelNr].getCurrentLeftVolume();
+                float rightStartVolume = physicalChannels_[physicalChannelNr].getCurrentRightVolume();
                 calculatePhysicalChannelVolume( physicalChannelNr );
                 physicalChannels_[physicalChannelNr].setVolumeRamp(
                     MXR_VOLUME_RAMP_UP,  // not used info
@@ -684,13 +1205,14 @@ public:
     }
     void            setFrequency( int logicalChannelNr,unsigned frequency ) 
     {
+        logicalChannels_[logicalChannelNr].frequency = frequency;
         int physicalChannelNr = getPhysicalChannelNr( logicalChannelNr );
         if ( !isValidPhysicalChannelNr( physicalChannelNr ) )
             return;
         int masterChannelNr = physicalChannels_[physicalChannelNr].getParentLogicalChannel();
         if ( (masterChannelNr == logicalChannelNr) &&
             physicalChannels_[physicalChannelNr].isPrimary() )
-            physicalChannels_[physicalChannelNr].setFrequency( frequency );
+            physicalChannels_[physicalChannelNr].setFrequency( frequency,mixRate_ );
         //else
         //    throw("Trying to set frequency in inactive channel!");
     }
@@ -698,34 +1220,23 @@ public:
         int logicalChannelNr,
         Instrument* pInstrument,
         Sample* pSample,
+        unsigned note,
         unsigned offset,
         bool direction )
     {
         assert( pInstrument != nullptr );
         assert( pSample != nullptr );
         /*
-            todo:
-            - check NNA situation;
-                - if NNA = cut, set the virtual channel to volume fade out
-                - if NNA = fade, ...
-                - if NNA = continue, ...
-
-              --=> Set the isPrimary (isMaster) flag to false, and allocate a new
-              virtual channel for this master channel. "fromChannel" is always a
-              "Master" Channel
-
+            The duplicate check of the new instrument, then the new note
+            action of the note that plays now, decide what happens to the
+            notes of this channel. Only IT instruments have them, the other
+            formats cut the previous note (NNA_NOTE_CUT).
         */
+        checkDuplicateNotes( logicalChannelNr,pInstrument,pSample,note );
+        doNewNoteAction( logicalChannelNr );
 
-        // cut previous note if it is still playing:
-        stopChannelReplay( logicalChannelNr );
-
-        // find an empty slot in mixer channels table
-        int physicalChannelNr = getFreePhysicalChannel();
-
-        /*
-            "no free channel found" logic here
-            find oldest channel logic and use that instead
-        */
+        // find an empty slot in mixer channels table, steals one if needed
+        int physicalChannelNr = allocatePhysicalChannel();
         if ( !isValidPhysicalChannelNr( physicalChannelNr ) ) {
             std::cout << "\nFailed to allocate mixer channel!\n";
             return;
@@ -736,7 +1247,14 @@ public:
         physicalChannels_[physicalChannelNr].activate();
         physicalChannels_[physicalChannelNr].makePrimary();
         physicalChannels_[physicalChannelNr].playSample(
-            logicalChannelNr,pInstrument,pSample,offset,direction );
+            logicalChannelNr,pInstrument,pSample,note,offset,direction );
+        /*
+            Retriggers (E9x, Rxy) don't set the frequency again: the new 
+            voice starts at the frequency of the logical channel, not at 
+            whatever frequency its physical channel played last.
+        */
+        physicalChannels_[physicalChannelNr].setFrequency( 
+            logicalChannels_[logicalChannelNr].frequency,mixRate_ );
         calculatePhysicalChannelVolume( physicalChannelNr );
         physicalChannels_[physicalChannelNr].setVolumeRamp(
             MXR_VOLUME_RAMP_UP,
@@ -769,23 +1287,7 @@ public:
             return;
 
         detachPhysicalChannel( logicalChannelNr );
-        physicalChannels_[physicalChannelNr].makeSecondary();
-
-        // temporary, should start volume ramp etc:
-        //if( physicalChannels_[physicalChannelNr].getSamplePtr()->isRepeatSample() ) // temporary
-        //    physicalChannels_[physicalChannelNr].deactivate();  
-
-        physicalChannels_[physicalChannelNr].setVolumeRamp(
-            MXR_VOLUME_RAMP_DOWN,
-            physicalChannels_[physicalChannelNr].getLeftVolume(),
-            physicalChannels_[physicalChannelNr].getRightVolume(),
-            0,
-            0
-            );
-        physicalChannels_[physicalChannelNr].letChannelDie();
-#ifndef enable_volume_ramps
-        physicalChannels_[physicalChannelNr].deactivate(); // temp until vol ramp is ok
-#endif
+        fadeOutPhysicalChannel( physicalChannelNr );
     }
 
 private:
@@ -814,7 +1316,7 @@ private:
         logicalChannels_[logicalChannelNr].physicalChannelNr = 
             MXR_NO_PHYSICAL_CHANNEL_ATTACHED;
     }
-    bool            isPhysicalChannelAttached( int logicalChannelNr ) // not necessary?
+    bool            isPhysicalChannelAttached( int logicalChannelNr )
     {
         int physicalChannelNr = getPhysicalChannelNr( logicalChannelNr );
         if ( !isValidPhysicalChannelNr( physicalChannelNr ) )
@@ -826,13 +1328,234 @@ private:
             physicalChannels_[physicalChannelNr].isPrimary();
     }
 
-    // returns -1 if no channel found
-    int             getFreePhysicalChannel() const
+    /*
+        Applies the new note action of the note that plays on the logical
+        channel, before a new note starts. A note that is silent already
+        is cut, whatever its NNA: it could never be heard again.
+    */
+    void            doNewNoteAction( int logicalChannelNr )
+    {
+        if ( !isPhysicalChannelAttached( logicalChannelNr ) ) {
+            stopChannelReplay( logicalChannelNr );
+            return;
+        }
+        int physicalChannelNr = getPhysicalChannelNr( logicalChannelNr );
+        MixerChannel& mChn = physicalChannels_[physicalChannelNr];
+        if ( (mChn.getNnaType() == NNA_NOTE_CUT) || (mChn.getLoudness() == 0.0f) ) {
+            stopChannelReplay( logicalChannelNr );
+            return;
+        }
+        sendToBackground( physicalChannelNr );
+        if ( mChn.getNnaType() == NNA_NOTE_OFF )
+            doNoteAction( physicalChannelNr,DCA_NOTE_OFF );
+        else if ( mChn.getNnaType() == NNA_NOTE_FADE )
+            doNoteAction( physicalChannelNr,DCA_NOTE_FADE );
+    }
+
+    /*
+        IT duplicate check: the notes of the logical channel that are the
+        same as the new one (the same note and instrument, the same sample
+        or the same instrument, depending on the DCT of the new instrument)
+        get the duplicate check action of the new instrument.
+    */
+    void            checkDuplicateNotes(
+        int logicalChannelNr,
+        const Instrument* pInstrument,
+        const Sample* pSample,
+        unsigned note )
     {
-        for ( int i = 0;i < MXR_MAX_PHYSICAL_CHANNELS;i++ )
-            if ( !physicalChannels_[i].isActive() )
-                return i;
-        return MXR_NO_PHYSICAL_CHANNEL_ATTACHED;
+        int dctType = pInstrument->getDctType();
+        if ( dctType == DCT_OFF )
+            return;
+        for ( int i = 0; i < nrActiveChannels_; i++ ) {
+            int physicalChannelNr = activeChannels_[i];
+            MixerChannel& mChn = physicalChannels_[physicalChannelNr];
+            if ( !mChn.isActive() || mChn.isDying() ||
+                (mChn.getParentLogicalChannel() != logicalChannelNr) )
+                continue;
+            bool isDuplicate;
+            switch ( dctType ) {
+                case DCT_NOTE:
+                {
+                    isDuplicate = (mChn.getInstrumentPtr() == pInstrument) &&
+                        (mChn.getNote() == note);
+                    break;
+                }
+                case DCT_SAMPLE:
+                {
+                    isDuplicate = mChn.getSamplePtr() == pSample;
+                    break;
+                }
+                default: // DCT_INSTRUMENT
+                {
+                    isDuplicate = mChn.getInstrumentPtr() == pInstrument;
+                    break;
+                }
+            }
+            if ( isDuplicate ) {
+                sendToBackground( physicalChannelNr );
+                doNoteAction( physicalChannelNr,pInstrument->getDcaType() );
+            }
+        }
+    }
+
+    /*
+        Detaches a voice from its logical channel, so that the effects of
+        the channel no longer change it and a new note gets a voice of its
+        own. A background voice keeps its volume, panning and pitch.
+    */
+    void            sendToBackground( int physicalChannelNr )
+    {
+        MixerChannel& mChn = physicalChannels_[physicalChannelNr];
+        int logicalChannelNr = mChn.getParentLogicalChannel();
+        if ( mChn.isPrimary() &&
+            (getPhysicalChannelNr( logicalChannelNr ) == physicalChannelNr) )
+            detachPhysicalChannel( logicalChannelNr );
+        mChn.makeSecondary();
+    }
+
+    /*
+        DCA_CUT, DCA_NOTE_OFF or DCA_NOTE_FADE for a background voice. The
+        mixer does not run the envelopes yet, so a note off starts the fade
+        out, like Impulse Tracker does for instruments without a volume
+        envelope. See updateFadeOuts().
+    */
+    void            doNoteAction( int physicalChannelNr,int action )
+    {
+        MixerChannel& mChn = physicalChannels_[physicalChannelNr];
+        if ( action == DCA_CUT ) {
+            fadeOutPhysicalChannel( physicalChannelNr );
+            return;
+        }
+        if ( action == DCA_NOTE_OFF )
+            mChn.keyOff();
+        mChn.startFadeOut();
+    }
+
+    /*
+        Lets a voice ramp down to silence, it deactivates itself at the end
+        of the ramp. A voice that is too quiet to need a ramp stops at once,
+        or it would keep its channel for as long as its sample plays.
+    */
+    void            fadeOutPhysicalChannel( int physicalChannelNr )
+    {
+        MixerChannel& mChn = physicalChannels_[physicalChannelNr];
+        mChn.makeSecondary();
+        mChn.setVolumeRamp(
+            MXR_VOLUME_RAMP_DOWN,
+            mChn.getCurrentLeftVolume(),
+            mChn.getCurrentRightVolume(),
+            0,
+            0
+            );
+        mChn.letChannelDie();
+#ifdef enable_volume_ramps
+        if ( !mChn.isVolumeRamping() )
+#endif
+            mChn.deactivate();
+    }
+
+    /*
+        Takes a channel from the free stack and adds it to the active list,
+        the caller must activate it. When the polyphony cap is reached it
+        steals a voice first. Returns -1 if no channel is free.
+    */
+    int             allocatePhysicalChannel()
+    {
+        if ( nrFreeChannels_ == 0 )
+            releaseInactiveChannels();
+        if ( nrActiveChannels_ >= (int)maxVoices_ )
+            stealVoices();
+        if ( nrFreeChannels_ == 0 ) {
+            /*
+                All channels are taken by the voices that fade out after 
+                a steal: cut the quietest one short
+            */
+            int victimNr = findVoiceToSteal( MXR_STEAL_QUIETEST,true );
+            if ( isValidPhysicalChannelNr( victimNr ) )
+                physicalChannels_[victimNr].deactivate();
+            releaseInactiveChannels();
+        }
+        if ( nrFreeChannels_ == 0 )
+            return MXR_NO_PHYSICAL_CHANNEL_ATTACHED;
+        int physicalChannelNr = freeChannels_[--nrFreeChannels_];
+        activeChannels_[nrActiveChannels_++] = physicalChannelNr;
+        return physicalChannelNr;
+    }
+
+    /*
+        Fades out voices until there is room below the polyphony cap for 
+        one more. The voices that fade out to stop already don't count. 
+        Only called when the active list is at least as long as the cap, 
+        so that starting a note stays O(1) below the cap.
+    */
+    void            stealVoices()
+    {
+        int nrVoices = 0;
+        for ( int i = 0; i < nrActiveChannels_; i++ )
+            if ( !physicalChannels_[activeChannels_[i]].isDying() )
+                nrVoices++;
+        for ( ; nrVoices >= (int)maxVoices_; nrVoices-- ) {
+            int victimNr = findVoiceToSteal( voiceStealingPolicy_,false );
+            if ( !isValidPhysicalChannelNr( victimNr ) )
+                break;
+            sendToBackground( victimNr );
+            fadeOutPhysicalChannel( victimNr );
+            nrVoicesStolen_++;
+        }
+    }
+
+    /*
+        Picks a voice among the active voices that are dying (or not), 
+        see MXR_STEAL_OLDEST for the policies. On a tie the voice that is
+        mixed first wins, so that the output does not depend on anything
+        but the song. Returns -1 if there is no such voice.
+    */
+    int             findVoiceToSteal( int policy,bool isDying ) const
+    {
+        int victimNr = MXR_NO_PHYSICAL_CHANNEL_ATTACHED;
+        bool victimIsBackground = false;
+        for ( int i = 0; i < nrActiveChannels_; i++ ) {
+            int physicalChannelNr = activeChannels_[i];
+            const MixerChannel& mChn = physicalChannels_[physicalChannelNr];
+            if ( !mChn.isActive() || (mChn.isDying() != isDying) )
+                continue;
+            bool isBackground = mChn.isSecondary();
+            bool isBetter;
+            if ( victimNr == MXR_NO_PHYSICAL_CHANNEL_ATTACHED )
+                isBetter = true;
+            else if ( policy == MXR_STEAL_OLDEST )
+                isBetter = mChn.getAge() > physicalChannels_[victimNr].getAge();
+            else if ( (policy == MXR_STEAL_BACKGROUND_FIRST) && 
+                (isBackground != victimIsBackground) )
+                isBetter = isBackground;
+            else
+                isBetter = mChn.getLoudness() < physicalChannels_[victimNr].getLoudness();
+            if ( isBetter ) {
+                victimNr = physicalChannelNr;
+                victimIsBackground = isBackground;
+            }
+        }
+        return victimNr;
+    }
+
+    /*
+        Channels deactivate themselves when their sample or their volume 
+        ramp down ends. This moves them from the active list to the free
+        stack, the other channels keep their order. Called at the end of
+        every tick and when a channel is needed.
+    */
+    void            releaseInactiveChannels()
+    {
+        int nrActiveChannels = 0;
+        for ( int i = 0; i < nrActiveChannels_; i++ ) {
+            int physicalChannelNr = activeChannels_[i];
+            if ( physicalChannels_[physicalChannelNr].isActive() )
+                activeChannels_[nrActiveChannels++] = physicalChannelNr;
+            else
+                freeChannels_[nrFreeChannels_++] = physicalChannelNr;
+        }
+        nrActiveChannels_ = nrActiveChannels;
     }
 
     // Might return -1 i.e. MXR_NO_PHYSICAL_CHANNEL_ATTACHED
@@ -897,18 +1620,19 @@ private:
 
     /*
         This function will simple recalculate all the volumes for every
-        possible channel, usually because one of the following global
+        active channel, usually because one of the following global
         mixer parameters changed:
         - the global volume
         - the global panning
         - the global balance
+        The background voices keep the volume they have, it is not up to
+        their logical channel anymore.
     */
     void            recalcChannelVolumes()
     {
-        for ( int i = 0; i < MXR_MAX_PHYSICAL_CHANNELS; i++ ) {
-            //if ( physicalChannels_[i].isActive() )  // check is done in next fn:
-                calculatePhysicalChannelVolume( i );
-        }
+        for ( int i = 0; i < nrActiveChannels_; i++ )
+            if ( physicalChannels_[activeChannels_[i]].isPrimary() )
+                calculatePhysicalChannelVolume( activeChannels_[i] );
     }
 
     /*
@@ -935,119 +1659,42 @@ private:
 
 
 
-    static void CALLBACK waveOutProc(
-        HWAVEOUT hWaveOut,
-        UINT uMsg,
-        DWORD* dwInstance,
-        DWORD dwParam1,
-        DWORD dwParam2 );
- 
     /**************************************************************************
     *                                                                         *
     *   ACTUAL MIXING ROUTINES:                                               *
     *                                                                         *
     **************************************************************************/
     /*
-        Sinc Interpolation is yet to be implemented
+        A lane has the buffer its voices are mixed into, and counts what it
+        mixed. doMixAllChannels() adds the counts up after every segment.
     */
+    struct MixLane {
+        MixBufferType*  buffer = nullptr;
+        std::uint64_t   nrVoiceFramesMixed = 0;
+        std::uint64_t   nrMixRoutineCalls = 0;
+    };
+
+    void            doMixAllChannels( MixBufferType* mixBuffer,unsigned nrSamples );
+    void            mixLanes( unsigned workerNr );
+    void            addLanes( MixBufferType* mixBuffer,unsigned nrLanes,unsigned nrSamples );
+    void            doMixChannel( 
+                        MixerChannel& mChn,
+                        MixLane& lane,
+                        unsigned nrSamples );
+    void            updateMixRoutines();
+    void            updateFadeOuts();
+    bool            readReplayState( ReplayStateReader& reader );
+    void            getRowKey( std::string& key,bool isFirstRow ) const;
 
-
-    int             doMixBuffer( DestBufferType* buffer );
-    void            doMixAllChannels( unsigned nrSamples );
-    void            doMixChannel(
-        DestBufferType* pBuffer,
-        std::int16_t* pSmpData,
-        int nrSamples,
-        float leftGain,
-        float rightGain,
-        float fracOffset,
-        float freqInc,
-        bool isMono
-        );
-
-    // Core mixing routines:
-    void            MixMonoSampleNoInterpolation(
-        DestBufferType* pBuffer,
-        std::int16_t* pSmpData,
-        int nrSamples,
-        float leftGain,
-        float rightGain,
-        float fracOffset,
-        float freqInc
-    );
-    void            MixMonoSampleLinearInterpolation(
-        DestBufferType* pBuffer,
-        std::int16_t* pSmpData,
-        int nrSamples,
-        float leftGain,
-        float rightGain,
-        float fracOffset,
-        float freqInc
-    );
-    void MixMonoSampleLinearInterpolation_sse41_v2( 
-        DestBufferType* pBuffer,
-        std::int16_t* pSmpData,
-        int nrSamples,
-        float leftGain,
-        float rightGain,
-        float fracOffset,
-        float freqInc 
-    );
-    void            MixMonoSampleCubicInterpolation(
-        DestBufferType* pBuffer,
-        std::int16_t* pSmpData,
-        int nrSamples,
-        float leftGain,
-        float rightGain,
-        float fracOffset,
-        float freqInc
-    );
-    void            MixMonoSampleSincInterpolation(
-        DestBufferType* pBuffer,
-        std::int16_t* pSmpData,
-        int nrSamples,
-        float leftGain,
-        float rightGain,
-        float fracOffset,
-        float freqInc
-    );
-    void            MixStereoSampleNoInterpolation(
-        DestBufferType* pBuffer,
-        std::int16_t* pSmpData,
-        int nrSamples,
-        float leftGain,
-        float rightGain,
-        float fracOffset,
-        float freqInc
-    );
-    void            MixStereoSampleLinearInterpolation(
-        DestBufferType* pBuffer,
-        std::int16_t* pSmpData,
-        int nrSamples,
-        float leftGain,
-        float rightGain,
-        float fracOffset,
-        float freqInc
-    );
-    void            MixStereoSampleCubicInterpolation(
-        DestBufferType* pBuffer,
-        std::int16_t* pSmpData,
-        int nrSamples,
-        float leftGain,
-        float rightGain,
-        float fracOffset,
-        float freqInc
-    );
-    void            MixStereoSampleSincInterpolation(
-        DestBufferType* pBuffer,
-        std::int16_t* pSmpData,
-        int nrSamples,
-        float leftGain,
-        float rightGain,
-        float fracOffset,
-        float freqInc
-    );
-
+public:
+    /*
+        Returns the mixing routine for the interpolation type and the 
+        variant, the fastest one the instruction set allows. The routines
+        for a lesser instruction set give exactly the same output. Public 
+        so that the routines can be benchmarked on their own, see 
+        Benchmark.h. The sinc routines use the table in SincTable.h.
+    */
+    static MixRoutine getMixRoutine( int isa,int interpolationType,int variant );
 
     /**************************************************************************
     *                                                                         *
@@ -1106,26 +1753,75 @@ private:
     */
     int             mxr_interpolationType_ = MXR_CUBIC_INTERPOLATION;
 
+    /*
+        The mixing routine for each variant, for the current instruction
+        set and interpolation type. See updateMixRoutines().
+    */
+    int             isa_ = CPU_ISA_SCALAR;
+    bool            useFloatSampleData_ = false;
+
+    MixRoutine      mixRoutines_[MXR_MIX_ROUTINE_VARIANTS];
+
     std::uint16_t   tempo_;
     std::uint16_t   ticksPerRow_;
 
+    /*
+        callBpm_ is the length of the current tick in frames. A tick is
+        seldom a whole nr of frames long, the part of a frame that is left
+        over is carried to the next tick in tickFraction_, so that the 
+        tempo is the same at every mix rate.
+    */
+    unsigned        mixRate_ = MXR_DEFAULT_MIXRATE;
+    std::int64_t    minPositionStep_ = 
+        (std::int64_t)(MXR_MIN_FREQUENCY * MXR_POSITION_ONE) / MXR_DEFAULT_MIXRATE;
     unsigned        callBpm_;
+    double          tickFraction_ = 0.0;
     unsigned        mixCount_;
     unsigned        mixIndex_;
+    std::uint64_t   nrVoiceFramesMixed_ = 0;
+    std::uint64_t   nrMixRoutineCalls_ = 0;
+
+    unsigned        framesPerBlock_ = 0;
+    unsigned        blockCount_ = MXR_DEFAULT_BLOCK_COUNT;
+    std::unique_ptr < DestBufferType[] > outputBuffer_;
+
+    /*
+        The lanes, and the segment that doMixAllChannels() has the workers
+        mix: mixLanes() reads these, see MXR_MIX_LANES. laneBuffers_ holds
+        the buffers of lanes 1 and up.
+    */
+    MixLane         lanes_[MXR_MIX_LANES];
+    std::unique_ptr < MixBufferType[] > laneBuffers_;
+    unsigned        nrLanesInSegment_ = 0;
+    unsigned        nrWorkersInSegment_ = 0;
+    unsigned        nrSamplesInSegment_ = 0;
+    MixerWorkerPool workerPool_{ [this]( unsigned workerNr ) { mixLanes( workerNr ); } };
 
-    std::unique_ptr < MixBufferType[] > mixBuffer_;
 
-    static CRITICAL_SECTION     waveCriticalSection_;
-    static WAVEHDR*             waveBlocks_;
-    static volatile int         waveFreeBlockCount_;
-    static int                  waveCurrentBlock_;
 
-    HWAVEOUT                    hWaveOut_;
-    WAVEFORMATEXTENSIBLE        waveFormatExtensible_;
-    WAVEFORMATEX                waveFormatEx_;
+    AudioSink*                  audioSink_ = nullptr;
 
     LogicalChannelInfo          logicalChannels_[MXR_MAX_LOGICAL_CHANNELS];
     MixerChannel                physicalChannels_[MXR_MAX_PHYSICAL_CHANNELS];
+
+    /*
+        The nrs of the physical channels that are playing, in the order 
+        they are mixed, and a stack with the nrs of the free channels. 
+        Every channel is on one of both, so that allocating a channel is 
+        O(1), and mixing and recalculating the volumes only cost time for
+        the voices that actually play.
+    */
+    int                         activeChannels_[MXR_MAX_PHYSICAL_CHANNELS];
+    int                         nrActiveChannels_ = 0;
+    int                         freeChannels_[MXR_MAX_PHYSICAL_CHANNELS];
+    int                         nrFreeChannels_ = 0;
+    unsigned                    maxVoices_ = MXR_MAX_PHYSICAL_CHANNELS;
+    int                         voiceStealingPolicy_ = MXR_STEAL_BACKGROUND_FIRST;
+    std::uint64_t               nrVoicesStolen_ = 0;
+    std::uint64_t               nrFramesMixed_ = 0;
+    std::uint64_t               nrBackgroundVoiceFramesMixed_ = 0;
+    unsigned                    peakBackgroundVoices_ = 0;
+
     Module*                     module_ = nullptr;
 
 
@@ -1143,8 +1839,18 @@ public:
     unsigned        periodToFrequency( unsigned period );
 
     void            updateBpm();
+    void            startTick();
 
     void            resetSong();
+    /*
+        Starts the song over with the module that is assigned, without 
+        forgetting where it ends as assignModule() does
+    */
+    void            restartSong();
+    /*
+        Runs analyzeSong() if the end of the song is not known yet
+    */
+    void            findSongEnd();
 
     /**************************************************************************
     *                                                                         *
@@ -1194,6 +1900,17 @@ private:
     unsigned        patternTableIdx_;
     unsigned        patternRow_;
 
+    /*
+        End of song detection: the song ends when the replay is about to 
+        read row nr passNrRows_, see analyzeSong(). It is UINT_MAX as long
+        as the end is not known. songEndMixIndex_ is the value of mixIndex_
+        at the moment the song ended.
+    */
+    unsigned        nrRowsRead_;
+    unsigned        passNrRows_ = UINT_MAX;
+    bool            songHasEnded_;
+    unsigned        songEndMixIndex_;
+
     /*
         Effect & note paremeters, effect memory
     */
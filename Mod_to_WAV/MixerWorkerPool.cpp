@@ -0,0 +1,80 @@
+#include <algorithm>
+#include <iostream>
+
+#include "MixerWorkerPool.h"
+
+int MixerWorkerPool::setNrWorkers( unsigned nrWorkers )
+{
+    if ( (nrWorkers < 1) || (nrWorkers > MIXERWORKERPOOL_MAX_WORKERS) ) {
+        std::cout << "\nInvalid nr of mixer threads: " << nrWorkers << "\n";
+        return -1;
+    }
+    if ( nrWorkers == getNrWorkers() )
+        return 0;
+    stopThreads();
+    isStopping_ = false;
+    // only the thread that calls run() changes jobNr_:
+    for ( unsigned workerNr = 1; workerNr < nrWorkers; workerNr++ )
+        threads_.push_back( std::thread( &MixerWorkerPool::workerLoop,this,workerNr,jobNr_ ) );
+    return 0;
+}
+
+void MixerWorkerPool::stopThreads()
+{
+    {
+        std::lock_guard< std::mutex > lock( mutex_ );
+        isStopping_ = true;
+    }
+    jobIsReady_.notify_all();
+    for ( std::thread& thread : threads_ )
+        thread.join();
+    threads_.clear();
+}
+
+/*
+    Worker 0 does its part while the other threads do theirs. Without 
+    help, there is no need to wake anyone up.
+*/
+void MixerWorkerPool::run( unsigned nrWorkers )
+{
+    nrWorkers = std::min( nrWorkers,getNrWorkers() );
+    if ( nrWorkers <= 1 ) {
+        job_( 0 );
+        return;
+    }
+    {
+        std::lock_guard< std::mutex > lock( mutex_ );
+        jobNr_++;
+        nrWorkersInJob_ = nrWorkers;
+        nrWorkersBusy_ = nrWorkers - 1;
+    }
+    jobIsReady_.notify_all();
+    job_( 0 );
+    std::unique_lock< std::mutex > lock( mutex_ );
+    jobIsDone_.wait( lock,[this] { return nrWorkersBusy_ == 0; } );
+}
+
+/*
+    A thread that is not needed for a job goes back to sleep. It might 
+    not wake up before the next job starts, but then it takes part in 
+    that job, the job nr tells it that there is one.
+*/
+void MixerWorkerPool::workerLoop( unsigned workerNr,std::uint64_t lastJobNr )
+{
+    std::unique_lock< std::mutex > lock( mutex_ );
+
+    for ( ;; ) {
+        jobIsReady_.wait( lock,[this,lastJobNr] { return isStopping_ || (jobNr_ != lastJobNr); } );
+        if ( isStopping_ )
+            return;
+        lastJobNr = jobNr_;
+        if ( workerNr >= nrWorkersInJob_ )
+            continue;
+        lock.unlock();
+        job_( workerNr );
+        lock.lock();
+        nrWorkersBusy_--;
+        if ( nrWorkersBusy_ == 0 )
+            jobIsDone_.notify_one();
+    }
+}
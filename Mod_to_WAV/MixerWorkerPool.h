@@ -0,0 +1,57 @@
+#pragma once
+// Worker threads that help the mixer to mix the voices of a block
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+    run() calls the job once for every worker nr, 0 .. nrWorkers - 1, and
+    returns when all calls are done. Worker 0 is the thread that calls 
+    run(), the other workers have a thread of their own that sleeps until
+    the next run(). The threads are started by setNrWorkers(), and stopped
+    by setNrWorkers( 1 ) or by the destructor. Only one thread may call 
+    run() and setNrWorkers().
+*/
+const unsigned MIXERWORKERPOOL_MAX_WORKERS = 64;
+
+class MixerWorkerPool {
+public:
+    typedef std::function< void( unsigned workerNr ) > Job;
+
+    MixerWorkerPool( Job job ) : job_( job ) {}
+    ~MixerWorkerPool() { stopThreads(); }
+
+    /*
+        Returns 0 on success, -1 if the nr is out of range
+    */
+    int             setNrWorkers( unsigned nrWorkers );
+    unsigned        getNrWorkers() const { return (unsigned)threads_.size() + 1; }
+
+    /*
+        Runs the job on the first nrWorkers workers, at most 
+        getNrWorkers(). The other threads stay asleep.
+    */
+    void            run( unsigned nrWorkers );
+
+private:
+    void            stopThreads();
+    void            workerLoop( unsigned workerNr,std::uint64_t lastJobNr );
+
+
+private:
+    Job                         job_;
+    std::vector< std::thread >  threads_;
+
+    // guarded by mutex_:
+    std::mutex                  mutex_;
+    std::condition_variable     jobIsReady_;
+    std::condition_variable     jobIsDone_;
+    std::uint64_t               jobNr_ = 0;
+    unsigned                    nrWorkersInJob_ = 0;
+    unsigned                    nrWorkersBusy_ = 0;
+    bool                        isStopping_ = false;
+};
@@ -25,13 +25,13 @@
 This code requires a byte to be 8 bits wide
 #endif
 
+#ifdef _WIN32
 #define NOMINMAX
 #include <windows.h>
-
-
 #include <conio.h>
 #include <mmsystem.h>
 #pragma comment (lib, "winmm.lib") 
+#endif
 #include <iostream>
 #include <fstream>
 #include <bitset>
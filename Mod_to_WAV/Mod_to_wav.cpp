@@ -1,14 +1,30 @@
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <algorithm>
+#include <thread>
+
 #include "Module.h"
 #include "Mixer.h"
+#include "AudioSink.h"
+#include "BatchRenderer.h"
+#include "Benchmark.h"
+
+#include "CpuFeatures.h"
+#include "RenderThread.h"
+#include "WaveFile.h"
+#include "WinMMSink.h"
 
-#include "conio.h"
-#include "../../../../../../../Program Files (x86)/Windows Kits/10/Include/10.0.18362.0/ucrt/conio.h"
+#ifdef _WIN32
+#include <conio.h>
+#endif
 
 // ****************************************************************************
 // ****************************************************************************
 // ******* Start of Benchmarking code *****************************************
 // ****************************************************************************
 // ****************************************************************************
+#ifdef _WIN32
 
 enum TimerToUseType { ttuUnknown,ttuHiRes,ttuClock };
 TimerToUseType TimerToUse = ttuUnknown;
@@ -131,6 +147,7 @@ double DoBench( Mixer &mixer )
 void startReplay( Mixer &mixer ) {
     mixer.startReplay();
 }
+#endif // _WIN32
 
 // ****************************************************************************
 // ****************************************************************************
@@ -138,16 +155,172 @@ void startReplay( Mixer &mixer ) {
 // ****************************************************************************
 // ****************************************************************************
 
+/*
+    Renders the module that was assigned to the mixer to a .wav file as fast
+    as the cpu allows. No sound device is opened and no keyboard input is
+    needed, so this can run unattended. Rendering stops at the end of the
+    song, see Mixer::isSongEnded().
+*/
+int renderToWaveFile( Mixer& mixer,const std::string& waveFileName,int sampleFormat )
+{
+    WaveFileSink waveFileSink( waveFileName,sampleFormat );
+    mixer.setAudioSink( &waveFileSink );
+
+    auto startTime = std::chrono::steady_clock::now();
+    int result = mixer.renderSong();
+    auto stopTime = std::chrono::steady_clock::now();
+    mixer.setAudioSink( nullptr );
+    if ( result )
+        return -1;
+
+    double renderTime = std::chrono::duration< double >( stopTime - startTime ).count();
+    double songTime = (double)waveFileSink.getFramesWritten() / (double)mixer.getMixRate();
+    std::cout
+        << "\nRendered " << std::fixed << std::setprecision( 2 ) << songTime
+        << " s of audio to " << waveFileName
+        << " in " << renderTime << " s ("
+        << (renderTime > 0.0 ? songTime / renderTime : 0.0)
+        << "x real time)\n" << std::defaultfloat;
+    if ( mixer.getNrVoicesStolen() > 0 )
+        std::cout << "Stole " << mixer.getNrVoicesStolen() << " voices\n";
+    /*
+        The notes that IT new note actions leave playing cost as much as
+        the others, this tells how many voices the song really needs
+    */
+    std::cout
+        << "Background voices: peak " << mixer.getPeakBackgroundVoices()
+        << ", average " << std::fixed << std::setprecision( 2 )
+        << mixer.getAverageBackgroundVoices() << "\n" << std::defaultfloat;
+    return 0;
+}
+
+int printSongAnalysis( Mixer& mixer )
+{
+    SongAnalysis analysis;
+    auto startTime = std::chrono::steady_clock::now();
+    if ( mixer.analyzeSong( analysis ) )
+        return -1;
+    auto stopTime = std::chrono::steady_clock::now();
+
+    double analysisTime = std::chrono::duration< double >( stopTime - startTime ).count();
+    double mixRate = (double)mixer.getMixRate();
+    double songTime = (double)analysis.nrFrames / mixRate;
+    std::cout
+        << "\nSong length: " << std::fixed << std::setprecision( 3 ) << songTime
+        << " s (" << analysis.nrFrames << " frames, " << analysis.nrRows << " rows)"
+        << "\nLoops to order " << analysis.loopOrderNr << ", row " << analysis.loopRowNr
+        << " at " << (double)analysis.loopFrameNr / mixRate 
+        << " s (frame " << analysis.loopFrameNr << ")"
+        << "\nAnalyzed in " << std::setprecision( 2 ) << analysisTime * 1000.0 << " ms ("
+        << std::setprecision( 0 ) << (analysisTime > 0.0 ? songTime / analysisTime : 0.0)
+        << "x real time)\n" << std::defaultfloat;
+    return 0;
+}
+
+int writeSeekIndex( Mixer& mixer,Module& module,unsigned intervalSeconds )
+{
+    auto startTime = std::chrono::steady_clock::now();
+    if ( mixer.buildSeekIndex( intervalSeconds ) )
+        return -1;
+    auto stopTime = std::chrono::steady_clock::now();
+    if ( module.saveSeekIndex() )
+        return -1;
+
+    const SeekIndex& seekIndex = module.getSeekIndex();
+    double buildTime = std::chrono::duration< double >( stopTime - startTime ).count();
+    std::cout
+        << "\nWrote " << seekIndex.getNrKeyframes() << " keyframes, one every "
+        << intervalSeconds << " s, to " << module.getFileName() << SEEKINDEX_FILE_EXTENSION
+        << "\nSnapshots take " << seekIndex.getSize() / 1024 << " kB, built in "
+        << std::fixed << std::setprecision( 2 ) << buildTime << " s\n" << std::defaultfloat;
+    return 0;
+}
+
 /*
 1 pixel = 1 tick, ft2 envelope window width == 6 sec
 vibrato is active even if envelope is not
 vibrato sweep: amount of ticks before vibrato reaches max. amplitude
 */
 
+/*
+    Command line:
+        Mod_to_WAV [-render] [-format=16|24|float] 
+            [-latency=interactive|normal|batch] [-blocksize=<frames>]
+            [-rate=<Hz>] [-interpolation=none|linear|cubic|sinc]
+            [-isa=scalar|sse2|sse4.1|avx2] [-voices=<n>]
+            [-steal=oldest|quietest|background] [-sampledata=16|float]
+            [-threads=<n>] <file> [<file> ...]
+        Mod_to_WAV -batch [-workers=<n>] [-inflight=<n>] [-list=<file>]
+            [<render options>] <file or directory> [...]
+        Mod_to_WAV -analyze [-rate=<Hz>] <file> [<file> ...]
+        Mod_to_WAV -index[=<seconds>] [<render options>] <file> [...]
+        Mod_to_WAV -bench=<name> [<file> ...]
+
+    -render     render each file to <file>.wav instead of playing it
+    -format=    sample format of the .wav file, 32 bit float by default
+    -latency=   block size and count of the mixer, see Mixer.h. Normal by 
+                default, batch by default for -render
+    -blocksize= block size of the mixer in frames, overrides -latency
+    -rate=      mix rate in Hz, 22050 .. 192000, 44100 by default
+    -interpolation= resampling quality, cubic by default. Sinc is the best
+                and slowest, for mastering quality renders
+    -isa=       limit the instruction set of the mixing routines, the best
+                one the cpu supports by default. See CpuFeatures.h, also for
+                the MXR_ISA environment variable that does the same.
+    -voices=    polyphony cap, 1 .. 256, 256 by default. Notes beyond the
+                cap steal a voice
+    -steal=     which voice to steal, see MXR_STEAL_OLDEST in Mixer.h. 
+                Background by default
+    -sampledata= mix from the sample data as it was loaded, 8 or 16 bit 
+                (default), or from a float copy of it, which is faster but
+                takes three to five times the memory
+
+    -threads=   nr of threads that mix the voices, 1 .. 8, 1 by default.
+                The output is the same for any nr of threads
+    -batch      render each file, and each module file in the directories
+                and their subdirectories, to <file>.wav on a pool of 
+                workers, several files at the same time. See BatchRenderer.h
+    -workers=   nr of batch workers, the nr of hardware threads by default
+    -inflight=  max nr of modules in memory at the same time, as many as 
+                there are workers by default
+    -list=      also render the files and directories listed in this text
+                file, one per line
+    -analyze    print the exact length and the loop point of each file, 
+                found without mixing, see Mixer::analyzeSong()
+    -index=     write a seek index with a keyframe every so many seconds,
+                1 .. 60, 4 by default, to <file>.seek. See SeekIndex.h. It
+                only holds for the mix rate it was made at.
+    -bench=     run a benchmark on the file, or on the files for the 
+                benchmarks that take a corpus, see Benchmark.h
+
+    Real time playback uses the winmm backend, so it is only available on
+    windows. Rendering works everywhere.
+*/
 int main( int argc, char *argv[] )  
 { 
     std::vector< std::string > filePaths;
-    char        *modPaths[] = {
+    bool        renderMode = false;
+    int         waveSampleFormat = WAV_SAMPLE_FORMAT_FLOAT32;
+    int         latencyProfile = -1;
+    unsigned    blockSize = 0;
+    unsigned    mixRate = MXR_DEFAULT_MIXRATE;
+    int         interpolationType = MXR_CUBIC_INTERPOLATION;
+    int         requestedIsa = -1;
+    unsigned    maxVoices = MXR_MAX_PHYSICAL_CHANNELS;
+    int         voiceStealingPolicy = MXR_STEAL_BACKGROUND_FIRST;
+    bool        useFloatSampleData = false;
+    unsigned    nrThreads = 1;
+    bool        batchMode = false;
+    bool        analyzeMode = false;
+    bool        seekIndexMode = false;
+    unsigned    seekIndexInterval = SEEKINDEX_DEFAULT_INTERVAL;
+    unsigned    nrBatchWorkers = std::min( 
+        std::max( std::thread::hardware_concurrency(),1u ),BATCH_MAX_WORKERS );
+    unsigned    maxModulesInFlight = 0;
+    std::vector< std::string > fileListNames;
+    std::string benchmarkName;
+#ifdef _WIN32
+    const char  *modPaths[] = {
         "D:\\MODS\\M2W_BUGTEST\\blue_valclicktest.s3m",
         "D:\\MODS\\M2W_BUGTEST\\dope_clicktest2.mod",
         "D:\\MODS\\dosprog\\stardstm.mod",
@@ -312,6 +485,7 @@ int main( int argc, char *argv[] )
         /* */
         nullptr
     };
+#endif
 
 
     /*
@@ -366,49 +540,97 @@ int main( int argc, char *argv[] )
     */
 
 
-    /*
-    const float freqInc = 0.70000001f;
-    const float smpOfs = 0.2999999f;
-    const int nrLoops = 1000;
-    const float freqInc4 = freqInc * 4.0f;
-    float test1 = smpOfs;
-    float test2 = smpOfs;
-
-
-    std::cout
-        << "\nfreqInc = " << freqInc
-        << "\nsmpOfs  = " << smpOfs
-        << "\nnrLoops = " << nrLoops
-        << "\nfreqInc * 4 = " << freqInc4
-        ;
-
-    for ( int i = 0; i < nrLoops; i++ ) {
-        test1 += freqInc;
-        if ( (i % 4) == 0 )
-            test2 += freqInc4;
+    for ( int i = 1; i < argc; i++ ) {
+        std::string arg( argv[i] );
+        if ( arg == "-render" )
+            renderMode = true;
+        else if ( arg == "-format=16" )
+            waveSampleFormat = WAV_SAMPLE_FORMAT_PCM16;
+        else if ( arg == "-format=24" )
+            waveSampleFormat = WAV_SAMPLE_FORMAT_PCM24;
+        else if ( arg == "-format=float" )
+            waveSampleFormat = WAV_SAMPLE_FORMAT_FLOAT32;
+        else if ( arg == "-latency=interactive" )
+            latencyProfile = MXR_LATENCY_INTERACTIVE;
+        else if ( arg == "-latency=normal" )
+            latencyProfile = MXR_LATENCY_NORMAL;
+        else if ( arg == "-latency=batch" )
+            latencyProfile = MXR_LATENCY_BATCH;
+        else if ( arg.compare( 0,11,"-blocksize=" ) == 0 )
+            blockSize = (unsigned)std::strtoul( arg.c_str() + 11,nullptr,10 );
+        else if ( arg == "-interpolation=none" )
+            interpolationType = MXR_NO_INTERPOLATION;
+        else if ( arg == "-interpolation=linear" )
+            interpolationType = MXR_LINEAR_INTERPOLATION;
+        else if ( arg == "-interpolation=cubic" )
+            interpolationType = MXR_CUBIC_INTERPOLATION;
+        else if ( arg == "-interpolation=sinc" )
+            interpolationType = MXR_SINC_INTERPOLATION;
+        else if ( arg.compare( 0,5,"-isa=" ) == 0 ) {
+            int isa = cpuGetIsaByName( arg.c_str() + 5 );
+            if ( isa < 0 ) {
+                std::cout << "\nUnknown instruction set: " << arg.c_str() + 5 << "\n";
+                return 1;
+            }
+            requestedIsa = isa;
+        } else if ( arg.compare( 0,6,"-rate=" ) == 0 )
+            mixRate = (unsigned)std::strtoul( arg.c_str() + 6,nullptr,10 );
+        else if ( arg.compare( 0,8,"-voices=" ) == 0 )
+            maxVoices = (unsigned)std::strtoul( arg.c_str() + 8,nullptr,10 );
+        else if ( arg == "-steal=oldest" )
+            voiceStealingPolicy = MXR_STEAL_OLDEST;
+        else if ( arg == "-steal=quietest" )
+            voiceStealingPolicy = MXR_STEAL_QUIETEST;
+        else if ( arg == "-steal=background" )
+            voiceStealingPolicy = MXR_STEAL_BACKGROUND_FIRST;
+        else if ( arg == "-sampledata=16" )
+            useFloatSampleData = false;
+        else if ( arg == "-sampledata=float" )
+            useFloatSampleData = true;
+        else if ( arg.compare( 0,9,"-threads=" ) == 0 )
+            nrThreads = (unsigned)std::strtoul( arg.c_str() + 9,nullptr,10 );
+        else if ( arg == "-batch" )
+            batchMode = true;
+        else if ( arg == "-analyze" )
+            analyzeMode = true;
+        else if ( arg == "-index" )
+            seekIndexMode = true;
+        else if ( arg.compare( 0,7,"-index=" ) == 0 ) {
+            seekIndexMode = true;
+            seekIndexInterval = (unsigned)std::strtoul( arg.c_str() + 7,nullptr,10 );
+        } else if ( arg.compare( 0,9,"-workers=" ) == 0 )
+            nrBatchWorkers = (unsigned)std::strtoul( arg.c_str() + 9,nullptr,10 );
+        else if ( arg.compare( 0,10,"-inflight=" ) == 0 )
+            maxModulesInFlight = (unsigned)std::strtoul( arg.c_str() + 10,nullptr,10 );
+        else if ( arg.compare( 0,6,"-list=" ) == 0 )
+            fileListNames.push_back( arg.substr( 6 ) );
+        else if ( arg.compare( 0,7,"-bench=" ) == 0 )
+            benchmarkName = arg.substr( 7 );
+        else if ( arg[0] == '-' ) {
+            std::cout << "\nUnknown option: " << arg << "\n";
+            return 1;
+        } else
+            filePaths.push_back( arg );
     }
-
-    std::cout
-        << "\n\n" << smpOfs << " + freqInc (" << nrLoops << "x) = " << test1
-        << "\n" << smpOfs << " + freqInc * 4 (" << (nrLoops >> 2) << "x) = " << test2
-        << "\n" << smpOfs << " + freqInc * " << nrLoops << " = " << (smpOfs + freqInc * nrLoops)
-        ;
-    _getch();
-    */
-
-
-
-
-
-
-
-
-
-    if (argc > 1) {
-        for ( int i = 1; i < argc; i++ ) 
-            filePaths.push_back( argv[i] );
-    } 
-    else {
+    int isa = cpuSelectIsa( requestedIsa );
+    if ( !benchmarkName.empty() )
+        return MixerBenchmark::run( benchmarkName,filePaths,isa ) ? 1 : 0;
+
+    if ( batchMode || analyzeMode || seekIndexMode )
+        renderMode = true;
+    if ( renderMode && filePaths.empty() && fileListNames.empty() ) {
+        std::cout << "\nUsage: " << argv[0]
+            << " -render [-format=16|24|float] <modfile> [<modfile> ...]\n";
+        return 1;
+    }
+#ifndef _WIN32
+    if ( !renderMode ) {
+        std::cout << "\nReal time playback is only available on windows, use -render\n";
+        return 1;
+    }
+#endif
+#ifdef _WIN32
+    if ( filePaths.empty() ) {
         /*
         if ( (!strcmp(argv[0], 
             "C:\\Users\\Erland-i5\\Documents\\Visual Studio 2019\\Projects\\Mod_to_WAV\\Debug\\Mod_to_WAV.exe")) ||
@@ -439,17 +661,102 @@ int main( int argc, char *argv[] )
             }
         }
     }
+#endif
 
 	Mixer       mixer;
+    int         errorCount = 0;
+    if ( latencyProfile < 0 )
+        latencyProfile = renderMode ? MXR_LATENCY_BATCH : MXR_LATENCY_NORMAL;
+    mixer.setLatencyProfile( latencyProfile );
+    if ( blockSize && mixer.setBlockSize( blockSize ) )
+        return 1;
+    if ( mixer.setMixRate( mixRate ) )
+        return 1;
+    mixer.setInterpolationType( interpolationType );
+    if ( mixer.setIsa( isa ) )
+        return 1;
+    if ( mixer.setMaxVoices( maxVoices ) )
+        return 1;
+    mixer.setVoiceStealingPolicy( voiceStealingPolicy );
+    mixer.setFloatSampleData( useFloatSampleData );
+    if ( mixer.setNrThreads( nrThreads ) )
+        return 1;
+
+    if ( analyzeMode || seekIndexMode ) {
+        for ( std::string& filePath : filePaths ) {
+            Module moduleFile;
+            moduleFile.loadFile( filePath );
+            std::cout << "\n\nLoading " << filePath
+                << ": " << (moduleFile.isLoaded() ? "Success." : "Error!\n");
+            if ( !moduleFile.isLoaded() ) {
+                errorCount++;
+                continue;
+            }
+            mixer.assignModule( &moduleFile );
+            if ( analyzeMode && printSongAnalysis( mixer ) )
+                errorCount++;
+            if ( seekIndexMode && writeSeekIndex( mixer,moduleFile,seekIndexInterval ) )
+                errorCount++;
+        }
+        return errorCount ? 1 : 0;
+    }
+
+
+    if ( batchMode ) {
+        BatchRenderSettings settings;
+        settings.latencyProfile = latencyProfile;
+        settings.blockSize = blockSize;
+        settings.mixRate = mixRate;
+        settings.interpolationType = interpolationType;
+        settings.isa = isa;
+        settings.maxVoices = maxVoices;
+        settings.voiceStealingPolicy = voiceStealingPolicy;
+        settings.useFloatSampleData = useFloatSampleData;
+        settings.nrMixerThreads = nrThreads;
+        settings.waveSampleFormat = waveSampleFormat;
+        BatchRenderer batchRenderer( settings );
+        if ( batchRenderer.setNrWorkers( nrBatchWorkers ) )
+            return 1;
+        batchRenderer.setMaxModulesInFlight( maxModulesInFlight );
+        for ( const std::string& fileListName : fileListNames )
+            if ( batchRenderer.addFileList( fileListName ) )
+                return 1;
+        for ( const std::string& filePath : filePaths )
+            if ( batchRenderer.addPath( filePath ) )
+                return 1;
+        std::cout << "\nMixing with the " << cpuGetIsaName( mixer.getIsa() ) << " routines";
+        return batchRenderer.run() ? 1 : 0;
+    }
+
+
+    if ( renderMode )
+        std::cout << "\nMixing with the " << cpuGetIsaName( mixer.getIsa() ) << " routines";
+#ifdef _WIN32
+    WinMMSink   winMMSink;
+    mixer.setAudioSink( &winMMSink );
+#endif
     for (unsigned i = 0; i < filePaths.size(); i++) {
 
         Module      moduleFile;
-        moduleFile.enableDebugMode();
+        if ( !renderMode )
+            moduleFile.enableDebugMode();
         moduleFile.loadFile( filePaths[i] );
 
         std::cout << "\n\nLoading " << filePaths[i] // moduleFilename
                   << ": " << (moduleFile.isLoaded() ? "Success." : "Error!\n");
 
+        if ( renderMode ) {
+            if ( !moduleFile.isLoaded() ) {
+                errorCount++;
+                continue;
+            }
+            mixer.assignModule( &moduleFile );
+            if ( renderToWaveFile( mixer,filePaths[i] + ".wav",waveSampleFormat ) )
+                errorCount++;
+            continue;
+        }
+
+#ifdef _WIN32
         if ( moduleFile.isLoaded () ) {
             /*
             unsigned s = BLOCK_SIZE / (MIXRATE * 2); // * 2 for stereo
@@ -488,14 +795,18 @@ int main( int argc, char *argv[] )
 
 
 
-            mixer.startReplay();
-
-            while ( !_kbhit() ) {
-                mixer.updateWaveBuffers();
-                Sleep( 10 ); // give time slices back to windows
+            RenderThread renderThread( mixer );
+            if ( renderThread.start() == 0 ) {
+                while ( !_kbhit() ) 
+                    Sleep( 10 ); // give time slices back to windows
+                _getch();
+                renderThread.stop();
+                std::cout
+                    << "\nBuffer size: " << winMMSink.getCapacity()
+                    << " frames, underruns: " << winMMSink.getUnderrunCount()
+                    << ", low watermark: " << winMMSink.getLowWatermark()
+                    << ", high watermark: " << winMMSink.getHighWatermark();
             }
-            _getch();
-            mixer.stopReplay();
 
             /*
             std::cout 
@@ -524,6 +835,7 @@ int main( int argc, char *argv[] )
         }
         std::cout << "\nHit any key to load next / exit...";
         _getch();  
+#endif
     }
 /*
     std::cout << "\nHit any key to start memory leak test.";
@@ -536,8 +848,12 @@ int main( int argc, char *argv[] )
         std::cout << ", for the " << (i + 1) << "th time";
     }
     */
+    if ( renderMode )
+        return errorCount ? 1 : 0;
+#ifdef _WIN32
     std::cout << "\nHit any key to exit program.";
     _getch();
+#endif
 	return 0;
 }
 
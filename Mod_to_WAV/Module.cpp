@@ -1,8 +1,10 @@
 #include <cstdio>
+#ifdef _WIN32
 #include <conio.h>
 #include <windows.h>
 #include <mmsystem.h>
 #pragma comment (lib, "winmm.lib") 
+#endif
 #include <iostream>
 #include <fstream>
 #include <cstring>
@@ -25,6 +27,126 @@ Module::Module()
     instruments_[0] = std::make_unique< Instrument >( InstrumentHeader() );
 }
 
+void Module::setFloatSampleData( bool useFloatData )
+{
+    for ( int sampleNr = 0; sampleNr < MAX_SAMPLES; sampleNr++ ) {
+        if ( !samples_[sampleNr] )
+            continue;
+        if ( useFloatData )
+            samples_[sampleNr]->createFloatData();
+        else
+            samples_[sampleNr]->freeFloatData();
+    }
+}
+
+void Module::widenSampleData()
+{
+    for ( int sampleNr = 0; sampleNr < MAX_SAMPLES; sampleNr++ )
+        if ( samples_[sampleNr] )
+            samples_[sampleNr]->widenTo16Bit();
+}
+
+std::size_t Module::getSampleDataSize() const
+{
+    std::size_t size = 0;
+    for ( int sampleNr = 0; sampleNr < MAX_SAMPLES; sampleNr++ )
+        if ( samples_[sampleNr] )
+            size += samples_[sampleNr]->getDataSize();
+    return size;
+}
+
+int Module::getSampleNr( const Sample* pSample ) const
+{
+    if ( pSample == nullptr )
+        return -1;
+    for ( int sampleNr = 0; sampleNr < MAX_SAMPLES; sampleNr++ )
+        if ( samples_[sampleNr].get() == pSample )
+            return sampleNr;
+    return -1;
+}
+
+int Module::getInstrumentNr( const Instrument* pInstrument ) const
+{
+    if ( pInstrument == nullptr )
+        return -1;
+    for ( int instrumentNr = 0; instrumentNr < MAX_INSTRUMENTS; instrumentNr++ )
+        if ( instruments_[instrumentNr].get() == pInstrument )
+            return instrumentNr;
+    return -1;
+}
+
+int Module::saveSeekIndex() const
+{
+    return seekIndex_.save( fileName_ + SEEKINDEX_FILE_EXTENSION,getChecksum() );
+}
+
+int Module::loadSeekIndex()
+{
+    return seekIndex_.load( fileName_ + SEEKINDEX_FILE_EXTENSION,getChecksum() );
+}
+
+namespace ModuleChecksumHelperFn {
+    const std::uint32_t FNV_OFFSET_BASIS = 2166136261u;
+    const std::uint32_t FNV_PRIME = 16777619u;
+
+    void addToChecksum( std::uint32_t& checksum,unsigned value )
+    {
+        for ( int i = 0; i < 4; i++ ) {
+            checksum ^= (value >> (i * 8)) & 0xFF;
+            checksum *= FNV_PRIME;
+        }
+    }
+}
+
+std::uint32_t Module::getChecksum() const
+{
+    using namespace ModuleChecksumHelperFn;
+    std::uint32_t checksum = FNV_OFFSET_BASIS;
+    addToChecksum( checksum,nrChannels_ );
+    addToChecksum( checksum,nrSamples_ );
+    addToChecksum( checksum,nrInstruments_ );
+    addToChecksum( checksum,nrPatterns_ );
+    addToChecksum( checksum,songLength_ );
+    addToChecksum( checksum,songRestartPosition_ );
+    addToChecksum( checksum,defaultTempo_ );
+    addToChecksum( checksum,defaultBpm_ );
+    for ( unsigned i = 0; i < songLength_; i++ )
+        addToChecksum( checksum,patternTable_[i] );
+    for ( int patternNr = 0; patternNr < MAX_PATTERNS; patternNr++ ) {
+        Pattern* pattern = patterns_[patternNr].get();
+        if ( pattern == nullptr )
+            continue;
+        addToChecksum( checksum,patternNr );
+        addToChecksum( checksum,pattern->getnRows() );
+        for ( unsigned i = 0; i < pattern->getSize(); i++ ) {
+            Note note = pattern->getNote( i );
+            addToChecksum( checksum,note.note | (note.instrument << 8) );
+            for ( int column = 0; column < MAX_EFFECT_COLUMNS; column++ )
+                addToChecksum( checksum,
+                    note.effects[column].effect | (note.effects[column].argument << 8) );
+        }
+    }
+    for ( int sampleNr = 0; sampleNr < MAX_SAMPLES; sampleNr++ ) {
+        const Sample* sample = samples_[sampleNr].get();
+        if ( sample == nullptr )
+            continue;
+        addToChecksum( checksum,sampleNr );
+        addToChecksum( checksum,sample->getLength() );
+        addToChecksum( checksum,sample->getRepeatOffset() );
+        addToChecksum( checksum,sample->getRepeatLength() );
+    }
+    return checksum;
+}
+
+std::size_t Module::getFloatSampleDataSize() const
+{
+    std::size_t size = 0;
+    for ( int sampleNr = 0; sampleNr < MAX_SAMPLES; sampleNr++ )
+        if ( samples_[sampleNr] )
+            size += samples_[sampleNr]->getFloatDataSize();
+    return size;
+}
+
 void Module::playSampleNr( int sampleNr )
 {
     if ( !samples_[sampleNr] ) {
@@ -55,7 +177,23 @@ void Module::playSampleNr( int sampleNr )
             << "\nSample " << sampleNr << ": finetune = "
             << samples_[sampleNr]->getFinetune()            
             */            
-    if ( samples_[sampleNr]->getData() ) {
+#ifndef _WIN32
+    // sample preview uses the windows wave out functions directly
+    std::cout << "\nSample preview is only available on windows.";
+#else
+    // the wave out functions get 16 bit data, also for 8 bit samples:
+    const Sample&   sample = *samples_[sampleNr];
+    std::vector< std::int16_t > widenedData;
+    const std::int16_t* data = sample.getData();
+    if ( sample.has8BitData() ) {
+        unsigned nrSamplePoints = sample.isStereo() ? 
+            sample.getLength() * 2 : sample.getLength();
+        widenedData.resize( nrSamplePoints );
+        for ( unsigned i = 0; i < nrSamplePoints; i++ )
+            widenedData[i] = (std::int16_t)(sample.get8BitData()[i] * 256);
+        data = widenedData.data();
+    }
+    if ( data ) {
         HWAVEOUT        hWaveOut;
         WAVEFORMATEX    waveFormatEx;
         MMRESULT        result;
@@ -82,7 +220,7 @@ void Module::playSampleNr( int sampleNr )
                 std::cout << "\nWave mapper successfully opened!\n";
             waveHdr.dwBufferLength = samples_[sampleNr]->getLength() *
                 waveFormatEx.nBlockAlign;
-            waveHdr.lpData = (LPSTR)(samples_[sampleNr]->getData());
+            waveHdr.lpData = (LPSTR)data;
             waveHdr.dwFlags = 0;
             result = waveOutPrepareHeader( hWaveOut,&waveHdr,
                 sizeof( WAVEHDR ) );
@@ -170,13 +308,14 @@ void Module::playSampleNr( int sampleNr )
             waveOutClose( hWaveOut );
         }
     }
+#endif
 }
 
 int Module::loadFile() {
     assert( isLoaded() == false );
 
     VirtualFile virtualFile( fileName_ );
-    if ( virtualFile.getIOError() != NO_ERROR )
+    if ( virtualFile.getIOError() != VIRTFILE_NO_ERROR )
         return -1;
 
     int result = -1;
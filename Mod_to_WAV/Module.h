@@ -69,10 +69,11 @@ EEx extra-finely increases note pitch by applying with 4 times the precision of
 #include <vector>
 #include <iterator>
 
-#include "constants.h"
-#include "pattern.h"
-#include "sample.h"
-#include "instrument.h"
+#include "Constants.h"
+#include "Pattern.h"
+#include "Sample.h"
+#include "Instrument.h"
+#include "SeekIndex.h"
 #include "virtualfile.h"
 
 // forward declarations for linker:
@@ -129,6 +130,40 @@ public:
         assert( instrument <= MAX_INSTRUMENTS );
         return (instruments_[instrument] ? *(instruments_[instrument]) : *(instruments_[0]));
     }
+    /*
+        The nr of the sample or instrument that the pointer points to, -1
+        if it is not one of this module. For the replay state snapshots, 
+        see Mixer::saveReplayState().
+    */
+    int             getSampleNr( const Sample* pSample ) const;
+    int             getInstrumentNr( const Instrument* pInstrument ) const;
+    /*
+        Creates or frees the float copy of the data of every sample, see 
+        Sample::createFloatData(). Widens the data of the 8 bit samples to
+        16 bit, see Sample::widenTo16Bit(). The memory used by the 8 and 16
+        bit data and by the float copies, in bytes.
+    */
+    void            setFloatSampleData( bool useFloatData );
+    void            widenSampleData();
+
+    std::size_t     getSampleDataSize() const;
+    std::size_t     getFloatSampleDataSize() const;
+    /*
+        The seek index of the song, see SeekIndex.h. It is empty until 
+        Mixer::buildSeekIndex() or loadSeekIndex() fills it. The file is 
+        the module file name + SEEKINDEX_FILE_EXTENSION. loadSeekIndex() 
+        returns -1 if there is no such file or if it does not fit the 
+        module, saveSeekIndex() returns -1 if it could not be written.
+    */
+    SeekIndex&      getSeekIndex() { return seekIndex_; }
+    int             saveSeekIndex() const;
+    int             loadSeekIndex();
+    /*
+        A checksum (FNV-1a) of what the replay state snapshots depend on:
+        the order list, the patterns and the sample lengths and loops
+    */
+    std::uint32_t   getChecksum() const;
+
     Pattern&        getPattern( unsigned pattern )
     { 
         assert( pattern < MAX_PATTERNS );
@@ -170,6 +205,7 @@ private:
             std::vector<Note>( PLAYER_MAX_CHANNELS * DEFAULT_NR_PATTERN_ROWS )
         );
     Instrument      emptyInstrument_ = Instrument( InstrumentHeader() );
+    SeekIndex       seekIndex_;
 
 private:
     int             loadFile();
@@ -4,7 +4,7 @@
 #include <cassert>
 #include <vector>
 
-#include "constants.h"
+#include "Constants.h"
 
 /*
     todo:
@@ -48,6 +48,10 @@ public:
     { 
         return nRows_; 
     }
+    unsigned    getSize() 
+    { 
+        return size_; 
+    }
     Note        getNote( unsigned n ) 
     { 
         assert( n < size_ );
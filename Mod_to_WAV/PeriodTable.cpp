@@ -0,0 +1,39 @@
+#include <cmath>
+
+#include "PeriodTable.h"
+
+/*
+    (note - 1) + finetune / 128 is exact in a double, so every note and 
+    finetune pair that ends up at the same index of the table has the same
+    period: the table can be filled one index at a time.
+*/
+PeriodTable::PeriodTable()
+{
+    for ( int idx = 0; idx < PERIOD_TABLE_AMIGA_SIZE; idx++ ) {
+        int finetune = idx - PERIOD_TABLE_MAX_FINETUNE;
+        amigaPeriods_[idx] = (std::uint16_t)calcAmigaPeriod( 1,finetune );
+    }
+    for ( unsigned period = 0; period < PERIOD_TABLE_LINEAR_SIZE; period++ )
+        linearFrequencies_[period] = calcLinearFrequency( period );
+}
+
+/*
+    period = (1712 / 128) * 2 ^ [ ( 132 - (note - 1) - finetune / 128 ) / 12 ]
+*/
+unsigned PeriodTable::calcAmigaPeriod( unsigned note,int finetune )
+{
+    return (unsigned)(
+        pow( 2.0,
+        ((11.0 * 12.0) - ((double)(note - 1) + ((double)finetune / 128.0))) / 12.0
+        )
+        * (1712.0 / 128.0)
+        );
+}
+
+/*
+    frequency = 8363 * 2 ^ [ (4608 - period) / 768 ]
+*/
+unsigned PeriodTable::calcLinearFrequency( unsigned period )
+{
+    return (unsigned)(8363 * pow( 2,((4608.0 - (double)period) / 768.0) ));
+}
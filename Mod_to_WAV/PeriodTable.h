@@ -0,0 +1,64 @@
+#pragma once
+// Precomputed Amiga periods and linear frequencies for the replay routines
+
+#include <cstdint>
+
+#include "Constants.h"
+
+/*
+    Amiga periods are looked up per 1/128 of a semitone: (note - 1) * 128 +
+    finetune. The table covers all notes with a finetune of up to 
+    PERIOD_TABLE_MAX_FINETUNE either way, so that a relative note plus a 
+    finetune fits in as well.
+
+    Linear frequencies are looked up per period. Above 
+    PERIOD_TABLE_LINEAR_SIZE periods the frequency is below 1 Hz, so it is 0.
+*/
+const int   PERIOD_TABLE_FINETUNE_STEPS = 128;
+const int   PERIOD_TABLE_MAX_FINETUNE = 2 * PERIOD_TABLE_FINETUNE_STEPS;
+const int   PERIOD_TABLE_AMIGA_SIZE = 
+                MAXIMUM_NOTES * PERIOD_TABLE_FINETUNE_STEPS + 2 * PERIOD_TABLE_MAX_FINETUNE;
+const int   PERIOD_TABLE_LINEAR_SIZE = 4608 + 768 * 14;
+
+class PeriodTable {
+public:
+    /*
+        The tables are built on the first call, the Mixer constructor makes 
+        sure this happens at startup rather than in the middle of a song.
+    */
+    static const PeriodTable& get()
+    {
+        static const PeriodTable periodTable;
+        return periodTable;
+    }
+
+    /*
+        The formulas the tables are made of. The table lookups below give
+        exactly the same results, and fall back on these when the note or
+        the period lies outside the table.
+    */
+    static unsigned calcAmigaPeriod( unsigned note,int finetune );
+    static unsigned calcLinearFrequency( unsigned period );
+
+    unsigned        getAmigaPeriod( unsigned note,int finetune ) const
+    {
+        int idx = (int)(note - 1) * PERIOD_TABLE_FINETUNE_STEPS + finetune + 
+            PERIOD_TABLE_MAX_FINETUNE;
+        if ( (note == 0) || (idx < 0) || (idx >= PERIOD_TABLE_AMIGA_SIZE) )
+            return calcAmigaPeriod( note,finetune );
+        return amigaPeriods_[idx];
+    }
+    unsigned        getLinearFrequency( unsigned period ) const
+    {
+        if ( period >= PERIOD_TABLE_LINEAR_SIZE )
+            return calcLinearFrequency( period );
+        return linearFrequencies_[period];
+    }
+
+private:
+    PeriodTable();
+
+private:
+    std::uint16_t   amigaPeriods_[PERIOD_TABLE_AMIGA_SIZE];
+    std::uint32_t   linearFrequencies_[PERIOD_TABLE_LINEAR_SIZE];
+};
@@ -0,0 +1,36 @@
+#include <chrono>
+
+#include "RenderThread.h"
+
+int RenderThread::start()
+{
+    if ( isRunning_ )
+        return 0;
+    if ( mixer_.startReplay() )
+        return -1;
+    isRunning_ = true;
+    thread_ = std::thread( &RenderThread::run,this );
+    return 0;
+}
+
+void RenderThread::stop()
+{
+    if ( !isRunning_ )
+        return;
+    isRunning_ = false;
+    thread_.join();
+    mixer_.stopReplay();
+}
+
+/*
+    Whenever the sink has room, fill it up. Then give the time slice back:
+    the sink holds enough audio to bridge the sleep.
+*/
+void RenderThread::run()
+{
+    while ( isRunning_ ) {
+        mixer_.updateWaveBuffers();
+        std::this_thread::sleep_for( 
+            std::chrono::milliseconds( RENDER_THREAD_SLEEP_TIME ) );
+    }
+}
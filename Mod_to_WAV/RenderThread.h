@@ -0,0 +1,41 @@
+#pragma once
+// Dedicated thread that keeps the audio sink of a mixer filled
+
+#include <atomic>
+#include <thread>
+
+#include "Mixer.h"
+
+/*
+    Calls Mixer::updateWaveBuffers() in a loop until stopped. Use this with
+    a real time sink such as the RingBufferSink: the render thread is the
+    only producer, the sound device is the only consumer. While the thread
+    runs, no other thread may touch the mixer.
+*/
+const int RENDER_THREAD_SLEEP_TIME = 1;     // in milliseconds
+
+class RenderThread {
+public:
+    RenderThread( Mixer& mixer ) : mixer_( mixer ) {}
+    ~RenderThread() { stop(); }
+
+    /*
+        Opens the sink (Mixer::startReplay()) and starts the thread.
+        Returns 0 on success, -1 on error.
+    */
+    int             start();
+
+    /*
+        Stops the thread and closes the sink.
+    */
+    void            stop();
+    bool            isRunning() const { return isRunning_; }
+
+private:
+    void            run();
+
+private:
+    Mixer&              mixer_;
+    std::thread         thread_;
+    std::atomic< bool > isRunning_{ false };
+};
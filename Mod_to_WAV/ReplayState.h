@@ -0,0 +1,83 @@
+#pragma once
+// Snapshots of the replay state of the mixer, see Mixer::saveReplayState()
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+/*
+    A snapshot is a flat array of bytes, so that it can be kept in memory,
+    written to a file or sent elsewhere as it is. The values are stored
+    one after the other in the byte order of the machine (little endian on
+    the x86 cpus the mixer needs), without padding. Samples, instruments
+    and channels are stored as their nrs, never as pointers, so that a
+    snapshot can be restored into any mixer that has the same module.
+
+    REPLAYSTATE_VERSION changes whenever the layout does: a snapshot with
+    another version is refused.
+*/
+const std::uint32_t REPLAYSTATE_MAGIC = 0x53524D58;    // "XMRS"
+const std::uint16_t REPLAYSTATE_VERSION = 2;
+const std::uint16_t REPLAYSTATE_NONE = 0xFFFF;         // no sample / instrument
+
+class ReplayState {
+public:
+    void            clear() { data_.clear(); }
+    bool            isEmpty() const { return data_.empty(); }
+    std::size_t     getSize() const { return data_.size(); }
+    const std::vector< std::uint8_t >& getData() const { return data_; }
+    void            setData( const std::uint8_t* data,std::size_t size )
+                    { data_.assign( data,data + size ); }
+
+    template< typename T >
+    void            write( const T& value )
+    {
+        static_assert( std::is_trivially_copyable< T >::value,
+            "Only plain values can be written to a snapshot" );
+        writeBytes( &value,sizeof( T ) );
+    }
+    void            writeBytes( const void* source,std::size_t size )
+    {
+        const std::uint8_t* bytes = (const std::uint8_t*)source;
+        data_.insert( data_.end(),bytes,bytes + size );
+    }
+
+private:
+    std::vector< std::uint8_t > data_;
+};
+
+/*
+    Reads the values of a snapshot back in the order they were written. A
+    read past the end fails, and so does every read after it, so that the
+    caller only needs to check isValid() once at the end.
+*/
+class ReplayStateReader {
+public:
+    ReplayStateReader( const ReplayState& state ) : data_( state.getData() ) {}
+
+    template< typename T >
+    bool            read( T& value )
+    {
+        static_assert( std::is_trivially_copyable< T >::value,
+            "Only plain values can be read from a snapshot" );
+        return readBytes( &value,sizeof( T ) );
+    }
+    bool            readBytes( void* dest,std::size_t size )
+    {
+        if ( !isValid_ || (size > data_.size() - readPos_) ) {
+            isValid_ = false;
+            return false;
+        }
+        memcpy( dest,data_.data() + readPos_,size );
+        readPos_ += size;
+        return true;
+    }
+    bool            isValid() const { return isValid_; }
+    bool            isAtEnd() const { return readPos_ == data_.size(); }
+
+private:
+    const std::vector< std::uint8_t >& data_;
+    std::size_t     readPos_ = 0;
+    bool            isValid_ = true;
+};
@@ -0,0 +1,99 @@
+#pragma once
+// AudioSink that decouples the render thread from the sound device
+
+#include <atomic>
+#include <algorithm>
+
+#include "AudioSink.h"
+#include "SpscRingBuffer.h"
+
+/*
+    The mixer (render thread) writes into the ring buffer through the
+    AudioSink interface, the sound device callback takes the frames out 
+    again with read(). read() never blocks: if the render thread can't keep 
+    up the missing frames are replaced by silence and an underrun is 
+    counted.
+
+    The buffer holds blockCount blocks, as asked for by the mixer when it 
+    opens the sink. Playback only starts once the buffer is half full, so the time the 
+    render thread needs to get going doesn't count as an underrun.
+
+    Statistics, to tune the latency under load:
+    - underrun count:   nr of read() calls that got less than they asked for
+    - low watermark:    the least nr of frames that were buffered when the 
+                        device asked for more. Close to zero means the 
+                        buffer is almost too small.
+    - high watermark:   the most nr of frames that were ever buffered
+*/
+class RingBufferSink : public AudioSink {
+public:
+    int             open( 
+        unsigned mixRate,
+        unsigned nrChannels,
+        unsigned framesPerBlock,
+        unsigned blockCount ) override
+    {
+        ringBuffer_.init( framesPerBlock * blockCount,nrChannels );
+        isPlaying_ = false;
+        resetStatistics();
+        return 0;
+    }
+    int             close() override { return 0; }
+    unsigned        getFramesWritable() override 
+    { 
+        return ringBuffer_.getFramesWritable(); 
+    }
+    int             write( const float* buffer,unsigned nrFrames ) override
+    {
+        if ( ringBuffer_.write( buffer,nrFrames ) != nrFrames )
+            return -1;
+        unsigned level = ringBuffer_.getFramesReadable();
+        if ( level > highWatermark_.load( std::memory_order_relaxed ) )
+            highWatermark_.store( level,std::memory_order_relaxed );
+        return 0;
+    }
+
+    /*
+        Called by the sound device. Always delivers nrFrames frames.
+    */
+    void            read( float* buffer,unsigned nrFrames )
+    {
+        unsigned level = ringBuffer_.getFramesReadable();
+        unsigned nrChannels = ringBuffer_.getNrChannels();
+        if ( !isPlaying_ ) {
+            if ( level < (ringBuffer_.getCapacity() >> 1) ) {
+                std::fill( buffer,buffer + nrFrames * nrChannels,0.0f );
+                return;
+            }
+            isPlaying_ = true;
+        }
+        if ( level < lowWatermark_.load( std::memory_order_relaxed ) )
+            lowWatermark_.store( level,std::memory_order_relaxed );
+        unsigned nrFramesRead = ringBuffer_.read( buffer,nrFrames );
+        if ( nrFramesRead < nrFrames ) {
+            std::fill( 
+                buffer + nrFramesRead * nrChannels,
+                buffer + nrFrames * nrChannels,
+                0.0f );
+            underrunCount_.fetch_add( 1,std::memory_order_relaxed );
+        }
+    }
+
+    unsigned        getUnderrunCount() const { return underrunCount_.load(); }
+    unsigned        getLowWatermark() const { return lowWatermark_.load(); }
+    unsigned        getHighWatermark() const { return highWatermark_.load(); }
+    unsigned        getCapacity() const { return ringBuffer_.getCapacity(); }
+    void            resetStatistics()
+    {
+        underrunCount_ = 0;
+        lowWatermark_ = ringBuffer_.getCapacity();
+        highWatermark_ = 0;
+    }
+
+private:
+    SpscRingBuffer          ringBuffer_;
+    bool                    isPlaying_ = false;     // consumer side only
+    std::atomic< unsigned > underrunCount_{ 0 };
+    std::atomic< unsigned > lowWatermark_{ 0 };
+    std::atomic< unsigned > highWatermark_{ 0 };
+};
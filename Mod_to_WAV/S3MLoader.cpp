@@ -20,10 +20,13 @@ Thanks must go to:
 This code requires a byte to be 8 bits wide
 #endif
 
+#ifdef _WIN32
 #include <conio.h>
 #include <windows.h>
 #include <mmsystem.h>
 #pragma comment (lib, "winmm.lib") 
+#endif
+#include <cmath>
 #include <iostream>
 #include <fstream>
 #include <bitset>
@@ -1,6 +1,8 @@
 #include <iostream>
 #include <cstring>
+#ifdef _WIN32
 #include <conio.h>
+#endif
 #include <memory>
 
 #include "Constants.h"
@@ -74,13 +76,17 @@ Sample::Sample( const SampleHeader& sampleHeader )
 
     //if ( isStereo ) std::cout << "\n!!! STEREO SAMPLE !!!\n"; // DEBUG
 
-    // allocate memory for 16 bit version of sample + some spare space
+    // allocate memory for the sample data + some spare space, 8 bit 
+    // samples keep their 8 bit data:
     datalength_ = length_ + 2 * INTERPOLATION_SPACER + SAMPLEDATA_EXTENSION;
     if ( isStereo )
         datalength_ <<= 1;
     datalength_ += 16;
     datalength_ &= 0xFFFFFFF0;
-    data_ = std::make_unique<std::int16_t[]>( datalength_ );
+    if ( is16Bit )
+        data_ = std::make_unique<std::int16_t[]>( datalength_ );
+    else
+        data8_ = std::make_unique<std::int8_t[]>( datalength_ );
 
 
     unsigned nrSamples = length_;
@@ -108,43 +114,55 @@ Sample::Sample( const SampleHeader& sampleHeader )
         }
     }
 
-    // convert from left + right to 16 bit interleaved stereo and copy data:
+    // convert from left + right to interleaved stereo and copy data:
     if ( isStereo ) { 
-        std::int16_t* dest16 = data_.get() +  2 * INTERPOLATION_SPACER;
         if ( is16Bit ) { 
+            std::int16_t* dest16 = data_.get() + 2 * INTERPOLATION_SPACER;
             for ( unsigned i = 0; i < length_;i++ ) {
                 dest16[i * 2] = leftSource16[i];
                 dest16[i * 2 + 1] = rightSource16[i];
             }
         } 
         else { // 8 bit data            
+            std::int8_t* dest8 = data8_.get() + 2 * INTERPOLATION_SPACER;
             for ( unsigned i = 0; i < length_;i++ ) {
-                dest16[i * 2] = leftSource8[i] << 8;
-                dest16[i * 2 + 1] = rightSource8[i] << 8;
+                dest8[i * 2] = leftSource8[i];
+                dest8[i * 2 + 1] = rightSource8[i];
             }
         }
     }
-    // Mono sample. Just copy data and scale 8bit to 16 bit:
+    // Mono sample. Just copy data:
     else { 
-        std::int16_t* dest16 = data_.get() + INTERPOLATION_SPACER;
         if ( is16Bit ) { 
+            std::int16_t* dest16 = data_.get() + INTERPOLATION_SPACER;
             for ( unsigned i = 0; i < length_;i++ ) {
                 dest16[i] = source16[i];
             }
         } 
         else { 
-            for ( unsigned i = 0; i < length_;i++ ) {
-                dest16[i] = source8[i] << 8;
-            }
+            memcpy( data8_.get() + INTERPOLATION_SPACER,source8,length_ );
         }
     }
+    if ( is16Bit )
+        addSpacersAndTail( getData() );
+    else
+        addSpacersAndTail( get8BitData() );
+}
+
+/*
+    iData points to the beginning of the sample data. The click removal 
+    at the end of 8 bit data is calculated with 8 bit precision, so it 
+    can reach 0 a little sooner than it did on the widened data.
+*/
+template< typename SampleType >
+void Sample::addSpacersAndTail( SampleType* iData )
+{
+    const int widen = (sizeof( SampleType ) == 1) ? 256 : 1;
     /*   
     -|----|----|----|----|----|----|----|----|----|----|----|----
     -5   -4   -3   -2   -1    0    1    2    3    4    5    6
      R    L    R    L    R    L    R    L    R    L    R    L
     */
-    // get pointer to beginning of sample data:
-    std::int16_t* iData = getData();
 
     if ( INTERPOLATION_SPACER ) {
         int spacer = std::min( (const unsigned)INTERPOLATION_SPACER,length_ );
@@ -205,7 +223,7 @@ Sample::Sample( const SampleHeader& sampleHeader )
                 s *= SAMPLEDATA_EXTENSION - 1 - i;
                 s /= SAMPLEDATA_EXTENSION;
                 iData[length_ + i] = s;
-                if ( (s >> 7) == 0 )
+                if ( ((s * widen) >> 7) == 0 )
                     break;
             }
             length_ += i;
@@ -220,7 +238,7 @@ Sample::Sample( const SampleHeader& sampleHeader )
                 sR /= SAMPLEDATA_EXTENSION;
                 iData[((length_ - 1 + i) << 1)] = sL;
                 iData[((length_ - 1 + i) << 1) + 1] = sR;
-                if ( ((sL >> 7) == 0) && ((sR >> 7) == 0) )
+                if ( (((sL * widen) >> 7) == 0) && (((sR * widen) >> 7) == 0) )
                     break;
             }
             length_ += i;
@@ -244,6 +262,52 @@ void Sample::operator=( const Sample& sourceSample )
     panning_ = sourceSample.panning_;
     finetune_ = sourceSample.finetune_;
 
-    data_ = std::make_unique<std::int16_t[]>( sourceSample.datalength_ );
-    memcpy( data_.get(),sourceSample.data_.get(),sourceSample.datalength_ * sizeof( std::int16_t ) );
+    datalength_ = sourceSample.datalength_;
+    data_.reset();
+    data8_.reset();
+    if ( sourceSample.has8BitData() ) {
+        data8_ = std::make_unique<std::int8_t[]>( sourceSample.datalength_ );
+        memcpy( data8_.get(),sourceSample.data8_.get(),sourceSample.datalength_ );
+    } else {
+        data_ = std::make_unique<std::int16_t[]>( sourceSample.datalength_ );
+        memcpy( data_.get(),sourceSample.data_.get(),sourceSample.datalength_ * sizeof( std::int16_t ) );
+    }
+    floatData_.reset();
+    if ( sourceSample.hasFloatData() )
+        createFloatData();
+}
+
+/*
+    Converts all of the 16 or 8 bit data, so that the spacers and the click 
+    removal at the end are in the float copy as well
+*/
+void Sample::createFloatData()
+{
+    if ( hasFloatData() )
+        return;
+    floatData_ = std::make_unique<float[]>( datalength_ );
+    float* dest = floatData_.get();
+    if ( has8BitData() ) {
+        const std::int8_t* source = data8_.get();
+        for ( unsigned i = 0; i < datalength_; i++ )
+            dest[i] = (float)(source[i] * 256);
+    } else {
+        const std::int16_t* source = data_.get();
+        for ( unsigned i = 0; i < datalength_; i++ )
+            dest[i] = (float)source[i];
+    }
+}
+
+void Sample::widenTo16Bit()
+{
+    if ( !has8BitData() )
+        return;
+    data_ = std::make_unique<std::int16_t[]>( datalength_ );
+    const std::int8_t* source = data8_.get();
+    std::int16_t* dest = data_.get();
+    for ( unsigned i = 0; i < datalength_; i++ )
+        dest[i] = (std::int16_t)(source[i] * 256);
+    data8_.reset();
 }
+
+
@@ -64,12 +64,72 @@ public:
     int             getRelativeNote()   const { return relativeNote_; }
     unsigned        getPanning()        const { return panning_; }
     int             getFinetune()       const { return finetune_; }
+    /*
+        The 16 bit data, or a nullptr if the sample keeps its 8 bit data
+    */
     std::int16_t*   getData()           const 
     { 
+        if ( !data_ )
+            return nullptr;
         return isMono() ?
             (data_.get() + INTERPOLATION_SPACER) :
             (data_.get() + (INTERPOLATION_SPACER << 1));
     }
+
+    /*
+        8 bit samples are not widened to 16 bit when they are loaded, this 
+        halves the memory they take. The data has the same layout as the 16
+        bit data, spacers and click removal included. The mixing routines 
+        of the MXR_MIX_8BIT_DATA variants shift it up by 8 bits as they 
+        read it, so a sample point of the 8 bit data has the same value as 
+        it would have in the 16 bit data. widenTo16Bit() converts the data 
+        like older versions did at load time.
+    */
+    bool            has8BitData()       const { return data8_ != nullptr; }
+    std::int8_t*    get8BitData()       const 
+    { 
+        if ( !data8_ )
+            return nullptr;
+        return isMono() ?
+            (data8_.get() + INTERPOLATION_SPACER) :
+            (data8_.get() + (INTERPOLATION_SPACER << 1));
+    }
+    void            widenTo16Bit();
+
+    /*
+        An optional float copy of the 16 bit data, for the mixing routines
+        that read floats directly instead of converting every sample point.
+        It has the same layout as the 16 bit data, spacers and extension 
+        included, and the same range (-32768 .. 32767), so that the gains 
+        need not change. It costs twice the memory of the 16 bit data, 
+        which is kept. 8 bit data is converted the same way.
+    */
+    void            createFloatData();
+    void            freeFloatData() { floatData_.reset(); }
+    bool            hasFloatData()      const { return floatData_ != nullptr; }
+    float*          getFloatData()      const 
+    { 
+        return isMono() ?
+            (floatData_.get() + INTERPOLATION_SPACER) :
+            (floatData_.get() + (INTERPOLATION_SPACER << 1));
+    }
+
+    /*
+        Memory used by the sample data, in bytes
+    */
+    unsigned        getDataSize()       const 
+    { 
+        return has8BitData() ? 
+            datalength_ * sizeof( std::int8_t ) : datalength_ * sizeof( std::int16_t ); 
+    }
+    unsigned        getFloatDataSize()  const 
+    { 
+        return hasFloatData() ? datalength_ * sizeof( float ) : 0; 
+    }
+private:
+    template< typename SampleType >
+    void            addSpacersAndTail( SampleType* iData );
+
 private:
     std::string     name_;
     unsigned        length_ = 0;
@@ -84,7 +144,11 @@ private:
     int             relativeNote_ = 0;
     unsigned        panning_ = PANNING_CENTER;
     int             finetune_ = 0;
-    unsigned        datalength_ = 0;       // total memory allocated for this sample
+    unsigned        datalength_ = 0;       // total nr of sample points allocated for this sample
     std::unique_ptr<std::int16_t[]> data_; // 16 bit signed only, stereo == interleaved
+    std::unique_ptr<std::int8_t[]> data8_; // or 8 bit signed, if the sample was 8 bit
+
+    std::unique_ptr<float[]> floatData_;   // nullptr, or a copy of data_, see createFloatData()
+
 };
 
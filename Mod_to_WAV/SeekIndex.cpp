@@ -0,0 +1,161 @@
+#include <algorithm>
+#include <cassert>
+#include <fstream>
+#include <iostream>
+#include <type_traits>
+
+#include "SeekIndex.h"
+
+/*
+    The file holds, in this order:
+    - the header: magic, version, snapshot version, module checksum, mix
+      rate, interval and the nr of keyframes
+    - per keyframe: its frame nr, the size of its snapshot and the
+      snapshot itself
+    As the snapshots, the values are stored in the byte order of the
+    machine.
+*/
+namespace SeekIndexHelperFn {
+    template< typename T >
+    void writeValue( std::ofstream& file,const T& value )
+    {
+        static_assert( std::is_trivially_copyable< T >::value,
+            "Only plain values can be written to a seek index file" );
+        file.write( (const char*)&value,sizeof( T ) );
+    }
+
+    template< typename T >
+    bool readValue( std::ifstream& file,T& value )
+    {
+        static_assert( std::is_trivially_copyable< T >::value,
+            "Only plain values can be read from a seek index file" );
+        file.read( (char*)&value,sizeof( T ) );
+        return (bool)file;
+    }
+}
+
+void SeekIndex::clear()
+{
+    mixRate_ = 0;
+    interval_ = 0;
+    keyframes_.clear();
+}
+
+void SeekIndex::start( unsigned mixRate,unsigned interval )
+{
+    assert( interval > 0 );
+    clear();
+    mixRate_ = mixRate;
+    interval_ = interval;
+}
+
+void SeekIndex::addKeyframe( std::uint64_t frameNr,const ReplayState& state )
+{
+    assert( frameNr == (std::uint64_t)keyframes_.size() * interval_ );
+    keyframes_.emplace_back();
+    keyframes_.back().frameNr = frameNr;
+    keyframes_.back().state = state;
+}
+
+std::size_t SeekIndex::getSize() const
+{
+    std::size_t size = 0;
+    for ( const SeekKeyframe& keyframe : keyframes_ )
+        size += keyframe.state.getSize();
+    return size;
+}
+
+const SeekKeyframe* SeekIndex::findKeyframe( std::uint64_t frameNr ) const
+{
+    if ( keyframes_.empty() )
+        return nullptr;
+    std::uint64_t keyframeNr = std::min(
+        frameNr / interval_,(std::uint64_t)keyframes_.size() - 1 );
+    return &(keyframes_[(std::size_t)keyframeNr]);
+}
+
+int SeekIndex::save( const std::string& fileName,std::uint32_t moduleChecksum ) const
+{
+    using namespace SeekIndexHelperFn;
+    if ( keyframes_.empty() ) {
+        std::cout << "\nThe seek index is empty\n";
+        return -1;
+    }
+    std::ofstream file( fileName,std::ios::out | std::ios::binary | std::ios::trunc );
+    if ( !file.is_open() ) {
+        std::cout << "\nUnable to create seek index file " << fileName << "\n";
+        return -1;
+    }
+    writeValue( file,SEEKINDEX_MAGIC );
+    writeValue( file,SEEKINDEX_VERSION );
+    writeValue( file,REPLAYSTATE_VERSION );
+    writeValue( file,moduleChecksum );
+    writeValue( file,(std::uint32_t)mixRate_ );
+    writeValue( file,(std::uint32_t)interval_ );
+    writeValue( file,(std::uint32_t)keyframes_.size() );
+    for ( const SeekKeyframe& keyframe : keyframes_ ) {
+        writeValue( file,keyframe.frameNr );
+        writeValue( file,(std::uint32_t)keyframe.state.getSize() );
+        file.write( (const char*)keyframe.state.getData().data(),keyframe.state.getSize() );
+    }
+    file.close();
+    if ( !file ) {
+        std::cout << "\nUnable to write seek index file " << fileName << "\n";
+        return -1;
+    }
+    return 0;
+}
+
+int SeekIndex::load( const std::string& fileName,std::uint32_t moduleChecksum )
+{
+    using namespace SeekIndexHelperFn;
+    clear();
+    std::ifstream file( fileName,std::ios::in | std::ios::binary );
+    if ( !file.is_open() )
+        return -1;
+    std::uint32_t magic = 0;
+    std::uint16_t version = 0;
+    std::uint16_t replayStateVersion = 0;
+    std::uint32_t checksum = 0;
+    std::uint32_t mixRate = 0;
+    std::uint32_t interval = 0;
+    std::uint32_t nrKeyframes = 0;
+    readValue( file,magic );
+    readValue( file,version );
+    readValue( file,replayStateVersion );
+    readValue( file,checksum );
+    readValue( file,mixRate );
+    readValue( file,interval );
+    if ( !readValue( file,nrKeyframes ) || (magic != SEEKINDEX_MAGIC) ||
+        (version != SEEKINDEX_VERSION) || (replayStateVersion != REPLAYSTATE_VERSION) ||
+        (interval == 0) || (nrKeyframes == 0) ) {
+        std::cout << "\nInvalid seek index file " << fileName << "\n";
+        return -1;
+    }
+    if ( checksum != moduleChecksum ) {
+        std::cout << "\nThe seek index file " << fileName << " belongs to another module\n";
+        return -1;
+    }
+    start( mixRate,interval );
+    std::vector< std::uint8_t > data;
+    for ( std::uint32_t i = 0; i < nrKeyframes; i++ ) {
+        std::uint64_t frameNr = 0;
+        std::uint32_t size = 0;
+        readValue( file,frameNr );
+        if ( !readValue( file,size ) || (size > SEEKINDEX_MAX_KEYFRAME_SIZE) ||
+            (frameNr != (std::uint64_t)i * interval) )
+            break;
+        data.resize( size );
+        if ( !file.read( (char*)data.data(),size ) )
+            break;
+        keyframes_.emplace_back();
+        keyframes_.back().frameNr = frameNr;
+        keyframes_.back().state.setData( data.data(),size );
+    }
+    if ( keyframes_.size() != nrKeyframes ) {
+        std::cout << "\nInvalid seek index file " << fileName << "\n";
+        clear();
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,73 @@
+#pragma once
+// Replay state keyframes every few seconds of a song, for fast seeking
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ReplayState.h"
+
+/*
+    A seek index holds a replay state snapshot (see ReplayState.h) every
+    interval frames of the song, from frame 0 up to the end. To seek to a
+    frame the mixer restores the keyframe at or before it, found in O(1)
+    as the keyframes are evenly spaced, and mixes at most one interval of
+    audio that it throws away, see Mixer::seek().
+
+    Mixer::buildSeekIndex() makes the keyframes of the module that is
+    assigned to it and stores them in that module, Module::saveSeekIndex()
+    writes them to <module file>.seek. An index only holds for the mix
+    rate it was made at. A keyframe takes one to a few tens of kB,
+    depending on the nr of channels and voices.
+*/
+const unsigned SEEKINDEX_DEFAULT_INTERVAL = 4;      // in seconds
+const unsigned SEEKINDEX_MAX_INTERVAL = 60;         // in seconds
+const std::uint32_t SEEKINDEX_MAGIC = 0x49534D58;   // "XMSI"
+const std::uint16_t SEEKINDEX_VERSION = 1;
+const std::uint32_t SEEKINDEX_MAX_KEYFRAME_SIZE = 0x100000;
+const char SEEKINDEX_FILE_EXTENSION[] = ".seek";
+
+struct SeekKeyframe {
+    std::uint64_t   frameNr = 0;
+    ReplayState     state;
+};
+
+class SeekIndex {
+public:
+    void            clear();
+    /*
+        Starts a new, empty index. The keyframes must then be added in
+        their order, one every interval frames from frame 0 on.
+    */
+    void            start( unsigned mixRate,unsigned interval );
+    void            addKeyframe( std::uint64_t frameNr,const ReplayState& state );
+
+    bool            isEmpty() const { return keyframes_.empty(); }
+    unsigned        getMixRate() const { return mixRate_; }
+    unsigned        getInterval() const { return interval_; }
+    std::size_t     getNrKeyframes() const { return keyframes_.size(); }
+    /*
+        The size of all snapshots together, in bytes
+    */
+    std::size_t     getSize() const;
+    /*
+        The last keyframe at or before frameNr, nullptr if the index is
+        empty
+    */
+    const SeekKeyframe* findKeyframe( std::uint64_t frameNr ) const;
+
+    /*
+        Writes the index to a file and reads it back. moduleChecksum (see
+        Module::getChecksum()) ties the file to the module it was made for:
+        the file of another module, or of another version of the file
+        layout or of the snapshots, is refused. Both return 0 on success,
+        -1 on failure. A failed load leaves the index empty.
+    */
+    int             save( const std::string& fileName,std::uint32_t moduleChecksum ) const;
+    int             load( const std::string& fileName,std::uint32_t moduleChecksum );
+
+private:
+    unsigned        mixRate_ = 0;
+    unsigned        interval_ = 0;
+    std::vector< SeekKeyframe > keyframes_;
+};
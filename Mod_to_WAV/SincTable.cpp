@@ -0,0 +1,52 @@
+#include <cmath>
+
+#include "SincTable.h"
+
+namespace SincTableHelperFn {
+    /*
+        Modified Bessel function of the first kind, order 0, for the Kaiser 
+        window
+    */
+    double besselI0( double x )
+    {
+        double sum = 1.0;
+        double term = 1.0;
+        for ( int k = 1; k < 32; k++ ) {
+            term *= (x / (2.0 * k)) * (x / (2.0 * k));
+            sum += term;
+        }
+        return sum;
+    }
+}
+
+/*
+    A sinc with its zero crossings on the sample points, under a Kaiser 
+    window that spans all taps. Every phase is normalized to a DC gain of 1. 
+    Phase 0 is the sample point itself, so the original sample data passes 
+    unchanged.
+*/
+SincTable::SincTable()
+{
+    using namespace SincTableHelperFn;
+    const double pi = 3.14159265358979323846;
+    const double halfWidth = SINC_NR_TAPS / 2;
+    const double windowScale = 1.0 / besselI0( SINC_KAISER_BETA );
+    for ( int phase = 0; phase <= SINC_NR_PHASES; phase++ ) {
+        double fract = (double)phase / (double)SINC_NR_PHASES;
+        double taps[SINC_NR_TAPS];
+        double sum = 0.0;
+        for ( int tap = 0; tap < SINC_NR_TAPS; tap++ ) {
+            double x = (double)(tap - SINC_NR_TAPS_BEFORE) - fract;
+            double sinc = (x == 0.0) ? 1.0 : 
+                (x == floor( x )) ? 0.0 : sin( pi * x ) / (pi * x);
+            double w = x / halfWidth;
+            double window = (fabs( w ) < 1.0) ?
+                besselI0( SINC_KAISER_BETA * sqrt( 1.0 - w * w ) ) * windowScale : 0.0;
+            taps[tap] = sinc * window;
+            sum += taps[tap];
+        }
+        float* coefficients = coefficients_ + phase * SINC_NR_TAPS;
+        for ( int tap = 0; tap < SINC_NR_TAPS; tap++ )
+            coefficients[tap] = (float)(taps[tap] / sum);
+    }
+}
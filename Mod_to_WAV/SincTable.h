@@ -0,0 +1,48 @@
+#pragma once
+// Precomputed windowed sinc coefficients for the sinc interpolation routines
+
+/*
+    Each output frame is the weighted sum of SINC_NR_TAPS sample points:
+    SINC_NR_TAPS_BEFORE points before the current sample position, the 
+    point at the position itself and the ones after it. They all lie 
+    within the INTERPOLATION_SPACER padding of the sample data, so the 
+    mixing routines never have to check the loop edges.
+
+    The fractional part of the sample position is divided in SINC_NR_PHASES
+    phases, the coefficients for positions in between two phases are 
+    interpolated linearly.
+*/
+const int   SINC_NR_TAPS = 8;
+const int   SINC_NR_TAPS_BEFORE = 3;
+const int   SINC_PHASE_BITS = 8;
+const int   SINC_NR_PHASES = 1 << SINC_PHASE_BITS;
+const float SINC_KAISER_BETA = 7.5f;
+
+class SincTable {
+public:
+    /*
+        The table is built on the first call, the Mixer constructor makes 
+        sure this happens at startup rather than in the middle of a song.
+    */
+    static const SincTable& get()
+    {
+        static const SincTable sincTable;
+        return sincTable;
+    }
+
+    /*
+        SINC_NR_TAPS coefficients for the given phase, 0 .. SINC_NR_PHASES.
+        The coefficients of phase + 1 follow right after them. The table 
+        is 32 byte aligned, and so is each phase.
+    */
+    const float*    getPhase( int phase ) const
+    {
+        return coefficients_ + phase * SINC_NR_TAPS;
+    }
+
+private:
+    SincTable();
+
+private:
+    alignas( 32 ) float coefficients_[(SINC_NR_PHASES + 1) * SINC_NR_TAPS];
+};
@@ -0,0 +1,98 @@
+#pragma once
+// Lock-free single producer / single consumer ring buffer for audio frames
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+/*
+    One thread writes (the render thread), one other thread reads (the sound
+    device callback). Neither side ever waits for the other: the positions
+    are atomic counters that only their owner changes, so read() and write()
+    are wait free. The positions are free running 32 bit counters, the
+    capacity is a power of two so the wrap around of the counters does not
+    matter.
+
+    Sizes and positions are in frames, a frame holds nrChannels floats.
+*/
+class SpscRingBuffer {
+public:
+    SpscRingBuffer() {}
+
+    // Not thread safe: call this before the producer and consumer start.
+    void            init( unsigned nrFrames,unsigned nrChannels )
+    {
+        capacity_ = 1;
+        while ( capacity_ < nrFrames )
+            capacity_ <<= 1;
+        nrChannels_ = nrChannels;
+        data_.assign( capacity_ * nrChannels_,0.0f );
+        writePos_.store( 0,std::memory_order_relaxed );
+        readPos_.store( 0,std::memory_order_relaxed );
+    }
+    unsigned        getCapacity() const { return capacity_; }
+    unsigned        getNrChannels() const { return nrChannels_; }
+
+    // can be called from either side:
+    unsigned        getFramesReadable() const
+    {
+        return writePos_.load( std::memory_order_acquire ) -
+            readPos_.load( std::memory_order_acquire );
+    }
+    unsigned        getFramesWritable() const
+    {
+        return capacity_ - getFramesReadable();
+    }
+
+    // producer side. Returns the nr of frames that fit in the buffer.
+    unsigned        write( const float* buffer,unsigned nrFrames )
+    {
+        unsigned writePos = writePos_.load( std::memory_order_relaxed );
+        unsigned readPos = readPos_.load( std::memory_order_acquire );
+        nrFrames = std::min( nrFrames,capacity_ - (writePos - readPos) );
+        copyToRing( buffer,writePos,nrFrames );
+        writePos_.store( writePos + nrFrames,std::memory_order_release );
+        return nrFrames;
+    }
+
+    // consumer side. Returns the nr of frames that were available.
+    unsigned        read( float* buffer,unsigned nrFrames )
+    {
+        unsigned readPos = readPos_.load( std::memory_order_relaxed );
+        unsigned writePos = writePos_.load( std::memory_order_acquire );
+        nrFrames = std::min( nrFrames,writePos - readPos );
+        copyFromRing( buffer,readPos,nrFrames );
+        readPos_.store( readPos + nrFrames,std::memory_order_release );
+        return nrFrames;
+    }
+
+private:
+    // both copy in two parts if the frames wrap around the end of the buffer
+    void            copyToRing( const float* buffer,unsigned position,unsigned nrFrames )
+    {
+        unsigned start = position & (capacity_ - 1);
+        unsigned part1 = std::min( nrFrames,capacity_ - start ) * nrChannels_;
+        unsigned part2 = nrFrames * nrChannels_ - part1;
+        memcpy( data_.data() + start * nrChannels_,buffer,part1 * sizeof( float ) );
+        memcpy( data_.data(),buffer + part1,part2 * sizeof( float ) );
+    }
+    void            copyFromRing( float* buffer,unsigned position,unsigned nrFrames ) const
+    {
+        unsigned start = position & (capacity_ - 1);
+        unsigned part1 = std::min( nrFrames,capacity_ - start ) * nrChannels_;
+        unsigned part2 = nrFrames * nrChannels_ - part1;
+        memcpy( buffer,data_.data() + start * nrChannels_,part1 * sizeof( float ) );
+        memcpy( buffer + part1,data_.data(),part2 * sizeof( float ) );
+    }
+
+private:
+    std::vector< float >    data_;
+    unsigned                capacity_ = 0;
+    unsigned                nrChannels_ = 0;
+
+    // on separate cache lines, so the two threads don't slow each other down:
+    alignas( 64 ) std::atomic< unsigned >  writePos_{ 0 };
+    alignas( 64 ) std::atomic< unsigned >  readPos_{ 0 };
+};
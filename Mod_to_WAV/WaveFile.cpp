@@ -0,0 +1,166 @@
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+
+#include "WaveFile.h"
+
+/*
+    .wav files are little endian, no matter what machine we run on:
+*/
+namespace WaveFileHelperFn {
+    void putU16( char* dst,std::uint32_t value )
+    {
+        dst[0] = (char)(value & 0xFF);
+        dst[1] = (char)((value >> 8) & 0xFF);
+    }
+    void putU32( char* dst,std::uint32_t value )
+    {
+        putU16( dst,value & 0xFFFF );
+        putU16( dst + 2,value >> 16 );
+    }
+}
+
+int WaveFile::open(
+    const std::string& fileName,
+    unsigned mixRate,
+    unsigned nrChannels,
+    int sampleFormat )
+{
+    close();
+    if ( (sampleFormat != WAV_SAMPLE_FORMAT_PCM16) &&
+        (sampleFormat != WAV_SAMPLE_FORMAT_PCM24) &&
+        (sampleFormat != WAV_SAMPLE_FORMAT_FLOAT32) ) {
+        std::cout << "\nUnsupported wave file sample format!\n";
+        return -1;
+    }
+    mixRate_ = mixRate;
+    nrChannels_ = nrChannels;
+    sampleFormat_ = sampleFormat;
+    bitsPerSample_ = sampleFormat;
+    framesWritten_ = 0;
+    dataSize_ = 0;
+    ioError_ = false;
+
+    file_.open( fileName,std::ios::out | std::ios::binary | std::ios::trunc );
+    if ( !file_.is_open() ) {
+        std::cout << "\nUnable to create wave file " << fileName << "\n";
+        return -1;
+    }
+    writeHeader();
+    return ioError_ ? -1 : 0;
+}
+
+/*
+    The header is written twice: once when the file is created, with the
+    sizes set to zero, and once more when the file is closed. The float
+    format gets a "fact" chunk as required by the spec.
+*/
+void WaveFile::writeHeader()
+{
+    using namespace WaveFileHelperFn;
+    bool        isFloat = (sampleFormat_ == WAV_SAMPLE_FORMAT_FLOAT32);
+    unsigned    fmtSize = isFloat ? 18 : 16;
+    unsigned    factSize = isFloat ? 12 : 0;
+    unsigned    blockAlign = getBytesPerFrame();
+    char        header[64];
+    char*       p = header;
+
+    memcpy( p,"RIFF",4 );
+    putU32( p + 4,4 + (8 + fmtSize) + factSize + 8 + dataSize_ );
+    memcpy( p + 8,"WAVE",4 );
+    p += 12;
+
+    memcpy( p,"fmt ",4 );
+    putU32( p + 4,fmtSize );
+    putU16( p + 8,isFloat ? 3 : 1 );   // 3 == IEEE float, 1 == PCM
+    putU16( p + 10,nrChannels_ );
+    putU32( p + 12,mixRate_ );
+    putU32( p + 16,mixRate_ * blockAlign );
+    putU16( p + 20,blockAlign );
+    putU16( p + 22,bitsPerSample_ );
+    if ( isFloat )
+        putU16( p + 24,0 );             // cbSize: no extra format info
+    p += 8 + fmtSize;
+
+    if ( isFloat ) {
+        memcpy( p,"fact",4 );
+        putU32( p + 4,4 );
+        putU32( p + 8,(std::uint32_t)framesWritten_ );
+        p += factSize;
+    }
+
+    memcpy( p,"data",4 );
+    putU32( p + 4,dataSize_ );
+    p += 8;
+
+    file_.seekp( 0 );
+    file_.write( header,p - header );
+    if ( !file_ )
+        ioError_ = true;
+}
+
+int WaveFile::write( const float* buffer,unsigned nrFrames )
+{
+    if ( !isOpen() || ioError_ )
+        return -1;
+
+    unsigned nrSamples = nrFrames * nrChannels_;
+    unsigned nrBytes = nrFrames * getBytesPerFrame();
+    if ( (std::uint64_t)dataSize_ + nrBytes > WAV_MAX_DATA_SIZE ) {
+        std::cout << "\nWave file size limit reached!\n";
+        ioError_ = true;
+        return -1;
+    }
+
+    if ( sampleFormat_ == WAV_SAMPLE_FORMAT_FLOAT32 ) {
+        // the mixer output is already in the right format, save for the
+        // byte order on big endian machines:
+        conversionBuffer_.resize( nrBytes );
+        char* dst = conversionBuffer_.data();
+        for ( unsigned i = 0; i < nrSamples; i++ ) {
+            std::uint32_t bits;
+            memcpy( &bits,buffer + i,sizeof( bits ) );
+            WaveFileHelperFn::putU32( dst,bits );
+            dst += 4;
+        }
+    } else if ( sampleFormat_ == WAV_SAMPLE_FORMAT_PCM16 ) {
+        conversionBuffer_.resize( nrBytes );
+        char* dst = conversionBuffer_.data();
+        for ( unsigned i = 0; i < nrSamples; i++ ) {
+            float t = std::max( -1.0f,std::min( 1.0f,buffer[i] ) );
+            int s = (int)std::lround( t * 32767.0f );
+            WaveFileHelperFn::putU16( dst,(std::uint32_t)s );
+            dst += 2;
+        }
+    } else {
+        conversionBuffer_.resize( nrBytes );
+        char* dst = conversionBuffer_.data();
+        for ( unsigned i = 0; i < nrSamples; i++ ) {
+            float t = std::max( -1.0f,std::min( 1.0f,buffer[i] ) );
+            int s = (int)std::lround( t * 8388607.0f );
+            dst[0] = (char)(s & 0xFF);
+            dst[1] = (char)((s >> 8) & 0xFF);
+            dst[2] = (char)((s >> 16) & 0xFF);
+            dst += 3;
+        }
+    }
+    file_.write( conversionBuffer_.data(),nrBytes );
+    if ( !file_ ) {
+        ioError_ = true;
+        return -1;
+    }
+    dataSize_ += nrBytes;
+    framesWritten_ += nrFrames;
+    return 0;
+}
+
+int WaveFile::close()
+{
+    if ( !isOpen() )
+        return 0;
+    if ( !ioError_ )
+        writeHeader();
+    file_.close();
+    return ioError_ ? -1 : 0;
+}
@@ -0,0 +1,72 @@
+#pragma once
+// Simple .wav file writer, used for rendering modules to disk
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/*
+    Sample formats supported by the wave file writer. The mixer always
+    delivers 32 bit float samples in the range -1.0 .. +1.0, they are
+    converted on the fly if an integer format is requested.
+*/
+const int WAV_SAMPLE_FORMAT_PCM16   = 16;
+const int WAV_SAMPLE_FORMAT_PCM24   = 24;
+const int WAV_SAMPLE_FORMAT_FLOAT32 = 32;
+
+/*
+    The RIFF size fields are 32 bit wide, so a .wav file can hold a bit less
+    than 4 GB of sample data.
+*/
+const std::uint32_t WAV_MAX_DATA_SIZE = 0xFFFFFFFF - 64;
+
+class WaveFile {
+public:
+    WaveFile() {}
+    ~WaveFile() { close(); }
+
+    /*
+        Creates the file and writes a preliminary header. The chunk sizes
+        in the header are filled in when the file is closed.
+        Returns 0 on success, -1 on error.
+    */
+    int             open(
+        const std::string& fileName,
+        unsigned mixRate,
+        unsigned nrChannels,
+        int sampleFormat
+    );
+
+    /*
+        Writes nrFrames frames of interleaved float samples to the file.
+        Returns 0 on success, -1 on error.
+    */
+    int             write( const float* buffer,unsigned nrFrames );
+
+    /*
+        Patches the header and closes the file. Returns 0 on success.
+    */
+    int             close();
+
+    bool            isOpen() const { return file_.is_open(); }
+    std::uint64_t   getFramesWritten() const { return framesWritten_; }
+    unsigned        getBytesPerFrame() const
+    {
+        return nrChannels_ * (bitsPerSample_ / 8);
+    }
+
+private:
+    void            writeHeader();
+
+private:
+    std::ofstream   file_;
+    unsigned        mixRate_ = 0;
+    unsigned        nrChannels_ = 0;
+    int             sampleFormat_ = WAV_SAMPLE_FORMAT_FLOAT32;
+    unsigned        bitsPerSample_ = 32;
+    std::uint64_t   framesWritten_ = 0;
+    std::uint32_t   dataSize_ = 0;
+    bool            ioError_ = false;
+    std::vector< char > conversionBuffer_;
+};
@@ -0,0 +1,132 @@
+#ifdef _WIN32
+
+#include <iostream>
+#include <memory>
+#include <cstring>
+#include <algorithm>
+
+#include "WinMMSink.h"
+
+WinMMSink::WinMMSink()
+{
+    blockDoneEvent_ = CreateEvent( NULL,FALSE,FALSE,NULL );
+}
+
+WinMMSink::~WinMMSink()
+{
+    close();
+    CloseHandle( blockDoneEvent_ );
+}
+
+int WinMMSink::open( 
+    unsigned mixRate,
+    unsigned nrChannels,
+    unsigned framesPerBlock,
+    unsigned blockCount )
+{
+    close();
+    if ( RingBufferSink::open( mixRate,nrChannels,framesPerBlock,blockCount ) )
+        return -1;
+    framesPerBlock_ = framesPerBlock;
+    blockCount_ = blockCount;
+
+    /*
+        Set up the blocks, the audio data of all blocks forms one
+        continuous buffer:
+    */
+    unsigned blockSize = framesPerBlock_ * nrChannels * sizeof( float );
+    blockData_.assign( framesPerBlock_ * nrChannels * blockCount_,0.0f );
+    waveBlocks_.assign( blockCount_,WAVEHDR() );
+    for ( unsigned i = 0; i < blockCount_; i++ ) {
+        waveBlocks_[i].dwBufferLength = blockSize;
+        waveBlocks_[i].lpData = 
+            (LPSTR)(blockData_.data() + i * framesPerBlock_ * nrChannels);
+    }
+
+    /*
+        prepare the header for the windows WAVE functions
+    */
+    waveFormatEx_.wFormatTag = WAVE_FORMAT_IEEE_FLOAT;
+    waveFormatEx_.nChannels = nrChannels;
+    waveFormatEx_.nSamplesPerSec = mixRate;
+    waveFormatEx_.wBitsPerSample = sizeof( float ) * 8;
+    waveFormatEx_.nBlockAlign = waveFormatEx_.nChannels *
+        waveFormatEx_.wBitsPerSample / 8;
+    waveFormatEx_.nAvgBytesPerSec = waveFormatEx_.nSamplesPerSec *
+        waveFormatEx_.nBlockAlign;
+    waveFormatEx_.cbSize = 0;
+
+    /*
+        try to open the default wave device. WAVE_MAPPER is
+        a constant defined in mmsystem.h, it always points to the
+        default wave device on the system (some people have 2 or
+        more sound cards). winmm signals the event when a block is done.
+    */
+    MMRESULT mmrError = waveOutOpen(
+        &hWaveOut_,
+        WAVE_MAPPER,
+        &waveFormatEx_,
+        (DWORD_PTR)blockDoneEvent_,
+        0,
+        CALLBACK_EVENT
+    );
+    if ( mmrError != MMSYSERR_NOERROR ) {
+        std::unique_ptr<wchar_t[]> buffer = std::make_unique<wchar_t[]>( 256 );
+        memset( buffer.get(),0,sizeof( wchar_t ) * 256 );
+        waveOutGetErrorText( mmrError,(wchar_t*)buffer.get(),254 );
+        std::wcout
+            << "\nUnable to open wave mapper device: "
+            << buffer.get()
+            << "\n";
+        return -1;
+    }
+    for ( unsigned i = 0; i < blockCount_; i++ )
+        waveOutPrepareHeader( hWaveOut_,&waveBlocks_[i],sizeof( WAVEHDR ) );
+
+    isOpen_ = true;
+    stopDeviceThread_ = false;
+    deviceThread_ = std::thread( &WinMMSink::deviceThread,this );
+    return 0;
+}
+
+int WinMMSink::close()
+{
+    if ( !isOpen_ )
+        return 0;
+
+    stopDeviceThread_ = true;
+    SetEvent( blockDoneEvent_ );
+    deviceThread_.join();
+
+    /*
+        stop playback, which marks all blocks as done, and unprepare the
+        blocks
+    */
+    waveOutReset( hWaveOut_ );
+    for ( unsigned i = 0; i < blockCount_; i++ )
+        waveOutUnprepareHeader( hWaveOut_,&waveBlocks_[i],sizeof( WAVEHDR ) );
+    waveOutClose( hWaveOut_ );
+    isOpen_ = false;
+    return RingBufferSink::close();
+}
+
+/*
+    Refills every block that is not queued (anymore) and sends it to the
+    sound card. The timeout is only there to notice the stop request in
+    case an event goes missing.
+*/
+void WinMMSink::deviceThread()
+{
+    while ( !stopDeviceThread_ ) {
+        for ( unsigned i = 0; i < blockCount_; i++ ) {
+            WAVEHDR* current = &(waveBlocks_[i]);
+            if ( current->dwFlags & WHDR_INQUEUE )
+                continue;
+            read( (float*)current->lpData,framesPerBlock_ );
+            waveOutWrite( hWaveOut_,current,sizeof( WAVEHDR ) );
+        }
+        WaitForSingleObject( blockDoneEvent_,100 );
+    }
+}
+
+#endif // _WIN32
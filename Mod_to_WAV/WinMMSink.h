@@ -0,0 +1,57 @@
+#pragma once
+// Real time output through the windows multimedia (winmm) wave out functions
+
+#ifdef _WIN32
+
+#define NOMINMAX
+#include <windows.h>
+#include <mmsystem.h>
+#pragma comment (lib,"winmm.lib") 
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "RingBufferSink.h"
+
+/*
+    The mixer writes into the ring buffer of the sink (see RingBufferSink),
+    a device thread takes the frames out again. winmm signals an event 
+    whenever it is done with one of the blockCount blocks of framesPerBlock
+    frames, the device thread then refills the block from the ring buffer 
+    and queues it again. The device thread never waits for the render 
+    thread. The block size and count are those of the mixer.
+
+    The latency is about 1.5 * blockCount * framesPerBlock frames.
+*/
+class WinMMSink : public RingBufferSink {
+public:
+    WinMMSink();
+    ~WinMMSink();
+
+    int             open( 
+        unsigned mixRate,
+        unsigned nrChannels,
+        unsigned framesPerBlock,
+        unsigned blockCount ) override;
+    int             close() override;
+
+private:
+    void            deviceThread();
+
+private:
+    unsigned        framesPerBlock_ = 0;
+    unsigned        blockCount_ = 0;
+    bool            isOpen_ = false;
+
+    std::vector< WAVEHDR >  waveBlocks_;
+    std::vector< float >    blockData_;
+    HANDLE                  blockDoneEvent_;
+    std::thread             deviceThread_;
+    std::atomic< bool >     stopDeviceThread_{ false };
+
+    HWAVEOUT                hWaveOut_;
+    WAVEFORMATEX            waveFormatEx_;
+};
+
+#endif // _WIN32
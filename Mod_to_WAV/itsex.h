@@ -139,7 +139,7 @@
 
 #include <memory>
 
-#include "virtualFile.h"
+#include "virtualfile.h"
 
 class ItSex {
 public:
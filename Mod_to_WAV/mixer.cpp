@@ -1,18 +1,14 @@
 
-#include "mixer.h"
-#include <conio.h> // debug
+#include "Mixer.h"
 #include <iomanip> // debug
 #include <limits>  // debug
-
-// define static variables from the Mixer class:
-CRITICAL_SECTION    Mixer::waveCriticalSection_;
-WAVEHDR*            Mixer::waveBlocks_;
-volatile int        Mixer::waveFreeBlockCount_;
-int                 Mixer::waveCurrentBlock_;
-
+#include <type_traits>
+#include <cstddef>
+#include <unordered_map>
 
 Mixer::Mixer()
 {
+    resetMixer();
     setGlobalVolume( MAX_GLOBAL_VOLUME );
     setGlobalPanning( 0x00 ); // DEBUG, should be 0x30
     setGlobalBalance( 0 );
@@ -24,92 +20,115 @@ Mixer::Mixer()
     tempo_ = 125;
     ticksPerRow_ = 6;
 
-    /*
-        Allocate memory for the buffer used by the mixing routine:
-    */
-    mixBuffer_ = std::make_unique < MixBufferType[] >( MXR_SAMPLES_PER_BLOCK );
+    setBlockSize( MXR_DEFAULT_FRAMES_PER_BLOCK );
+    SincTable::get();   // build the tables now rather than during the replay
+    PeriodTable::get();
 
-    /*
-        Allocate memory for the <BLOCK_COUNT> amount of WAVE buffers:
-    */
-    unsigned char* buffer;
-    unsigned       totalBufferSize = (sizeof( WAVEHDR ) + MXR_BLOCK_SIZE)
-        * MXR_BLOCK_COUNT;
-    if ( (buffer = (unsigned char*)HeapAlloc(
-        GetProcessHeap(),
-        HEAP_ZERO_MEMORY,
-        totalBufferSize )) == NULL ) {
-        std::cout << "Memory allocation error\n";
-        ExitProcess( 1 );
+    setIsa( cpuGetSupportedIsa() );
+}
+
+/*
+    (Re)allocates the buffer that is handed over to the audio sink and the
+    buffers of the lanes the channels are mixed in, see MXR_MIX_LANES.
+*/
+int Mixer::setBlockSize( unsigned framesPerBlock )
+{
+    if ( (framesPerBlock < MXR_MIN_FRAMES_PER_BLOCK) ||
+        (framesPerBlock > MXR_MAX_FRAMES_PER_BLOCK) ) {
+        std::cout << "\nInvalid block size: " << framesPerBlock << " frames\n";
+        return -1;
     }
-    /*
-        Set up the pointers to each bit in memory, all headers are side by
-        side, followed by the data buffers - so the audio data will form
-        one continuous block. Point to first data buffer:
-    */
-    waveBlocks_ = (WAVEHDR*)buffer;
-    buffer += sizeof( WAVEHDR ) * MXR_BLOCK_COUNT;
-    for ( int i = 0; i < MXR_BLOCK_COUNT; i++ ) {
-        waveBlocks_[i].dwBufferLength = MXR_BLOCK_SIZE;
-        waveBlocks_[i].lpData = (LPSTR)buffer;
-        buffer += MXR_BLOCK_SIZE;
+    framesPerBlock_ = framesPerBlock;
+    unsigned nrSamples = framesPerBlock_ * MXR_NR_OUTPUT_CHANNELS;
+    outputBuffer_ = std::make_unique < DestBufferType[] >( nrSamples );
+
+    unsigned laneSize = (nrSamples + MXR_LANE_ALIGNMENT - 1) & ~(MXR_LANE_ALIGNMENT - 1);
+    laneBuffers_ = std::make_unique < MixBufferType[] >( 
+        (MXR_MIX_LANES - 1) * laneSize + MXR_LANE_ALIGNMENT );
+    const std::uintptr_t alignment = MXR_LANE_ALIGNMENT * sizeof( MixBufferType );
+    MixBufferType* laneBuffer = (MixBufferType*)
+        (((std::uintptr_t)laneBuffers_.get() + alignment - 1) & ~(alignment - 1));
+    for ( int laneNr = 1; laneNr < MXR_MIX_LANES; laneNr++ ) {
+        lanes_[laneNr].buffer = laneBuffer;
+        laneBuffer += laneSize;
     }
+    return 0;
+}
 
-    /*
-        prepare the header for the windows WAVE functions
-    */
-    if ( MXR_BITS_PER_SAMPLE == 16 )
-        waveFormatEx_.wFormatTag = WAVE_FORMAT_PCM;
-    else
-        waveFormatEx_.wFormatTag = WAVE_FORMAT_IEEE_FLOAT;//WAVE_FORMAT_PCM;// WAVE_FORMAT_EXTENSIBLE
-    waveFormatEx_.nChannels = 2;               // stereo
-    waveFormatEx_.nSamplesPerSec = MXR_MIXRATE;
-    waveFormatEx_.wBitsPerSample = MXR_BITS_PER_SAMPLE;
-    waveFormatEx_.nBlockAlign = waveFormatEx_.nChannels *
-        waveFormatEx_.wBitsPerSample / 8;
-    waveFormatEx_.nAvgBytesPerSec = waveFormatEx_.nSamplesPerSec *
-        waveFormatEx_.nBlockAlign;
-    waveFormatEx_.cbSize = 0;
+int Mixer::setNrThreads( unsigned nrThreads )
+{
+    if ( (nrThreads < 1) || (nrThreads > MXR_MAX_MIX_THREADS) ) {
+        std::cout << "\nInvalid nr of threads: " << nrThreads << "\n";
+        return -1;
+    }
+    return workerPool_.setNrWorkers( nrThreads );
+}
 
-    /*
-    // not actually needed: the basic waveformatex supports float wave files
-    waveFormatEx_.cbSize = sizeof( WAVEFORMATEXTENSIBLE ) - sizeof( WAVEFORMATEX );
-    waveFormatExtensible_.dwChannelMask = KSAUDIO_SPEAKER_STEREO;
-    waveFormatExtensible_.SubFormat = KSDATAFORMAT_SUBTYPE_IEEE_FLOAT;
-
-    //waveFormatExtensible_.Samples.wSamplesPerBlock = MXR_BLOCK_SIZE / sizeof( DestBufferType );
-    waveFormatExtensible_.Samples.wValidBitsPerSample = 32;
-    //waveFormatExtensible_.Samples.wReserved = 0;
-    waveFormatExtensible_.Format = waveFormatEx_;
-    */
+int Mixer::setMaxVoices( unsigned maxVoices )
+{
+    if ( (maxVoices < 1) || (maxVoices > MXR_MAX_PHYSICAL_CHANNELS) ) {
+        std::cout << "\nInvalid nr of voices: " << maxVoices << "\n";
+        return -1;
+    }
+    maxVoices_ = maxVoices;
+    return 0;
 }
 
-Mixer::~Mixer()
+int Mixer::setVoiceStealingPolicy( int policy )
 {
-    /*
-        Free the WAVEHDR blocks that were allocated in the constructor:
-    */
-    HeapFree( GetProcessHeap(),0,waveBlocks_ );
+    if ( (policy < 0) || (policy >= MXR_STEALING_POLICIES) ) {
+        std::cout << "\nInvalid voice stealing policy: " << policy << "\n";
+        return -1;
+    }
+    voiceStealingPolicy_ = policy;
+    return 0;
 }
 
-void CALLBACK Mixer::waveOutProc(
-    HWAVEOUT hWaveOut,
-    UINT uMsg,
-    DWORD* dwInstance,
-    DWORD dwParam1,
-    DWORD dwParam2 )
+int Mixer::setBlockCount( unsigned blockCount )
 {
+    if ( (blockCount < MXR_MIN_BLOCK_COUNT) || (blockCount > MXR_MAX_BLOCK_COUNT) ) {
+        std::cout << "\nInvalid block count: " << blockCount << "\n";
+        return -1;
+    }
+    blockCount_ = blockCount;
+    return 0;
+}
 
-    // pointer to free block counter
-    DWORD* freeBlockCounter = dwInstance;
+int Mixer::setLatencyProfile( int latencyProfile )
+{
+    switch ( latencyProfile ) {
+        case MXR_LATENCY_INTERACTIVE:
+        {
+            setBlockCount( 4 );
+            return setBlockSize( 64 );
+        }
+        case MXR_LATENCY_NORMAL:
+        {
+            setBlockCount( MXR_DEFAULT_BLOCK_COUNT );
+            return setBlockSize( MXR_DEFAULT_FRAMES_PER_BLOCK );
+        }
+        case MXR_LATENCY_BATCH:
+        {
+            setBlockCount( 2 );
+            return setBlockSize( 65536 );
+        }
+    }
+    return -1;
+}
 
-    // ignore calls that occur due to openining and closing the device.
-    if ( uMsg != WOM_DONE )
-        return;
-    EnterCriticalSection( &waveCriticalSection_ );
-    (*freeBlockCounter)++;
-    LeaveCriticalSection( &waveCriticalSection_ );
-    //updateWaveBuffers();
+int Mixer::setMixRate( unsigned mixRate )
+{
+    if ( (mixRate < MXR_MIN_MIXRATE) || (mixRate > MXR_MAX_MIXRATE) ) {
+        std::cout << "\nInvalid mix rate: " << mixRate << " Hz\n";
+        return -1;
+    }
+    mixRate_ = mixRate;
+    minPositionStep_ = (std::int64_t)(MXR_MIN_FREQUENCY * MXR_POSITION_ONE) / mixRate_;
+    return 0;
+}
+
+Mixer::~Mixer()
+{
 }
 
 void Mixer::resetSong()
@@ -128,6 +147,21 @@ void Mixer::resetSong()
     patternTableIdx_ = 0;
     pattern_ = &(module_->getPattern( module_->getPatternTable( patternTableIdx_ ) ));
     iNote_ = pattern_->getRow( 0 );
+
+    nrRowsRead_ = 0;
+    songHasEnded_ = false;
+    songEndMixIndex_ = 0;
+
+    /*
+        Process the first row right away, so that the song starts on the
+        very first sample frame rather than after an undefined nr of ticks:
+    */
+    tickNr_ = 0;
+    mixCount_ = 0;
+    tickFraction_ = 0.0;
+    updateNotes();
+    updateImmediateEffects();
+    startTick();
 }
 
 void Mixer::assignModule( Module* module ) 
@@ -136,6 +170,7 @@ void Mixer::assignModule( Module* module )
     // assert( module_ == nullptr ); // mixer can be assigned a new mod after playing an old one
     assert( module != nullptr );
     module_ = module;
+    module_->setFloatSampleData( useFloatSampleData_ );
 
     // to add here?
     nrChannels_ = module->getnChannels();
@@ -182,836 +217,1986 @@ void Mixer::assignModule( Module* module )
             break;
         }
     }
+    /*
+        Where the song ends is looked for when it is needed, see 
+        isSongEnded(). The nr of rows of a pass does not depend on the mix
+        rate, so it holds until another module is assigned.
+    */
+    passNrRows_ = UINT_MAX;
+    resetSong();
+}
+
+void Mixer::restartSong()
+{
+    resetMixer();
     resetSong();
 }
 
+void Mixer::findSongEnd()
+{
+    if ( passNrRows_ == UINT_MAX ) {
+        SongAnalysis analysis;
+        analyzeSong( analysis );
+    }
+}
+
 int Mixer::startReplay()
 {
-    /*
-        Initialize block counter & block index:
-    */
-    waveFreeBlockCount_ = MXR_BLOCK_COUNT;
-    waveCurrentBlock_ = 0;
-    InitializeCriticalSection( &waveCriticalSection_ );
+    if ( audioSink_ == nullptr ) {
+        std::cout << "\nNo audio sink was assigned to the mixer!\n";
+        return -1;
+    }
+    return audioSink_->open( 
+        mixRate_,MXR_NR_OUTPUT_CHANNELS,framesPerBlock_,blockCount_ );
+}
+
+int Mixer::stopReplay()
+{
+    if ( audioSink_ == nullptr )
+        return -1;
+    return audioSink_->close();
+}
+
+void Mixer::updateWaveBuffers() {
+    for ( ;; ) {
+        unsigned nrFramesWritable = audioSink_->getFramesWritable();
+        unsigned nrFrames = std::min( nrFramesWritable,framesPerBlock_ );
+        if ( nrFrames == 0 )
+            return;
+        render( outputBuffer_.get(),nrFrames );
+        if ( audioSink_->write( outputBuffer_.get(),nrFrames ) )
+            return;
+        if ( nrFramesWritable == AUDIOSINK_UNLIMITED )
+            return;
+    }
+}
+
+int Mixer::renderSong()
+{
+    if ( module_ == nullptr ) {
+        std::cout << "\nNo module was assigned to the mixer!\n";
+        return -1;
+    }
+    findSongEnd();
+    if ( startReplay() )
+        return -1;
+    int result = 0;
+    while ( !isSongEnded() ) {
+        unsigned nrFrames = render( outputBuffer_.get(),framesPerBlock_ );
+        if ( audioSink_->write( outputBuffer_.get(),nrFrames ) ) {
+            result = -1;
+            break;
+        }
+    }
+    if ( stopReplay() )
+        result = -1;
+    return result;
+}
 
+/*
+    The channels are mixed straight into the caller's buffer, one tick (or
+    what is left of it) at a time, but never more than one block at a time
+    as that is the size of the channel buffer. mixCount_ is the nr of frames
+    of the current tick that were mixed already, so a tick can be spread
+    over several calls. The final scaling and clipping is done in place.
+*/
+unsigned Mixer::render( float* buffer,size_t nrFrames )
+{
+    static_assert( std::is_same< MixBufferType,float >::value,
+        "The mixer renders straight into the caller's float buffer" );
+
+    bool songHadEnded = songHasEnded_;
+    memset( buffer,0,nrFrames * MXR_NR_OUTPUT_CHANNELS * sizeof( float ) );
+    mixIndex_ = 0;
+    for ( size_t framesLeft = nrFrames; framesLeft > 0; ) {
+        unsigned x = (unsigned)std::min( 
+            (size_t)std::min( callBpm_ - mixCount_,framesPerBlock_ ),framesLeft );
+        doMixAllChannels( buffer,x );
+        framesLeft -= x;
+        mixCount_ += x;
+        if ( mixCount_ >= callBpm_ ) {
+            mixCount_ = 0;
+            releaseInactiveChannels();
+            updateBpm();
+            startTick();
+        }
+    }
     /*
-        try to open the default wave device. WAVE_MAPPER is
-        a constant defined in mmsystem.h, it always points to the
-        default wave device on the system (some people have 2 or
-        more sound cards).
+        scale the mixed data to the -1.0 .. +1.0 range:
     */
-    MMRESULT mmrError = waveOutOpen(
-        &hWaveOut_,
-        WAVE_MAPPER,
-        &waveFormatEx_,
-        //(const WAVEFORMATEX *)(&waveFormatExtensible),
-        (DWORD_PTR)waveOutProc,
-        (DWORD_PTR)&waveFreeBlockCount_,
-        CALLBACK_FUNCTION
-    );
-    if ( mmrError != MMSYSERR_NOERROR ) {
-        std::unique_ptr<wchar_t[]> buffer = std::make_unique<wchar_t[]>( 256 );
-        memset( buffer.get(),0,sizeof( wchar_t ) * 256 );
-        waveOutGetErrorText( mmrError,(wchar_t*)buffer.get(),254 );
-        std::wcout
-            << "\nUnable to open wave mapper device: "
-            << buffer.get()
-            << "\n";
+    for ( size_t i = 0; i < nrFrames * MXR_NR_OUTPUT_CHANNELS; i++ ) {
+        float t = buffer[i] / 32768.0f;
+        t = std::max( -1.0f,t );
+        t = std::min( 1.0f,t );
+        buffer[i] = t;
+    }
+    if ( songHadEnded )
+        return 0;
+    if ( songHasEnded_ )
+        return songEndMixIndex_ >> 1; // / 2 for stereo
+    return (unsigned)nrFrames;
+}
+
+/*
+    A snapshot holds, in this order:
+    - the header: magic, version, mix rate, and the nr of channels, 
+      samples, instruments and patterns and the song length of the module,
+      so that the snapshot of another module is refused
+    - the position in the song and in the tick, the tempo, the global 
+      volume and the nr of rows read so far
+    - per logical channel of the module: its mixer info and its effect 
+      memory. The Channel after its two pointers is stored as it is.
+    - the nrs of the physical channels on the active list and on the free
+      stack, in their order
+    - every physical channel that played since the module was assigned, 
+      the others are cleared
+    The pattern is not stored, it follows from the order.
+*/
+namespace MixerReplayStateHelperFn {
+    std::uint16_t toStateNr( int nr )
+    {
+        return (nr < 0) ? REPLAYSTATE_NONE : (std::uint16_t)nr;
+    }
+}
+
+int Mixer::saveReplayState( ReplayState& state ) const
+{
+    using namespace MixerReplayStateHelperFn;
+    static_assert( MXR_MAX_PHYSICAL_CHANNELS <= 256,
+        "Physical channel nrs are stored in a byte" );
+    state.clear();
+    if ( module_ == nullptr )
         return -1;
+    state.write( REPLAYSTATE_MAGIC );
+    state.write( REPLAYSTATE_VERSION );
+    state.write( mixRate_ );
+    state.write( nrChannels_ );
+    state.write( module_->getnSamples() );
+    state.write( module_->getnInstruments() );
+    state.write( module_->getnPatterns() );
+    state.write( module_->getSongLength() );
+
+    state.write( mxr_globalVolume_ );
+    state.write( globalVolume_ );
+    state.write( tempo_ );
+    state.write( ticksPerRow_ );
+    state.write( callBpm_ );
+    state.write( tickFraction_ );
+    state.write( mixCount_ );
+    state.write( tickNr_ );
+    state.write( patternDelay_ );
+    state.write( patternLoopFlag_ );
+    state.write( patternLoopStartRow_ );
+    state.write( patternTableIdx_ );
+    state.write( patternRow_ );
+    state.write( (std::uint32_t)(iNote_ - pattern_->getRow( 0 )) );
+    state.write( nrRowsRead_ );
+    state.write( songHasEnded_ );
+
+    for ( unsigned i = 0; i < nrChannels_; i++ ) {
+        const LogicalChannelInfo& logicalChannelInfo = logicalChannels_[i];
+        state.write( logicalChannelInfo.globalVolume );
+        state.write( logicalChannelInfo.volume );
+        state.write( logicalChannelInfo.panning );
+        state.write( logicalChannelInfo.frequency );
+        state.write( logicalChannelInfo.physicalChannelNr );
+        const Channel& channel = channels_[i];
+        state.write( toStateNr( module_->getInstrumentNr( channel.pInstrument ) ) );
+        state.write( toStateNr( module_->getSampleNr( channel.pSample ) ) );
+        state.writeBytes( &(channel.oldNote),sizeof( Channel ) - offsetof( Channel,oldNote ) );
+    }
+
+    state.write( (std::uint16_t)nrActiveChannels_ );
+    for ( int i = 0; i < nrActiveChannels_; i++ )
+        state.write( (std::uint8_t)activeChannels_[i] );
+    state.write( (std::uint16_t)nrFreeChannels_ );
+    for ( int i = 0; i < nrFreeChannels_; i++ )
+        state.write( (std::uint8_t)freeChannels_[i] );
+    std::uint16_t nrUsedChannels = 0;
+    for ( int i = 0; i < MXR_MAX_PHYSICAL_CHANNELS; i++ )
+        if ( physicalChannels_[i].getSamplePtr() != nullptr )
+            nrUsedChannels++;
+    state.write( nrUsedChannels );
+    for ( int i = 0; i < MXR_MAX_PHYSICAL_CHANNELS; i++ ) {
+        const MixerChannel& mChn = physicalChannels_[i];
+        if ( mChn.getSamplePtr() == nullptr )
+            continue;
+        state.write( (std::uint8_t)i );
+        state.write( toStateNr( module_->getSampleNr( mChn.getSamplePtr() ) ) );
+        state.write( toStateNr( module_->getInstrumentNr( mChn.getInstrumentPtr() ) ) );
+        mChn.saveState( state );
     }
     return 0;
 }
 
-int Mixer::stopReplay()
+/*
+    A snapshot that does not fit leaves the mixer in an undefined state, so
+    the song is assigned again
+*/
+int Mixer::restoreReplayState( const ReplayState& state )
 {
+    if ( module_ == nullptr ) {
+        std::cout << "\nNo module was assigned to the mixer!\n";
+        return -1;
+    }
+    ReplayStateReader reader( state );
+    if ( readReplayState( reader ) && reader.isValid() && reader.isAtEnd() )
+        return 0;
+    std::cout << "\nInvalid replay state snapshot\n";
+    restartSong();
+    return -1;
+}
 
+bool Mixer::readReplayState( ReplayStateReader& reader )
+{
+    std::uint32_t magic = 0;
+    std::uint16_t version = 0;
+    unsigned mixRate = 0;
+    unsigned nrChannels = 0;
+    unsigned nrSamples = 0;
+    unsigned nrInstruments = 0;
+    unsigned nrPatterns = 0;
+    unsigned songLength = 0;
+    reader.read( magic );
+    reader.read( version );
+    reader.read( mixRate );
+    reader.read( nrChannels );
+    reader.read( nrSamples );
+    reader.read( nrInstruments );
+    reader.read( nrPatterns );
+    reader.read( songLength );
+    if ( !reader.isValid() || (magic != REPLAYSTATE_MAGIC) ||
+        (version != REPLAYSTATE_VERSION) || (mixRate != mixRate_) ||
+        (nrChannels != nrChannels_) || (nrChannels > MXR_MAX_LOGICAL_CHANNELS) ||
+        (nrSamples != module_->getnSamples()) ||
+        (nrInstruments != module_->getnInstruments()) ||
+        (nrPatterns != module_->getnPatterns()) ||
+        (songLength != module_->getSongLength()) )
+        return false;
+
+    std::uint32_t noteOffset = 0;
+    reader.read( mxr_globalVolume_ );
+    reader.read( globalVolume_ );
+    reader.read( tempo_ );
+    reader.read( ticksPerRow_ );
+    reader.read( callBpm_ );
+    reader.read( tickFraction_ );
+    reader.read( mixCount_ );
+    reader.read( tickNr_ );
+    reader.read( patternDelay_ );
+    reader.read( patternLoopFlag_ );
+    reader.read( patternLoopStartRow_ );
+    reader.read( patternTableIdx_ );
+    reader.read( patternRow_ );
+    reader.read( noteOffset );
+    reader.read( nrRowsRead_ );
+    reader.read( songHasEnded_ );
+    songEndMixIndex_ = 0;
+    if ( !reader.isValid() || (tempo_ == 0) || (mixCount_ >= callBpm_) ||
+        (patternTableIdx_ >= MAX_PATTERNS) )
+        return false;
+    pattern_ = &(module_->getPattern( module_->getPatternTable( patternTableIdx_ ) ));
+    if ( noteOffset >= pattern_->getSize() )
+        return false;
+    iNote_ = pattern_->getRow( 0 ) + noteOffset;
 
-    /*
-        wait for all blocks to complete
-    */
-    //while ( waveFreeBlockCount < BLOCK_COUNT )
-    //    Sleep( 10 );
+    for ( unsigned i = 0; i < MXR_MAX_LOGICAL_CHANNELS; i++ ) {
+        logicalChannels_[i].clear();
+        channels_[i].init();
+    }
+    for ( unsigned i = 0; i < nrChannels_; i++ ) {
+        LogicalChannelInfo& logicalChannelInfo = logicalChannels_[i];
+        reader.read( logicalChannelInfo.globalVolume );
+        reader.read( logicalChannelInfo.volume );
+        reader.read( logicalChannelInfo.panning );
+        reader.read( logicalChannelInfo.frequency );
+        reader.read( logicalChannelInfo.physicalChannelNr );
+        Channel& channel = channels_[i];
+        std::uint16_t instrumentNr = REPLAYSTATE_NONE;
+        std::uint16_t sampleNr = REPLAYSTATE_NONE;
+        reader.read( instrumentNr );
+        reader.read( sampleNr );
+        reader.readBytes( &(channel.oldNote),sizeof( Channel ) - offsetof( Channel,oldNote ) );
+        if ( (logicalChannelInfo.physicalChannelNr != MXR_NO_PHYSICAL_CHANNEL_ATTACHED) &&
+            !isValidPhysicalChannelNr( logicalChannelInfo.physicalChannelNr ) )
+            return false;
+        if ( ((instrumentNr != REPLAYSTATE_NONE) && (instrumentNr >= MAX_INSTRUMENTS)) ||
+            ((sampleNr != REPLAYSTATE_NONE) && (sampleNr >= MAX_SAMPLES)) )
+            return false;
+        channel.pInstrument = (instrumentNr == REPLAYSTATE_NONE) ? 
+            nullptr : &(module_->getInstrument( instrumentNr ));
+        channel.pSample = (sampleNr == REPLAYSTATE_NONE) ? 
+            nullptr : &(module_->getSample( sampleNr ));
+    }
 
     /*
-        unprepare any blocks that are still prepared
+        Every physical channel must be either on the active list or on the
+        free stack, exactly once
     */
-    for ( int i = 0; i < waveFreeBlockCount_; i++ )
-        if ( waveBlocks_[i].dwFlags & WHDR_PREPARED )
-            waveOutUnprepareHeader( hWaveOut_,&waveBlocks_[i],sizeof( WAVEHDR ) );
+    bool isListed[MXR_MAX_PHYSICAL_CHANNELS] = {};
+    std::uint16_t nrActiveChannels = 0;
+    std::uint16_t nrFreeChannels = 0;
+    reader.read( nrActiveChannels );
+    if ( nrActiveChannels > MXR_MAX_PHYSICAL_CHANNELS )
+        return false;
+    nrActiveChannels_ = nrActiveChannels;
+    for ( int i = 0; i < nrActiveChannels_; i++ ) {
+        std::uint8_t physicalChannelNr = 0;
+        reader.read( physicalChannelNr );
+        if ( isListed[physicalChannelNr] )
+            return false;
+        isListed[physicalChannelNr] = true;
+        activeChannels_[i] = physicalChannelNr;
+    }
+    reader.read( nrFreeChannels );
+    if ( nrActiveChannels + nrFreeChannels != MXR_MAX_PHYSICAL_CHANNELS )
+        return false;
+    nrFreeChannels_ = nrFreeChannels;
+    for ( int i = 0; i < nrFreeChannels_; i++ ) {
+        std::uint8_t physicalChannelNr = 0;
+        reader.read( physicalChannelNr );
+        if ( isListed[physicalChannelNr] )
+            return false;
+        isListed[physicalChannelNr] = true;
+        freeChannels_[i] = physicalChannelNr;
+    }
 
-    waveOutReset( hWaveOut_ ); // not necessary?
-    waveOutClose( hWaveOut_ );
-    DeleteCriticalSection( &waveCriticalSection_ );
-    return 0;
+    for ( int i = 0; i < MXR_MAX_PHYSICAL_CHANNELS; i++ )
+        physicalChannels_[i].clear();
+    std::uint16_t nrUsedChannels = 0;
+    reader.read( nrUsedChannels );
+    if ( nrUsedChannels > MXR_MAX_PHYSICAL_CHANNELS )
+        return false;
+    for ( int i = 0; i < nrUsedChannels; i++ ) {
+        std::uint8_t physicalChannelNr = 0;
+        std::uint16_t sampleNr = REPLAYSTATE_NONE;
+        std::uint16_t instrumentNr = REPLAYSTATE_NONE;
+        reader.read( physicalChannelNr );
+        reader.read( sampleNr );
+        reader.read( instrumentNr );
+        if ( (sampleNr >= MAX_SAMPLES) || 
+            ((instrumentNr != REPLAYSTATE_NONE) && (instrumentNr >= MAX_INSTRUMENTS)) )
+            return false;
+        physicalChannels_[physicalChannelNr].restoreState( 
+            reader,
+            &(module_->getSample( sampleNr )),
+            (instrumentNr == REPLAYSTATE_NONE) ? 
+                nullptr : &(module_->getInstrument( instrumentNr )),
+            mixRoutines_ );
+    }
+    return reader.isValid();
 }
 
-void Mixer::updateWaveBuffers() {
-    while ( waveFreeBlockCount_ ) {
-        WAVEHDR* current = &(waveBlocks_[waveCurrentBlock_]);
+namespace MixerSongAnalysisHelperFn {
+    void appendKeyValue( std::string& key,unsigned value )
+    {
+        key.push_back( (char)(value & 0xFF) );
+        key.push_back( (char)((value >> 8) & 0xFF) );
+    }
+}
 
+/*
+    The key of the row that is read next: its order and row, the tempo and
+    speed it starts with, and the pattern loop state it is read with. That
+    is the row the next pattern starts at (FT2) and, for every channel that
+    has a loop start or is in a loop, the channel nr, its loop start and 
+    its loop counter. resetSong() reads the first row right away, its key 
+    is that of order 0, row 0 at the default tempo with no loop state.
+*/
+void Mixer::getRowKey( std::string& key,bool isFirstRow ) const
+{
+    using namespace MixerSongAnalysisHelperFn;
+    key.clear();
+    if ( isFirstRow ) {
+        appendKeyValue( key,0 );
+        appendKeyValue( key,0 );
+        appendKeyValue( key,module_->getDefaultBpm() );
+        appendKeyValue( key,module_->getDefaultTempo() );
+        appendKeyValue( key,0 );
+        return;
+    }
+    appendKeyValue( key,patternTableIdx_ );
+    appendKeyValue( key,patternRow_ );
+    appendKeyValue( key,tempo_ );
+    appendKeyValue( key,ticksPerRow_ );
+    appendKeyValue( key,(unsigned)patternLoopStartRow_ );
+    for ( unsigned i = 0; i < nrChannels_; i++ ) {
+        const Channel& channel = channels_[i];
+        if ( !channel.patternIsLooping && (channel.patternLoopStart == 0) &&
+            (channel.patternLoopCounter == 0) )
+            continue;
+        appendKeyValue( key,i );
+        appendKeyValue( key,channel.patternIsLooping ? 1 : 0 );
+        appendKeyValue( key,channel.patternLoopStart );
+        appendKeyValue( key,channel.patternLoopCounter );
+    }
+}
+
+/*
+    The ticks are processed as in render(), but instead of mixing a tick
+    only its length is counted. The voices are started and stopped as 
+    usual, they just do not play, and the background voices are cut at
+    the end of every tick. 
+
+    A key that was seen before proves that the song repeats from there,
+    but the loop state in the key can also hold a loop start that is set
+    again before it is used. So the loop point is then moved back for as 
+    long as the rows before it have the same position, start tempo and
+    nr of ticks as the rows one pass later. The nr of rows of the pass is
+    where render() ends the song from then on, see isSongEnded(). If the
+    song does not loop within MXR_ANALYSIS_MAX_SECONDS it ends there.
+*/
+int Mixer::analyzeSong( SongAnalysis& analysis )
+{
+    analysis = SongAnalysis();
+    if ( module_ == nullptr ) {
+        std::cout << "\nNo module was assigned to the mixer!\n";
+        return -1;
+    }
+    struct RowInfo {
+        std::uint64_t   frameNr;
+        unsigned        tickIdx;
+        unsigned        orderNr;
+        unsigned        rowNr;
+        unsigned        tempo;
+    };
+    std::vector< RowInfo > rows;
+    std::unordered_map< std::string,unsigned > rowIdxs;
+    std::string key;
+    const std::uint64_t maxFrames = (std::uint64_t)MXR_ANALYSIS_MAX_SECONDS * mixRate_;
+
+    restartSong();
+    getRowKey( key,true );
+    rowIdxs.emplace( key,0 );
+    rows.push_back( RowInfo{ 0,0,0,0,module_->getDefaultBpm() } );
+    std::uint64_t frameNr = 0;
+    unsigned nrTicks = 0;
+    unsigned loopIdx = 0;
+    bool isLoopFound = false;
+    while ( frameNr < maxFrames ) {
+        frameNr += callBpm_;
+        nrTicks++;
+        if ( (tickNr_ + 1 >= ticksPerRow_) && (patternDelay_ == 0) ) {
+            getRowKey( key,false );
+            auto rowIdx = rowIdxs.find( key );
+            rows.push_back( RowInfo{ frameNr,nrTicks,patternTableIdx_,patternRow_,tempo_ } );
+            if ( rowIdx != rowIdxs.end() ) {
+                isLoopFound = true;
+                loopIdx = rowIdx->second;
+                break;
+            }
+            rowIdxs.emplace( key,(unsigned)rows.size() - 1 );
+        }
         /*
-            first make sure the header we're going to use is unprepared
+            Without mixing no sample ever ends, so the background voices
+            are cut before they pile up to the polyphony cap
         */
-        if ( current->dwFlags & WHDR_PREPARED )
-            waveOutUnprepareHeader( hWaveOut_,current,sizeof( WAVEHDR ) );
-
-        doMixBuffer( (DestBufferType*)(current->lpData) );
+        for ( int i = 0; i < nrActiveChannels_; i++ ) {
+            MixerChannel& mChn = physicalChannels_[activeChannels_[i]];
+            if ( mChn.isSecondary() )
+                mChn.deactivate();
+        }
+        releaseInactiveChannels();
+        updateBpm();
+        startTick();
+    }
+    restartSong();
+    if ( !isLoopFound ) {
+        passNrRows_ = (unsigned)rows.size();
+        std::cout << "\nThe song does not loop within " 
+            << MXR_ANALYSIS_MAX_SECONDS << " seconds\n";
+        return -1;
+    }
 
-        waveOutPrepareHeader( hWaveOut_,current,sizeof( WAVEHDR ) );
-        waveOutWrite( hWaveOut_,current,sizeof( WAVEHDR ) );
+    unsigned endIdx = (unsigned)rows.size() - 1;
+    const unsigned period = endIdx - loopIdx;
+    for ( ; loopIdx > 0; loopIdx--, endIdx-- ) {
+        const RowInfo& row = rows[loopIdx - 1];
+        const RowInfo& nextPassRow = rows[endIdx - 1];
+        if ( (row.orderNr != nextPassRow.orderNr) || (row.rowNr != nextPassRow.rowNr) ||
+            (row.tempo != nextPassRow.tempo) ||
+            (rows[loopIdx].tickIdx - row.tickIdx != rows[endIdx].tickIdx - nextPassRow.tickIdx) )
+            break;
+    }
+    assert( endIdx - loopIdx == period );
+    passNrRows_ = endIdx;
+    analysis.nrFrames = rows[endIdx].frameNr;
+    analysis.loopFrameNr = rows[loopIdx].frameNr;
+    analysis.loopOrderNr = rows[loopIdx].orderNr;
+    analysis.loopRowNr = rows[loopIdx].rowNr;
+    analysis.nrRows = endIdx;
+    analysis.nrTicks = rows[endIdx].tickIdx;
+    return 0;
+}
 
-        EnterCriticalSection( &(waveCriticalSection_) );
-        waveFreeBlockCount_--;
-        LeaveCriticalSection( &(waveCriticalSection_) );
+/*
+    The song is mixed once, in chunks that end on the keyframes so that 
+    every snapshot is taken at exactly its frame, up to the end of the
+    song, see isSongEnded()
+*/
+int Mixer::buildSeekIndex( unsigned intervalSeconds )
+{
+    if ( module_ == nullptr ) {
+        std::cout << "\nNo module was assigned to the mixer!\n";
+        return -1;
+    }
+    if ( (intervalSeconds < 1) || (intervalSeconds > SEEKINDEX_MAX_INTERVAL) ) {
+        std::cout << "\nInvalid seek index interval: " << intervalSeconds << " seconds\n";
+        return -1;
+    }
+    SeekIndex& seekIndex = module_->getSeekIndex();
+    const unsigned interval = intervalSeconds * mixRate_;
+    ReplayState state;
+
+    findSongEnd();
+    restartSong();
+    seekIndex.start( mixRate_,interval );
+    std::uint64_t frameNr = 0;
+    while ( !songHasEnded_ ) {
+        if ( frameNr % interval == 0 ) {
+            saveReplayState( state );
+            seekIndex.addKeyframe( frameNr,state );
+        }
+        unsigned nrFrames = (unsigned)std::min( 
+            (std::uint64_t)framesPerBlock_,interval - frameNr % interval );
+        frameNr += render( outputBuffer_.get(),nrFrames );
+    }
+    restartSong();
+    return 0;
+}
 
-        /*
-            point to the next block
-        */
-        waveCurrentBlock_++;
-        waveCurrentBlock_ %= MXR_BLOCK_COUNT;
+/*
+    Without a fitting keyframe the song is mixed from its beginning. The
+    frames up to frameNr are mixed in blocks into outputBuffer_ and thrown
+    away.
+*/
+int Mixer::seek( std::uint64_t frameNr )
+{
+    if ( module_ == nullptr ) {
+        std::cout << "\nNo module was assigned to the mixer!\n";
+        return -1;
+    }
+    findSongEnd();
+    const SeekIndex& seekIndex = module_->getSeekIndex();
+    const SeekKeyframe* keyframe = nullptr;
+    if ( seekIndex.getMixRate() == mixRate_ )
+        keyframe = seekIndex.findKeyframe( frameNr );
+    std::uint64_t keyframeNr = 0;
+    if ( (keyframe != nullptr) && (restoreReplayState( keyframe->state ) == 0) )
+        keyframeNr = keyframe->frameNr;
+    else
+        restartSong();
+    while ( (keyframeNr < frameNr) && !songHasEnded_ ) {
+        unsigned nrFrames = (unsigned)std::min( 
+            (std::uint64_t)framesPerBlock_,frameNr - keyframeNr );
+        keyframeNr += render( outputBuffer_.get(),nrFrames );
     }
+    return 0;
 }
 
-int Mixer::doMixBuffer( DestBufferType* buffer )
+
+/******************************************************************************
+*******************************************************************************
+*                                                                             *
+*                                                                             *
+*   MIXING ROUTINES                                                           *
+*                                                                             *
+*                                                                             *
+*******************************************************************************
+******************************************************************************/
+
+void Mixer::doMixAllChannels( MixBufferType* mixBuffer,unsigned nrSamples )
 {
-    memset( mixBuffer_.get(),0,MXR_SAMPLES_PER_BLOCK * sizeof( MixBufferType ) );
-    mixIndex_ = 0;
-    unsigned x = callBpm_ - mixCount_;
-    unsigned y = MXR_BLOCK_SIZE / waveFormatEx_.nBlockAlign;
-    if ( x > y ) {
-        mixCount_ += y;
-        doMixAllChannels( y );
-    } else {
-        doMixAllChannels( x );
-        x = y - x;
-        mixCount_ = 0;
-        updateBpm();
-        for ( ;x >= callBpm_; ) {
-            doMixAllChannels( callBpm_ );
-            x -= callBpm_;
-            updateBpm();
+    //std::cout << "\n";
+    //std::cout << "\nLog. Chn. : ";
+    //for ( unsigned i = 0; i < 8; i++ )
+    //    std::cout << "  " << i << "     ";
+
+    //std::cout << "\nPhys. Chn.: ";
+    //for ( unsigned i = 0; i < 16; i++ ) {
+    //    if ( isPhysicalChannelAttached( i ) ) {
+    //        std::cout << std::setw( 4 ) << logicalChannels_[i].physicalChannelNr;
+    //    } else
+    //        std::cout << "    ";
+    //}
+
+    //std::cout << "\nActive    : ";
+    //for ( unsigned i = 0; i < 8; i++ ) 
+    //    std::cout << (physicalChannels_[i].isActive() ? "Yes     " : " No     ");
+    //std::cout << "\nLVol, RVol: ";
+    //for ( unsigned i = 0; i < 8; i++ )
+    //    std::cout
+    //    << std::setw( 2 )
+    //    << (int)((physicalChannels_[logicalChannels_[i].physicalChannelNr].getLeftVolume()) * 64)
+    //    << ", "
+    //    << std::setw( 2 )
+    //    << (int)((physicalChannels_[logicalChannels_[i].physicalChannelNr].getRightVolume()) * 64)
+    //    << "  ";
+    //std::cout << "\nPanning   : ";
+    //for ( unsigned i = 0; i < 8; i++ )
+    //    std::cout
+    //    << std::setw( 4 )
+    //    << logicalChannels_[i].panning
+    //    << "    ";
+    //_getch();
+
+    unsigned nrBackgroundVoices = 0;
+    for ( int i = 0; i < nrActiveChannels_; i++ ) {
+        MixerChannel& mChn = physicalChannels_[activeChannels_[i]];
+        if ( mChn.isActive() && mChn.isSecondary() && !mChn.isDying() )
+            nrBackgroundVoices++;
+    }
+
+    /*
+        The lanes are mixed in parallel, see MXR_MIX_LANES. They only 
+        touch their own voices and their own buffer.
+    */
+    nrLanesInSegment_ = std::min( (unsigned)nrActiveChannels_,(unsigned)MXR_MIX_LANES );
+    if ( nrLanesInSegment_ > 0 ) {
+        lanes_[0].buffer = mixBuffer + mixIndex_;
+        nrSamplesInSegment_ = nrSamples;
+        nrWorkersInSegment_ = std::min( nrLanesInSegment_,workerPool_.getNrWorkers() );
+        workerPool_.run( nrWorkersInSegment_ );
+        addLanes( mixBuffer + mixIndex_,nrLanesInSegment_,nrSamples );
+        for ( unsigned laneNr = 0; laneNr < nrLanesInSegment_; laneNr++ ) {
+            MixLane& lane = lanes_[laneNr];
+            nrVoiceFramesMixed_ += lane.nrVoiceFramesMixed;
+            nrMixRoutineCalls_ += lane.nrMixRoutineCalls;
+            lane.nrVoiceFramesMixed = 0;
+            lane.nrMixRoutineCalls = 0;
         }
-        if ( x ) {
-            mixCount_ = x;
-            doMixAllChannels( x );
+    }
+    nrFramesMixed_ += nrSamples;
+    nrBackgroundVoiceFramesMixed_ += (std::uint64_t)nrBackgroundVoices * nrSamples;
+    peakBackgroundVoices_ = std::max( peakBackgroundVoices_,nrBackgroundVoices );
+    mixIndex_ += nrSamples << 1; // *2 for stereo
+}
+
+/*
+    Worker workerNr mixes every nrWorkersInSegment_-th lane, starting with
+    its own nr
+*/
+void Mixer::mixLanes( unsigned workerNr )
+{
+    for ( unsigned laneNr = workerNr; laneNr < nrLanesInSegment_; 
+        laneNr += nrWorkersInSegment_ ) {
+        MixLane& lane = lanes_[laneNr];
+        if ( laneNr > 0 )
+            memset( lane.buffer,0,nrSamplesInSegment_ * MXR_NR_OUTPUT_CHANNELS * sizeof( MixBufferType ) );
+        for ( int i = laneNr; i < nrActiveChannels_; i += nrLanesInSegment_ )
+            doMixChannel( physicalChannels_[activeChannels_[i]],lane,nrSamplesInSegment_ );
+    }
+}
+
+/*
+    Adds lanes 1 .. nrLanes - 1 to lane 0, which is mixBuffer. Each sum 
+    is done in the order of the lanes, 4 sample values at a time.
+*/
+void Mixer::addLanes( MixBufferType* mixBuffer,unsigned nrLanes,unsigned nrSamples )
+{
+    unsigned nrValues = nrSamples * MXR_NR_OUTPUT_CHANNELS;
+    unsigned i = 0;
+    for ( ; i + 4 <= nrValues; i += 4 ) {
+        __m128 sum = _mm_loadu_ps( mixBuffer + i );
+        for ( unsigned laneNr = 1; laneNr < nrLanes; laneNr++ )
+            sum = _mm_add_ps( sum,_mm_load_ps( lanes_[laneNr].buffer + i ) );
+        _mm_storeu_ps( mixBuffer + i,sum );
+    }
+    for ( ; i < nrValues; i++ ) {
+        MixBufferType sum = mixBuffer[i];
+        for ( unsigned laneNr = 1; laneNr < nrLanes; laneNr++ )
+            sum += lanes_[laneNr].buffer[i];
+        mixBuffer[i] = sum;
+    }
+}
+
+//#define showdebuginfo  
+void Mixer::doMixChannel( 
+    MixerChannel& mChn,
+    MixLane& lane,
+    unsigned nrSamples )
+{
+    if ( mChn.isActive() ) {
+        // div by zero safety. Probably because of portamento over/under flow
+        if ( mChn.getPositionStep() < minPositionStep_ )
+            return;
+        lane.nrVoiceFramesMixed += nrSamples;
+        mChn.addAge( nrSamples );
+
+        Sample& sample = *mChn.getSamplePtr();
+        unsigned chnMixIdx = 0;
+
+        MixBufferType* mixBufferPTR = lane.buffer;
+
+        //std::cout
+        //    << "\nL: " << std::setw( 8 ) << mChn.getLeftVolume()
+        //    << ", R: " << std::setw( 8 ) << mChn.getRightVolume();
+
+        float leftGain = mxr_gain_ * mChn.getLeftVolume();   // volume range: 0 .. 1
+        float rightGain = mxr_gain_ * mChn.getRightVolume();
+
+        for ( int smpToMix = nrSamples; smpToMix > 0; ) {
+            std::int64_t position = mChn.getPosition();
+            std::int64_t positionStep = mChn.getPositionStep();
+            std::int64_t repeatOffset = 
+                (std::int64_t)sample.getRepeatOffset() << MXR_POSITION_FRACTION_BITS;
+            /*
+                Note that sample.getRepeatEnd() points to the position 
+                beyond the last sample. This is so because otherwise we
+                wouldn't play the last sample itself.
+            */
+            std::int64_t repeatEnd = 
+                (std::int64_t)sample.getRepeatEnd() << MXR_POSITION_FRACTION_BITS;
+
+            /*
+                The nr of frames until the position passes the end of 
+                the loop (or its start, when playing backwards). The 
+                positions are integers, so this is exact.
+            */
+            std::int64_t distance = mChn.isPlayingForwards() ?
+                repeatEnd - position : position - repeatOffset;
+            std::int64_t nrFramesLeft = (distance + positionStep - 1) / positionStep;
+            int nrFrames = (int)std::min( nrFramesLeft,(std::int64_t)smpToMix );
+            nrFrames = std::max( nrFrames,1 ); // extra safety
+            assert( nrFrames <= (int)framesPerBlock_ ); // added for debugging safety
+
+            float leftGainDelta = 0.0f;
+            float rightGainDelta = 0.0f;
+            bool isVolumeRamping = mChn.isVolumeRamping();
+            if ( isVolumeRamping ) {
+#ifdef enable_volume_ramps                    
+                nrFrames = std::min( 
+                    nrFrames,
+                    mChn.getVolumeRampLength() - mChn.getVolumeRampPosition() );
+                leftGain = mxr_gain_ * mChn.getLeftRampVolume();
+                rightGain = mxr_gain_ * mChn.getRightRampVolume();
+                leftGainDelta = mxr_gain_ * mChn.getLeftRampStepSize();
+                rightGainDelta = mxr_gain_ * mChn.getRightRampStepSize();
+#else
+                mChn.endVolumeRamp();
+                isVolumeRamping = false;
+#endif
+            }
+            std::int64_t nextPosition = mChn.isPlayingForwards() ?
+                position + nrFrames * positionStep :
+                position - nrFrames * positionStep;
+
+            /*
+                The mixing routines get the position relative to the 
+                sample point that they start from. When playing 
+                backwards, that is the point below the last position
+                they mix, so that the relative positions stay positive
+                and truncate to the right sample point, just like when
+                playing forwards. The shift rounds down, also below 0.
+            */
+            int smpOffset = (int)((mChn.isPlayingForwards() ? position : nextPosition) 
+                >> MXR_POSITION_FRACTION_BITS);
+
+#ifdef showdebuginfo
+            std::cout
+                << "\nposition = " << position
+                << ", nrFrames = " << nrFrames
+                << ", nextPosition = " << nextPosition
+                << ", smpOffset = " << smpOffset
+                << "\n";
+#endif
+            int smpIdx = sample.isMono() ? smpOffset : smpOffset << 1;
+            const void* pSmpData;
+            if ( sample.hasFloatData() )
+                pSmpData = sample.getFloatData() + smpIdx;
+            else if ( sample.has8BitData() )
+                pSmpData = sample.get8BitData() + smpIdx;
+            else
+                pSmpData = sample.getData() + smpIdx;
+            lane.nrMixRoutineCalls++;
+            mChn.getMixRoutine()(
+                mixBufferPTR + chnMixIdx,
+                pSmpData,
+                nrFrames,
+                leftGain,
+                rightGain,
+                leftGainDelta,
+                rightGainDelta,
+                position - smpOffset * MXR_POSITION_ONE,
+                positionStep
+                );
+            chnMixIdx += nrFrames << 1; // * 2 for stereo
+            smpToMix -= nrFrames;
+
+            if ( isVolumeRamping ) {
+                mChn.setVolumeRampPosition( mChn.getVolumeRampPosition() + nrFrames );
+                if ( mChn.getVolumeRampPosition() >= mChn.getVolumeRampLength() ) {
+                    mChn.endVolumeRamp();
+                    if ( mChn.isDying() ) {
+                        mChn.deactivate();
+                        break;    // quit loop, next channel
+                    }
+                }
+                // recalculate gain values & reset volume
+                leftGain = mxr_gain_ * mChn.getLeftVolume();
+                rightGain = mxr_gain_ * mChn.getRightVolume();
+            }
+
+            if ( mChn.isPlayingForwards() ) {
+                if ( nextPosition >= repeatEnd ) {
+                    if ( sample.isRepeatSample() ) {
+                        if ( sample.isPingpongSample() ) {
+                            nextPosition = (repeatEnd << 1) - nextPosition - MXR_POSITION_ONE;
+#ifdef showdebuginfo
+                            std::cout 
+                                << "\nNew Position = " << nextPosition
+                                << " // at end of sample: bounce back"
+                                << "\n";
+#endif
+                            mChn.setPlayBackwards();
+                        } else {
+                            nextPosition = repeatOffset + 
+                                (nextPosition - repeatEnd) % (repeatEnd - repeatOffset);
+#ifdef showdebuginfo
+                            std::cout
+                                << "\nNew Position = " << nextPosition
+                                << "   // at beginning of sample, normal repeat"
+                                << "\n";
+#endif
+                        }
+                    } else {
+                        mChn.deactivate();
+                        break; // quit loop "for ( int smpToMix = nrSamples; smpToMix > 0; )"
+                    }
+                }
+            } else {    
+                if ( nextPosition <= repeatOffset ) {
+                    // Backwards playing samples are always (pingpong) looping samples
+                    nextPosition = (repeatOffset << 1) - nextPosition;
+#ifdef showdebuginfo
+                    std::cout
+                        << "\nNew Position = " << nextPosition
+                        << "   // at beginning of sample, bounceback"
+                        << "\n";
+                    _getch();
+#endif
+                    mChn.setPlayForwards();
+                }
+            }
+            // update position in sample data for this channel: 
+            mChn.setPosition( nextPosition );
         }
     }
+}
+
+/*
+    Helper functions for the 32.32 fixed point sample positions of the 
+    mixing routines, see MXR_POSITION_FRACTION_BITS
+*/
+namespace MixerPositionHelperFn {
+    inline int getIndex( std::int64_t position )
+    {
+        return (int)(position >> MXR_POSITION_FRACTION_BITS);
+    }
+
     /*
-        transfer sampled data from [sizeof( MixBufferType ) * 8] bit buffer
-        into BITS_PER_SAMPLE bit buffer:
+        The upper MXR_FRACTION_BITS bits of the fraction
     */
-    int saturation = 0;
-    MixBufferType* src = mixBuffer_.get();
-    DestBufferType* dst = buffer;
+    inline int getFraction( std::int64_t position )
+    {
+        return (int)((std::uint32_t)position >> (MXR_POSITION_FRACTION_BITS - MXR_FRACTION_BITS));
+    }
 
-    // next 2 values == debug
-    float min = 0.0f;
-    float max = 0.0f;
+    inline float getFract( std::int64_t position )
+    {
+        return (float)getFraction( position ) * MXR_FRACTION_SCALE;
+    }
+}
 
-    for ( unsigned i = 0; i < MXR_SAMPLES_PER_BLOCK; i++ ) {
-        float t = (float)(src[i]) / 32768.0f;
-        t = std::max( -1.0f,t );
-        t = std::min( 1.0f,t );
+/*
+    AVX2 helper functions for the cubic interpolation routines below
+*/
+namespace MixerAvx2HelperFn {
+    /*
+        0 .. 3 and 4 .. 7 times the position step, for getPositions()
+    */
+    MXR_TARGET_AVX2 inline void getLaneSteps( std::int64_t positionStep,__m256i* laneSteps )
+    {
+        laneSteps[0] = _mm256_setr_epi64x( 
+            0,positionStep,positionStep * 2,positionStep * 3 );
+        laneSteps[1] = _mm256_setr_epi64x( 
+            positionStep * 4,positionStep * 5,positionStep * 6,positionStep * 7 );
+    }
+
+    /*
+        Splits the positions of 8 consecutive frames in the sample indexes 
+        and the fractions, the same way as the scalar routines do.
+    */
+    MXR_TARGET_AVX2 inline void getPositions( 
+        std::int64_t position,const __m256i* laneSteps,__m256i& idx,__m256& fract )
+    {
+        __m256i pos = _mm256_set1_epi64x( position );
+        __m256 pos0 = _mm256_castsi256_ps( _mm256_add_epi64( pos,laneSteps[0] ) );
+        __m256 pos1 = _mm256_castsi256_ps( _mm256_add_epi64( pos,laneSteps[1] ) );
+        // the 32 bit halves come out in the order 0 1 4 5 2 3 6 7:
+        __m256i high = _mm256_castps_si256( _mm256_shuffle_ps( pos0,pos1,0xDD ) ); // 11011101b
+        __m256i low = _mm256_castps_si256( _mm256_shuffle_ps( pos0,pos1,0x88 ) );  // 10001000b
+        idx = _mm256_permute4x64_epi64( high,0xD8 ); // 11011000b
+        __m256i fraction = _mm256_srli_epi32( _mm256_permute4x64_epi64( low,0xD8 ),
+            MXR_POSITION_FRACTION_BITS - MXR_FRACTION_BITS );
+        fract = _mm256_mul_ps( 
+            _mm256_cvtepi32_ps( fraction ),_mm256_set1_ps( MXR_FRACTION_SCALE ) );
+    }
+
+    /*
+        Sign extends the low and the high 16 bit halves of each 32 bit lane
+    */
+    MXR_TARGET_AVX2 inline __m256i lowHalf( __m256i v )
+    {
+        return _mm256_srai_epi32( _mm256_slli_epi32( v,16 ),16 );
+    }
+    MXR_TARGET_AVX2 inline __m256i highHalf( __m256i v )
+    {
+        return _mm256_srai_epi32( v,16 );
+    }
+
+    /*
+        Sign extends byte BYTE_NR of each 32 bit lane and shifts it up to 
+        the range of 16 bit sample data
+    */
+    template< int BYTE_NR >
+    MXR_TARGET_AVX2 inline __m256i widenByte( __m256i v )
+    {
+        return _mm256_slli_epi32( _mm256_srai_epi32( 
+            _mm256_slli_epi32( v,24 - 8 * BYTE_NR ),24 ),8 );
+    }
+
+    /*
+        Same integer math as the scalar cubic routines, for 8 frames at once
+    */
+    MXR_TARGET_AVX2 inline __m256 cubic( 
+        __m256i p0,__m256i p1,__m256i p2,__m256i p3,__m256 fract )
+    {
+        __m256i t = _mm256_sub_epi32( p1,p2 );
+        __m256i a = _mm256_srai_epi32( _mm256_add_epi32( _mm256_sub_epi32(
+            _mm256_add_epi32( _mm256_slli_epi32( t,1 ),t ),p0 ),p3 ),1 );
+        __m256i b = _mm256_sub_epi32( 
+            _mm256_add_epi32( _mm256_slli_epi32( p2,1 ),p0 ),
+            _mm256_srai_epi32( _mm256_add_epi32( _mm256_add_epi32( 
+                _mm256_slli_epi32( p1,2 ),p1 ),p3 ),1 ) );
+        __m256i c = _mm256_srai_epi32( _mm256_sub_epi32( p2,p0 ),1 );
+        __m256 f = _mm256_add_ps( _mm256_mul_ps( _mm256_cvtepi32_ps( a ),fract ),
+            _mm256_cvtepi32_ps( b ) );
+        f = _mm256_add_ps( _mm256_mul_ps( f,fract ),_mm256_cvtepi32_ps( c ) );
+        return _mm256_add_ps( _mm256_mul_ps( f,fract ),_mm256_cvtepi32_ps( p1 ) );
+    }
+
+    /*
+        The same for float sample data, with the float math of the scalar 
+        routines
+    */
+    MXR_TARGET_AVX2 inline __m256 cubic( 
+        __m256 p0,__m256 p1,__m256 p2,__m256 p3,__m256 fract )
+    {
+        __m256 half = _mm256_set1_ps( 0.5f );
+        __m256 t = _mm256_sub_ps( p1,p2 );
+        __m256 a = _mm256_mul_ps( _mm256_add_ps( _mm256_sub_ps( 
+            _mm256_add_ps( _mm256_add_ps( t,t ),t ),p0 ),p3 ),half );
+        __m256 b = _mm256_sub_ps( 
+            _mm256_add_ps( _mm256_add_ps( p2,p2 ),p0 ),
+            _mm256_mul_ps( _mm256_add_ps( _mm256_add_ps( 
+                _mm256_mul_ps( p1,_mm256_set1_ps( 4.0f ) ),p1 ),p3 ),half ) );
+        __m256 c = _mm256_mul_ps( _mm256_sub_ps( p2,p0 ),half );
+        __m256 f = _mm256_add_ps( _mm256_mul_ps( a,fract ),b );
+        f = _mm256_add_ps( _mm256_mul_ps( f,fract ),c );
+        return _mm256_add_ps( _mm256_mul_ps( f,fract ),p1 );
+    }
+
+    /*
+        Cubic interpolation of the 8 frames at the sample indexes idx, for
+        mono and for stereo sample data of every format. The 16 bit 
+        versions fetch the four sample points of a mono frame as two pairs 
+        with 32 bit gathers, and a left and a right sample point in each 
+        32 bit lane for stereo. The 8 bit versions fetch all four sample 
+        points of a mono frame with one 32 bit gather, and two stereo 
+        frames. The INTERPOLATION_SPACER makes sure that the gathers never
+        run outside of the sample data.
+    */
+    MXR_TARGET_AVX2 inline __m256 cubicMono( 
+        const std::int16_t* pSmpData,__m256i idx,__m256 fract )
+    {
+        const int* pairs01 = (const int*)(pSmpData - 1);
+        const int* pairs23 = (const int*)(pSmpData + 1);
+        __m256i p01 = _mm256_i32gather_epi32( pairs01,idx,2 );
+        __m256i p23 = _mm256_i32gather_epi32( pairs23,idx,2 );
+        return cubic( lowHalf( p01 ),highHalf( p01 ),lowHalf( p23 ),highHalf( p23 ),fract );
+    }
+    MXR_TARGET_AVX2 inline __m256 cubicMono( 
+        const std::int8_t* pSmpData,__m256i idx,__m256 fract )
+    {
+        __m256i points = _mm256_i32gather_epi32( (const int*)(pSmpData - 1),idx,1 );
+        return cubic( widenByte< 0 >( points ),widenByte< 1 >( points ),
+            widenByte< 2 >( points ),widenByte< 3 >( points ),fract );
+    }
+    MXR_TARGET_AVX2 inline __m256 cubicMono( 
+        const float* pSmpData,__m256i idx,__m256 fract )
+    {
+        return cubic( 
+            _mm256_i32gather_ps( pSmpData - 1,idx,4 ),
+            _mm256_i32gather_ps( pSmpData,idx,4 ),
+            _mm256_i32gather_ps( pSmpData + 1,idx,4 ),
+            _mm256_i32gather_ps( pSmpData + 2,idx,4 ),
+            fract );
+    }
+    MXR_TARGET_AVX2 inline void cubicStereo( 
+        const std::int16_t* pSmpData,__m256i idx,__m256 fract,__m256& left,__m256& right )
+    {
+        const int* frames = (const int*)pSmpData;
+        __m256i frame0 = _mm256_i32gather_epi32( frames - 1,idx,4 );
+        __m256i frame1 = _mm256_i32gather_epi32( frames,idx,4 );
+        __m256i frame2 = _mm256_i32gather_epi32( frames + 1,idx,4 );
+        __m256i frame3 = _mm256_i32gather_epi32( frames + 2,idx,4 );
+        left = cubic( lowHalf( frame0 ),lowHalf( frame1 ),
+            lowHalf( frame2 ),lowHalf( frame3 ),fract );
+        right = cubic( highHalf( frame0 ),highHalf( frame1 ),
+            highHalf( frame2 ),highHalf( frame3 ),fract );
+    }
+    MXR_TARGET_AVX2 inline void cubicStereo( 
+        const std::int8_t* pSmpData,__m256i idx,__m256 fract,__m256& left,__m256& right )
+    {
+        __m256i frames01 = _mm256_i32gather_epi32( (const int*)(pSmpData - 2),idx,2 );
+        __m256i frames23 = _mm256_i32gather_epi32( (const int*)(pSmpData + 2),idx,2 );
+        left = cubic( widenByte< 0 >( frames01 ),widenByte< 2 >( frames01 ),
+            widenByte< 0 >( frames23 ),widenByte< 2 >( frames23 ),fract );
+        right = cubic( widenByte< 1 >( frames01 ),widenByte< 3 >( frames01 ),
+            widenByte< 1 >( frames23 ),widenByte< 3 >( frames23 ),fract );
+    }
+    /*
+        Separates the left and the right sample points of 8 consecutive
+        stereo float frames
+    */
+    MXR_TARGET_AVX2 inline void deinterleave( 
+        __m256 frames0123,__m256 frames4567,__m256& left,__m256& right )
+    {
+        // the shuffles give the order 0 1 4 5 2 3 6 7:
+        left = _mm256_castpd_ps( _mm256_permute4x64_pd( _mm256_castps_pd( 
+            _mm256_shuffle_ps( frames0123,frames4567,0x88 ) ),0xD8 ) );
+        right = _mm256_castpd_ps( _mm256_permute4x64_pd( _mm256_castps_pd( 
+            _mm256_shuffle_ps( frames0123,frames4567,0xDD ) ),0xD8 ) );
+    }
+
+    /*
+        Fetches whole stereo frames with 64 bit gathers, 4 frames each. The
+        masked gather with all lanes enabled is the same instruction as the
+        plain one, but it takes a defined source register: GCC warns that 
+        the plain one may read an uninitialized one.
+    */
+    MXR_TARGET_AVX2 inline void gatherFrames( 
+        const float* pSmpData,__m256i idx,__m256& left,__m256& right )
+    {
+        const double* frames = (const double*)pSmpData;
+        const __m256d allLanes = _mm256_castsi256_pd( _mm256_set1_epi64x( -1 ) );
+        __m256 frames0123 = _mm256_castpd_ps( _mm256_mask_i32gather_pd( 
+            _mm256_setzero_pd(),frames,_mm256_castsi256_si128( idx ),allLanes,8 ) );
+        __m256 frames4567 = _mm256_castpd_ps( _mm256_mask_i32gather_pd( 
+            _mm256_setzero_pd(),frames,_mm256_extracti128_si256( idx,1 ),allLanes,8 ) );
+        deinterleave( frames0123,frames4567,left,right );
+    }
+    MXR_TARGET_AVX2 inline void cubicStereo( 
+        const float* pSmpData,__m256i idx,__m256 fract,__m256& left,__m256& right )
+    {
+        __m256 left0,left1,left2,left3;
+        __m256 right0,right1,right2,right3;
+        gatherFrames( pSmpData - 2,idx,left0,right0 );
+        gatherFrames( pSmpData,idx,left1,right1 );
+        gatherFrames( pSmpData + 2,idx,left2,right2 );
+        gatherFrames( pSmpData + 4,idx,left3,right3 );
+        left = cubic( left0,left1,left2,left3,fract );
+        right = cubic( right0,right1,right2,right3,fract );
+    }
+
+
+    /*
+        Interleaves 8 left and 8 right values, applies the gains and adds 
+        them to 8 frames in the mix buffer.
+    */
+    MXR_TARGET_AVX2 inline void addFrames( 
+        DestBufferType* pBuffer,__m256 left,__m256 right,__m256 gains )
+    {
+        __m256 lo = _mm256_unpacklo_ps( left,right ); // L0 R0 L1 R1 | L4 R4 L5 R5
+        __m256 hi = _mm256_unpackhi_ps( left,right ); // L2 R2 L3 R3 | L6 R6 L7 R7
+        __m256 frames0 = _mm256_permute2f128_ps( lo,hi,0x20 );
+        __m256 frames1 = _mm256_permute2f128_ps( lo,hi,0x31 );
+        _mm256_storeu_ps( pBuffer,_mm256_add_ps( 
+            _mm256_loadu_ps( pBuffer ),_mm256_mul_ps( frames0,gains ) ) );
+        _mm256_storeu_ps( pBuffer + 8,_mm256_add_ps( 
+            _mm256_loadu_ps( pBuffer + 8 ),_mm256_mul_ps( frames1,gains ) ) );
+    }
+}
+
+/*
+    Helper functions for the sinc interpolation routines below. All versions
+    add up the SINC_NR_TAPS products in the same order, so that the scalar,
+    SSE2 and AVX2 routines give exactly the same output.
+*/
+namespace MixerSincHelperFn {
+    static_assert( SINC_NR_TAPS == 8,"The sinc routines are written for 8 taps" );
+
+    /*
+        Splits the position in the sample index, the phase in the sinc table
+        and the weight of the next phase.
+    */
+    inline int getSincPhase( 
+        const SincTable& sincTable,
+        std::int64_t position,
+        const float*& coefficients,
+        float& weight )
+    {
+        using namespace MixerPositionHelperFn;
+        const int weightBits = MXR_FRACTION_BITS - SINC_PHASE_BITS;
+        int fraction = getFraction( position );
+        weight = (float)(fraction & ((1 << weightBits) - 1)) * (1.0f / (float)(1 << weightBits));
+        coefficients = sincTable.getPhase( fraction >> weightBits );
+        return getIndex( position );
+    }
+
+    /*
+        products[0] + products[4] etc. was already done, this adds up the 4
+        partial sums of the left and the right channel:
+        (s0 + s2) + (s1 + s3)
+    */
+    inline __m128 addPartialSums( __m128 left,__m128 right )
+    {
+        __m128 sums = _mm_add_ps( 
+            _mm_unpacklo_ps( left,right ),      // l0 r0 l1 r1
+            _mm_unpackhi_ps( left,right ) );    // l2 r2 l3 r3
+        return _mm_add_ps( sums,_mm_movehl_ps( sums,sums ) );
+    }
+
+    inline __m128 getCoefficients( const float* coefficients,__m128 weight )
+    {
+        __m128 c0 = _mm_load_ps( coefficients );
+        __m128 c1 = _mm_load_ps( coefficients + SINC_NR_TAPS );
+        return _mm_add_ps( c0,_mm_mul_ps( _mm_sub_ps( c1,c0 ),weight ) );
+    }
+
+    MXR_TARGET_AVX2 inline __m256 getCoefficients( const float* coefficients,__m256 weight )
+    {
+        __m256 c0 = _mm256_load_ps( coefficients );
+        __m256 c1 = _mm256_load_ps( coefficients + SINC_NR_TAPS );
+        return _mm256_add_ps( c0,_mm256_mul_ps( _mm256_sub_ps( c1,c0 ),weight ) );
+    }
+
+    MXR_TARGET_AVX2 inline __m128 addHalves( __m256 products )
+    {
+        return _mm_add_ps( 
+            _mm256_castps256_ps128( products ),_mm256_extractf128_ps( products,1 ) );
+    }
+
+    /*
+        Load the SINC_NR_TAPS sample points from p on, as floats. For stereo
+        sample data the left and the right sample points are separated. 8 
+        bit sample points are unpacked into the high byte of 16 bit ones.
+    */
+    inline void splitTaps( __m128i taps,__m128& lo,__m128& hi )
+    {
+        lo = _mm_cvtepi32_ps( _mm_srai_epi32( _mm_unpacklo_epi16( taps,taps ),16 ) );
+        hi = _mm_cvtepi32_ps( _mm_srai_epi32( _mm_unpackhi_epi16( taps,taps ),16 ) );
+    }
+    inline void loadTaps( const std::int16_t* p,__m128& lo,__m128& hi )
+    {
+        splitTaps( _mm_loadu_si128( (const __m128i*)p ),lo,hi );
+    }
+    inline void loadTaps( const std::int8_t* p,__m128& lo,__m128& hi )
+    {
+        splitTaps( _mm_unpacklo_epi8( 
+            _mm_setzero_si128(),_mm_loadl_epi64( (const __m128i*)p ) ),lo,hi );
+    }
+    inline void loadTaps( const float* p,__m128& lo,__m128& hi )
+    {
+        lo = _mm_loadu_ps( p );
+        hi = _mm_loadu_ps( p + 4 );
+    }
+    inline void splitFrames( __m128i framesLo,__m128i framesHi,
+        __m128& leftLo,__m128& leftHi,__m128& rightLo,__m128& rightHi )
+    {
+        leftLo = _mm_cvtepi32_ps( _mm_srai_epi32( _mm_slli_epi32( framesLo,16 ),16 ) );
+        leftHi = _mm_cvtepi32_ps( _mm_srai_epi32( _mm_slli_epi32( framesHi,16 ),16 ) );
+        rightLo = _mm_cvtepi32_ps( _mm_srai_epi32( framesLo,16 ) );
+        rightHi = _mm_cvtepi32_ps( _mm_srai_epi32( framesHi,16 ) );
+    }
+    inline void loadFrames( 
+        const std::int16_t* p,__m128& leftLo,__m128& leftHi,__m128& rightLo,__m128& rightHi )
+    {
+        splitFrames( _mm_loadu_si128( (const __m128i*)p ),_mm_loadu_si128( (const __m128i*)p + 1 ),
+            leftLo,leftHi,rightLo,rightHi );
+    }
+    inline void loadFrames( 
+        const std::int8_t* p,__m128& leftLo,__m128& leftHi,__m128& rightLo,__m128& rightHi )
+    {
+        __m128i frames = _mm_loadu_si128( (const __m128i*)p );
+        splitFrames( _mm_unpacklo_epi8( _mm_setzero_si128(),frames ),
+            _mm_unpackhi_epi8( _mm_setzero_si128(),frames ),leftLo,leftHi,rightLo,rightHi );
+    }
+    inline void loadFrames( 
+        const float* p,__m128& leftLo,__m128& leftHi,__m128& rightLo,__m128& rightHi )
+    {
+        __m128 frames01 = _mm_loadu_ps( p );
+        __m128 frames23 = _mm_loadu_ps( p + 4 );
+        __m128 frames45 = _mm_loadu_ps( p + 8 );
+        __m128 frames67 = _mm_loadu_ps( p + 12 );
+        leftLo = _mm_shuffle_ps( frames01,frames23,0x88 );  // 10001000b
+        leftHi = _mm_shuffle_ps( frames45,frames67,0x88 );
+        rightLo = _mm_shuffle_ps( frames01,frames23,0xDD ); // 11011101b
+        rightHi = _mm_shuffle_ps( frames45,frames67,0xDD );
+    }
+    MXR_TARGET_AVX2 inline void loadTaps( const std::int16_t* p,__m256& taps )
+    {
+        taps = _mm256_cvtepi32_ps( _mm256_cvtepi16_epi32( _mm_loadu_si128( (const __m128i*)p ) ) );
+    }
+    MXR_TARGET_AVX2 inline void loadTaps( const std::int8_t* p,__m256& taps )
+    {
+        taps = _mm256_cvtepi32_ps( _mm256_slli_epi32( 
+            _mm256_cvtepi8_epi32( _mm_loadl_epi64( (const __m128i*)p ) ),8 ) );
+    }
+    MXR_TARGET_AVX2 inline void loadTaps( const float* p,__m256& taps )
+    {
+        taps = _mm256_loadu_ps( p );
+    }
+    MXR_TARGET_AVX2 inline void loadFrames( const std::int16_t* p,__m256& left,__m256& right )
+    {
+        using namespace MixerAvx2HelperFn;
+        __m256i frames = _mm256_loadu_si256( (const __m256i*)p );
+        left = _mm256_cvtepi32_ps( lowHalf( frames ) );
+        right = _mm256_cvtepi32_ps( highHalf( frames ) );
+    }
+    MXR_TARGET_AVX2 inline void loadFrames( const std::int8_t* p,__m256& left,__m256& right )
+    {
+        using namespace MixerAvx2HelperFn;
+        __m256i frames = _mm256_slli_epi16( 
+            _mm256_cvtepi8_epi16( _mm_loadu_si128( (const __m128i*)p ) ),8 );
+        left = _mm256_cvtepi32_ps( lowHalf( frames ) );
+        right = _mm256_cvtepi32_ps( highHalf( frames ) );
+    }
+    MXR_TARGET_AVX2 inline void loadFrames( const float* p,__m256& left,__m256& right )
+    {
+        MixerAvx2HelperFn::deinterleave( _mm256_loadu_ps( p ),_mm256_loadu_ps( p + 8 ),left,right );
+    }
+
+}
+
+/*
+    SSE4.1 helper function for the linear interpolation routine below: loads
+    the sample points at and after the 4 sample indexes in I, as floats.
+*/
+namespace MixerSse41HelperFn {
+    template< typename SampleType >
+    MXR_TARGET_SSE41 inline __m128i readLinearPoints( const SampleType* pSmpData,__m128i I )
+    {
+        return _mm_setr_epi16(
+            pSmpData[_mm_extract_epi32( I,0 )],pSmpData[_mm_extract_epi32( I,0 ) + 1],
+            pSmpData[_mm_extract_epi32( I,1 )],pSmpData[_mm_extract_epi32( I,1 ) + 1],
+            pSmpData[_mm_extract_epi32( I,2 )],pSmpData[_mm_extract_epi32( I,2 ) + 1],
+            pSmpData[_mm_extract_epi32( I,3 )],pSmpData[_mm_extract_epi32( I,3 ) + 1] );
+    }
 
-        if ( t == -1.0f || t == 1.0f ) // debug
-            saturation++;
+    MXR_TARGET_SSE41 inline void splitLinearPoints( __m128i P,__m128& P1,__m128& P2 )
+    {
+        __m128i pattern1 = _mm_set_epi32( 0x00000001,0x00000001,0x00000001,0x00000001 ); // _mm_setr_epi16(1, 0, 1, 0, 1, 0, 1, 0);
+        __m128i pattern2 = _mm_set_epi32( 0x00010000,0x00010000,0x00010000,0x00010000 ); // _mm_setr_epi16(0, 1, 0, 1, 0, 1, 0, 1);
 
-        dst[i] = t;
-        //if ( (i & 0x1) == 0 )
-        //    std::cout << "\nL: " << src[i];
-        //else
-        //    std::cout << ", R: " << src[i];
+        // convert uint16 to floating point
+        __m128i Q = P;
+        P = _mm_madd_epi16( P,pattern1 );
+        Q = _mm_madd_epi16( Q,pattern2 );
 
-        //min = std::min( min,t ); // debug
-        //max = std::max( max,t ); // debug
+        P1 = _mm_cvtepi32_ps( P );
+        P2 = _mm_cvtepi32_ps( Q );
     }
-    //std::cout                    // debug
-    //    << "\nmin: " << std::setw( 16 ) << min
-    //    << " max: " << std::setw( 16 ) << max
-    //    << " saturation: " << saturation;
-    return 0;
-}
-
 
-/******************************************************************************
-*******************************************************************************
-*                                                                             *
-*                                                                             *
-*   MIXING ROUTINES                                                           *
-*                                                                             *
-*                                                                             *
-*******************************************************************************
-******************************************************************************/
+    MXR_TARGET_SSE41 inline void loadLinearPoints( 
+        const std::int16_t* pSmpData,__m128i I,__m128& P1,__m128& P2 )
+    {
+        splitLinearPoints( readLinearPoints( pSmpData,I ),P1,P2 );
+    }
+    MXR_TARGET_SSE41 inline void loadLinearPoints( 
+        const std::int8_t* pSmpData,__m128i I,__m128& P1,__m128& P2 )
+    {
+        // the 8 bit sample points go to the high bytes
+        splitLinearPoints( _mm_slli_epi16( readLinearPoints( pSmpData,I ),8 ),P1,P2 );
+    }
 
-void Mixer::doMixAllChannels( unsigned nrSamples )
-{
-    //std::cout << "\n";
-    //std::cout << "\nLog. Chn. : ";
-    //for ( unsigned i = 0; i < 8; i++ )
-    //    std::cout << "  " << i << "     ";
+    MXR_TARGET_SSE41 inline void loadLinearPoints( 
+        const float* pSmpData,__m128i I,__m128& P1,__m128& P2 )
+    {
+        const float* p0 = pSmpData + _mm_extract_epi32( I,0 );
+        const float* p1 = pSmpData + _mm_extract_epi32( I,1 );
+        const float* p2 = pSmpData + _mm_extract_epi32( I,2 );
+        const float* p3 = pSmpData + _mm_extract_epi32( I,3 );
+        P1 = _mm_setr_ps( p0[0],p1[0],p2[0],p3[0] );
+        P2 = _mm_setr_ps( p0[1],p1[1],p2[1],p3[1] );
+    }
+}
 
-    //std::cout << "\nPhys. Chn.: ";
-    //for ( unsigned i = 0; i < 16; i++ ) {
-    //    if ( isPhysicalChannelAttached( i ) ) {
-    //        std::cout << std::setw( 4 ) << logicalChannels_[i].physicalChannelNr;
-    //    } else
-    //        std::cout << "    ";
-    //}
 
-    //std::cout << "\nActive    : ";
-    //for ( unsigned i = 0; i < 8; i++ ) 
-    //    std::cout << (physicalChannels_[i].isActive() ? "Yes     " : " No     ");
-    //std::cout << "\nLVol, RVol: ";
-    //for ( unsigned i = 0; i < 8; i++ )
-    //    std::cout
-    //    << std::setw( 2 )
-    //    << (int)((physicalChannels_[logicalChannels_[i].physicalChannelNr].getLeftVolume()) * 64)
-    //    << ", "
-    //    << std::setw( 2 )
-    //    << (int)((physicalChannels_[logicalChannels_[i].physicalChannelNr].getRightVolume()) * 64)
-    //    << "  ";
-    //std::cout << "\nPanning   : ";
-    //for ( unsigned i = 0; i < 8; i++ )
-    //    std::cout
-    //    << std::setw( 4 )
-    //    << logicalChannels_[i].panning
-    //    << "    ";
-    //_getch();
+/*
+    A mixing routine adds nrSamples frames of sample data, resampled with
+    the step size positionStep, to the stereo buffer. The position and the
+    step are 32.32 fixed point, the step is always positive: the backwards
+    routines step down through the sample data. The volume
+    ramping routines add leftGainDelta and rightGainDelta to the gains after
+    every frame, the other routines ignore them.
+
+    The scalar routines are generated from one template for every 
+    interpolation type and variant (see MXR_MIX_STEREO etc.). The variant
+    is known at compile time, so the inner loops have no branches on it.
+    The SIMD routines below must give exactly the same output.
+*/
+namespace MixRoutines {
+    using namespace MixerPositionHelperFn;
 
-//#define showdebuginfo  
-    const int maxSamples = 20000;
-    ALIGNED DestBufferType alignedBuffer[maxSamples];
+    template< bool IS_BACKWARDS >
+    inline std::int64_t advance( std::int64_t position,std::int64_t positionStep )
+    {
+        return IS_BACKWARDS ? position - positionStep : position + positionStep;
+    }
 
-    for ( unsigned i = 0; i < MXR_MAX_PHYSICAL_CHANNELS; i++ ) {
-        MixerChannel& mChn = physicalChannels_[i];
+    /*
+        The type of the sample data a variant reads
+    */
+    template< int VARIANT >
+    struct SampleTypeFor {
+        typedef typename std::conditional< (VARIANT & MXR_MIX_FLOAT_DATA) != 0,
+            float,typename std::conditional< (VARIANT & MXR_MIX_8BIT_DATA) != 0,
+                std::int8_t,std::int16_t >::type >::type type;
+    };
 
-        if ( mChn.isActive() ) {
-            // div by zero safety. Probably because of portamento over/under flow
-            if ( mChn.getFrequencyInc() < MXR_MIN_FREQUENCY_INC )
-                continue;
+    /*
+        The value of a sample point in the range of 16 bit sample data
+    */
+    inline int widen( std::int8_t smp ) { return smp * 256; }
+    inline int widen( std::int16_t smp ) { return smp; }
+    inline float widen( float smp ) { return smp; }
 
-            Sample& sample = *mChn.getSamplePtr();
-            unsigned chnMixIdx = mixIndex_;
+    /*
+        The interpolators return the sample data at the position, 
+        get() returns the same value in left and right for mono samples. 
+        Except for sinc, the channels are interpolated one by one with 
+        value(), STRIDE is the distance between two sample points of the
+        channel: 1 for mono samples, 2 for stereo samples.
+    */
+    template< typename Interpolation >
+    struct ChannelInterpolator {
+        template< bool IS_STEREO,typename SampleType >
+        void get( const SampleType* pSmpData,std::int64_t position,float& left,float& right ) const
+        {
+            left = Interpolation::template value< IS_STEREO ? 2 : 1 >( pSmpData,position );
+            right = IS_STEREO ?
+                Interpolation::template value< 2 >( pSmpData + 1,position ) : left;
+        }
+    };
 
-            MixBufferType* mixBufferPTR = mixBuffer_.get();
-            std::int16_t* SampleDataPTR = sample.getData();
+    struct NoInterpolation {
+        template< int STRIDE,typename SampleType >
+        static float value( const SampleType* pSmpData,std::int64_t position )
+        {
+            return (float)widen( pSmpData[getIndex( position ) * STRIDE] );
+        }
+    };
 
-            //std::cout
-            //    << "\nL: " << std::setw( 8 ) << mChn.getLeftVolume()
-            //    << ", R: " << std::setw( 8 ) << mChn.getRightVolume();
+    struct LinearInterpolation {
+        template< int STRIDE,typename SampleType >
+        static float value( const SampleType* pSmpData,std::int64_t position )
+        {
+            const SampleType* p = pSmpData + getIndex( position ) * STRIDE;
+            float p1 = (float)widen( p[0] );
+            float p2 = (float)widen( p[STRIDE] );
+            return p1 + (p2 - p1) * getFract( position );
+        }
+    };
 
-            float leftGain = mxr_gain_ * mChn.getLeftVolume();   // volume range: 0 .. 1
-            float rightGain = mxr_gain_ * mChn.getRightVolume();
+    /*
+        The 16 and 8 bit versions round the coefficients down to integers, 
+        the float version does not.
+    */
+    struct CubicInterpolation {
+        template< int STRIDE >
+        static float value( const std::int16_t* pSmpData,std::int64_t position )
+        {
+            return integerValue< STRIDE >( pSmpData,position );
+        }
 
-            for ( int smpToMix = nrSamples; smpToMix > 0; ) {
-                int smpOffset = mChn.getOffset();
-                float smpFracOffset = mChn.getFracOffset();
-                float freqInc = mChn.getFrequencyInc();
-                float mixBlockLength;
+        template< int STRIDE >
+        static float value( const std::int8_t* pSmpData,std::int64_t position )
+        {
+            return integerValue< STRIDE >( pSmpData,position );
+        }
 
-                if ( mChn.isPlayingForwards() ) {
-                    mixBlockLength = (float)sample.getRepeatEnd() - ((float)smpOffset + smpFracOffset) + freqInc - MXR_EPSILON;  
-                } else {
-                    mixBlockLength = - (float)sample.getRepeatOffset() + (float)smpOffset + smpFracOffset + freqInc - MXR_EPSILON;
-                    freqInc = -freqInc;
-                }               
-                mixBlockLength = std::max( mixBlockLength,mChn.getFrequencyInc() ); // extra safety
-                int nrSamplesLeft = (int)(mixBlockLength / mChn.getFrequencyInc()); 
-                nrSamplesLeft = std::min( nrSamplesLeft,smpToMix );
-                assert( nrSamplesLeft <= maxSamples ); // added for debugging safety
-                mixBlockLength = nrSamplesLeft * freqInc;
+        template< int STRIDE,typename SampleType >
+        static float integerValue( const SampleType* pSmpData,std::int64_t position )
+        {
+            const SampleType* p = pSmpData + getIndex( position ) * STRIDE;
+            int p0 = widen( p[-STRIDE] );
+            int p1 = widen( p[0] );
+            int p2 = widen( p[STRIDE] );
+            int p3 = widen( p[2 * STRIDE] );
+
+            float fract = getFract( position );
+            int t = p1 - p2;
+            float a = (float)(((t << 1) + t - p0 + p3) >> 1);
+            float b = (float)((p2 << 1) + p0 - (((p1 << 2) + p1 + p3) >> 1));
+            float c = (float)((p2 - p0) >> 1);
+            return ((a * fract + b) * fract + c) * fract + (float)p1;
+        }
 
-#ifdef showdebuginfo
-                std::cout
-                    << "\nnrSamplesLeft * FreqInc       = mixBlockLength"
-                    << "\n" << std::setw( 13 ) << nrSamplesLeft << " * " << std::setw( 13 ) << freqInc << " = " << mixBlockLength
-                    << "\n";
-#endif
-                /*
-                    The below "if" statement is needed for interpolation, 
-                    otherwise the negative sample index get rounded to the 
-                    wrong side - this is so because backward playing 
-                    interpolation uses the same sample points as forward 
-                    playing interpolation
-                */
-                if ( mChn.isPlayingBackwards() ) {
-                    // substract mixBlockLength from the offset 
-                    float endPosition = (float)smpOffset + mixBlockLength + smpFracOffset; // mixBlockLength < 0                   
-                    smpOffset = (int)floor( endPosition ); // prevent wrong integer truncation below 0
-                    smpFracOffset = (float)endPosition - (float)smpOffset - mixBlockLength; // mixBlockLength < 0
-#ifdef showdebuginfo
-                    std::cout
-                        << "\nendPosition                    = " << endPosition
-                        << "\nsmpOffset                      = " << smpOffset
-                        << "\nsmpFracOffset                  = " << smpFracOffset
-                        << "\n"
-                        ;
-                    _getch();
-#endif
-                }
-                // the memset can be removed once the mixing procedures have been updated from
-                // adding the sample data to storing it:
-                memset( alignedBuffer,0,maxSamples * sizeof( DestBufferType ) );
+        template< int STRIDE >
+        static float value( const float* pSmpData,std::int64_t position )
+        {
+            const float* p = pSmpData + getIndex( position ) * STRIDE;
+            float p0 = p[-STRIDE];
+            float p1 = p[0];
+            float p2 = p[STRIDE];
+            float p3 = p[2 * STRIDE];
+
+            float fract = getFract( position );
+            float t = p1 - p2;
+            float a = (t + t + t - p0 + p3) * 0.5f;
+            float b = (p2 + p2 + p0) - (p1 * 4.0f + p1 + p3) * 0.5f;
+            float c = (p2 - p0) * 0.5f;
+            return ((a * fract + b) * fract + c) * fract + p1;
+        }
+    };
 
-                
-                if ( mChn.isVolumeRamping() ) {
-#ifdef enable_volume_ramps                    
-                    int volRampSamples = std::min(
-                        nrSamplesLeft,
-                        mChn.getVolumeRampLength() - mChn.getVolumeRampPosition() );
-                    doMixChannel(
-                        alignedBuffer, //mixBufferPTR + chnMixIdx,
-                        SampleDataPTR + (sample.isMono() ? smpOffset : smpOffset << 1),
-                        volRampSamples,
-                        leftGain,
-                        rightGain,
-                        smpFracOffset,
-                        freqInc,
-                        sample.isMono()
-                        );
-                   
-                    int volRampOfs = mChn.getVolumeRampPosition() << 1;
-                    for ( int i = 0; i < (volRampSamples << 1); i++ ) {
-#ifdef debug_volume_ramp
-                        if( (i & 0x1) == 0)
-                        std::cout
-                            << "\nBefore: "
-                            << std::setw( 10 ) << alignedBuffer[i]
-                            << std::setw( 10 ) << alignedBuffer[i + 1]
-                            ;
-#endif
-                        alignedBuffer[i] *= mChn.getVolumeRampVal( volRampOfs + i );
-#ifdef debug_volume_ramp
-                        if ( (i & 0x1) == 0 )
-                        std::cout << ", after: "
-                            << std::setw( 10 ) << alignedBuffer[i]
-                            << std::setw( 10 ) << alignedBuffer[i + 1]
-                            ;
-#endif
-                    }
-#ifdef debug_volume_ramp
-                    std::cout << "\n";
-                    _getch();
-#endif
+    template< int INTERPOLATION >
+    struct InterpolatorFor;
 
-                    mChn.setVolumeRampPosition( mChn.getVolumeRampPosition() + volRampSamples );
-                    if ( mChn.getVolumeRampPosition() >= mChn.getVolumeRampLength() ) {
-                        mChn.endVolumeRamp();
-                        // recalculate gain values & reset volume
-                        leftGain = mxr_gain_ * mChn.getLeftVolume();  
-                        rightGain = mxr_gain_ * mChn.getRightVolume();
-                        if ( mChn.isDying() ) {
-                            mChn.deactivate();
-                        }                       
-                    }
-                    // add the volume ramp processed channel to the master mixer channel:
-                    DestBufferType* src = alignedBuffer;
-                    DestBufferType* dst = mixBufferPTR + chnMixIdx;
-                    for ( int s = 0; s < (volRampSamples << 1);s++ ) { // to optimize
-                        dst[s] += src[s];
-                    }
-                    chnMixIdx += volRampSamples << 1; // * 2 for stereo
-                    smpToMix -= volRampSamples;
-                    float displacement = volRampSamples * freqInc + smpFracOffset;
-                    smpOffset += (int)displacement;
-                    smpFracOffset = displacement - (int)displacement;
+    template<>
+    struct InterpolatorFor< MXR_NO_INTERPOLATION > {
+        typedef ChannelInterpolator< NoInterpolation > type;
+    };
 
-                    if ( !mChn.isActive() ) 
-                        break;    // quit loop, next channel
-#else
-                    mChn.endVolumeRamp();
-#endif
-                } else {
+    template<>
+    struct InterpolatorFor< MXR_LINEAR_INTERPOLATION > {
+        typedef ChannelInterpolator< LinearInterpolation > type;
+    };
 
-                    // normal mixing
-                    doMixChannel(
-                        alignedBuffer, //mixBufferPTR + chnMixIdx,
-                        SampleDataPTR + (sample.isMono() ? smpOffset : smpOffset << 1),
-                        nrSamplesLeft,
-                        leftGain,
-                        rightGain,
-                        smpFracOffset,
-                        freqInc,
-                        sample.isMono()
-                        );
-
-                    // to optimize:
-                    DestBufferType* src = alignedBuffer;
-                    DestBufferType* dst = mixBufferPTR + chnMixIdx;
-                    for ( int s = 0; s < (nrSamplesLeft << 1);s++ ) {
-                        dst[s] += src[s];
-                        //if ( (s & 0x1) == 0 )
-                        //    std::cout << "\nL: " << src[s];
-                        //else
-                        //    std::cout << ", R: " << src[s];
-                    }
-                    // end: to optimize
+    template<>
+    struct InterpolatorFor< MXR_CUBIC_INTERPOLATION > {
+        typedef ChannelInterpolator< CubicInterpolation > type;
+    };
 
-                    chnMixIdx += nrSamplesLeft << 1; // * 2 for stereo
-                    smpToMix -= nrSamplesLeft;
+    /*
+        The sinc coefficients are the same for both channels of a frame, 
+        they are only calculated once.
+    */
+    struct SincInterpolator {
+        SincInterpolator() : sincTable_( SincTable::get() ) {}
 
-                    float displacement = mixBlockLength + smpFracOffset;
-                    smpOffset += (int)displacement;
-                    smpFracOffset = displacement - (int)displacement;
-                }
-                double nextPosition = (double)smpOffset + smpFracOffset;
-                /*
-                    Note that sample.getRepeatEnd() points to the position 
-                    beyond the last sample. This is so because otherwise we
-                    wouldn't play the last sample itself.
-                */
-                if ( mChn.isPlayingForwards() ) {
-                    if ( nextPosition >= (float)(sample.getRepeatEnd()) ) {
-                        if ( sample.isRepeatSample() ) {
-                            if ( sample.isPingpongSample() ) {
-                                nextPosition =
-                                    (double)(sample.getRepeatEnd() << 1) - nextPosition - 1.0;
-#ifdef showdebuginfo
-                                std::cout 
-                                    << "\nOld Position = " << nextPosition - (double)freqInc
-                                    << ", New Position = " << newPosition 
-                                    << " // at end of sample: bounce back"
-                                    << "\n";
-#endif
-                                mChn.setPlayBackwards();
-                            } else {
-                                nextPosition =
-                                    (double)sample.getRepeatOffset()
-                                    + nextPosition - (double)sample.getRepeatEnd();
-#ifdef showdebuginfo
-                                std::cout
-                                    << "\nnextPosition = " << nextPosition
-                                    << ", newPosition = " << newPosition
-                                    << "   // at beginning of sample, normal repeat"
-                                    << "\n";
-#endif
-                            }
-                        } else {
-                            mChn.deactivate();
-                            break; // quit loop "for ( int smpToMix = nrSamples; smpToMix > 0; )"
-                        }
-                    }
-                } else {    
-                    if ( nextPosition <= (double)sample.getRepeatOffset() ) {
-                        // Backwards playing samples are always (pingpong) looping samples
-                        nextPosition =
-                            (double)(sample.getRepeatOffset() << 1) - nextPosition;
-#ifdef showdebuginfo
-                        std::cout
-                            << "\nnextPosition = " << nextPosition
-                            << ", newPosition = " << newPosition
-                            << "   // at beginning of sample, bounceback"
-                            << "\n";
-                        _getch();
-#endif
-                        mChn.setPlayForwards();
-                    }
-                }
-                // update position in sample data for this channel: 
-                mChn.setOffset( (int)nextPosition );
-                mChn.setFracOffset( (float)(nextPosition - (int)nextPosition) );
+        template< bool IS_STEREO,typename SampleType >
+        void get( const SampleType* pSmpData,std::int64_t position,float& left,float& right ) const
+        {
+            using namespace MixerSincHelperFn;
+            const int stride = IS_STEREO ? 2 : 1;
+            const float* c0;
+            float weight;
+            int idx = getSincPhase( sincTable_,position,c0,weight );
+            const float* c1 = c0 + SINC_NR_TAPS;
+            const SampleType* p = pSmpData + (idx - SINC_NR_TAPS_BEFORE) * stride;
+            float l[SINC_NR_TAPS];
+            float r[SINC_NR_TAPS];
+            for ( int k = 0; k < SINC_NR_TAPS; k++ ) {
+                float coef = c0[k] + (c1[k] - c0[k]) * weight;
+                l[k] = (float)widen( p[k * stride] ) * coef;
+                if ( IS_STEREO )
+                    r[k] = (float)widen( p[k * stride + 1] ) * coef;
             }
+            left = ((l[0] + l[4]) + (l[2] + l[6])) + ((l[1] + l[5]) + (l[3] + l[7]));
+            right = IS_STEREO ? 
+                ((r[0] + r[4]) + (r[2] + r[6])) + ((r[1] + r[5]) + (r[3] + r[7])) : left;
         }
-    }
-    mixIndex_ += nrSamples << 1; // *2 for stereo
-}
 
-void Mixer::doMixChannel(
-    DestBufferType* pBuffer,
-    std::int16_t* pSmpData,
-    int nrSamples,
-    float leftGain,
-    float rightGain,
-    float fracOffset,
-    float freqInc,
-    bool isMono
-)
-{
-    if ( isMono ) {
-        switch ( mxr_interpolationType_ ) {
-            case MXR_NO_INTERPOLATION:
-            {
-                MixMonoSampleNoInterpolation (
-                    pBuffer,
-                    pSmpData,
-                    nrSamples,
-                    leftGain,
-                    rightGain,
-                    fracOffset,
-                    freqInc 
-                );
-                break;
-            }
-            case MXR_LINEAR_INTERPOLATION:
-            {
-                MixMonoSampleLinearInterpolation_sse41_v2(
-                //MixMonoSampleLinearInterpolation(
-                    pBuffer,
-                    pSmpData,
-                    nrSamples,
-                    leftGain,
-                    rightGain,
-                    fracOffset,
-                    freqInc
-                );
-                break;
-            }
-            case MXR_CUBIC_INTERPOLATION:
-            {
-                MixMonoSampleCubicInterpolation(
-                    pBuffer,
-                    pSmpData,
-                    nrSamples,
-                    leftGain,
-                    rightGain,
-                    fracOffset,
-                    freqInc
-                );
-                break;
-            }
-            case MXR_SINC_INTERPOLATION:
-            { 
-                MixMonoSampleSincInterpolation(
-                    pBuffer,
-                    pSmpData,
-                    nrSamples,
-                    leftGain,
-                    rightGain,
-                    fracOffset,
-                    freqInc
-                );
-                break;
-            }
-        }
-    } else {  // mix stereo sample
-        switch ( mxr_interpolationType_ ) {
-            case MXR_NO_INTERPOLATION:
-            {
-                MixStereoSampleNoInterpolation(
-                    pBuffer,
-                    pSmpData,
-                    nrSamples,
-                    leftGain,
-                    rightGain,
-                    fracOffset,
-                    freqInc
-                );
-                break;
-            }
-            case MXR_LINEAR_INTERPOLATION:
-            {
-                MixStereoSampleLinearInterpolation(
-                    pBuffer,
-                    pSmpData,
-                    nrSamples,
-                    leftGain,
-                    rightGain,
-                    fracOffset,
-                    freqInc
-                );
-                break;
-            }
-            case MXR_CUBIC_INTERPOLATION:
-            {
-                MixStereoSampleCubicInterpolation(
-                    pBuffer,
-                    pSmpData,
-                    nrSamples,
-                    leftGain,
-                    rightGain,
-                    fracOffset,
-                    freqInc
-                );
-                break;
-            }
-            case MXR_SINC_INTERPOLATION:
-            {
-                MixStereoSampleSincInterpolation(
-                    pBuffer,
-                    pSmpData,
-                    nrSamples,
-                    leftGain,
-                    rightGain,
-                    fracOffset,
-                    freqInc
-                );
-                break;
+        const SincTable& sincTable_;
+    };
+
+    template<>
+    struct InterpolatorFor< MXR_SINC_INTERPOLATION > {
+        typedef SincInterpolator type;
+    };
+
+    template< int INTERPOLATION,int VARIANT >
+    void mixSample(
+        DestBufferType* pBuffer,
+        const void* sampleData,
+        int nrSamples,
+        float leftGain,
+        float rightGain,
+        float leftGainDelta,
+        float rightGainDelta,
+        std::int64_t position,
+        std::int64_t positionStep
+    )
+    {
+        const bool isStereo = (VARIANT & MXR_MIX_STEREO) != 0;
+        const bool isRamping = (VARIANT & MXR_MIX_VOLUME_RAMP) != 0;
+        const bool isBackwards = (VARIANT & MXR_MIX_BACKWARDS) != 0;
+        typedef typename SampleTypeFor< VARIANT >::type SampleType;
+        const SampleType* pSmpData = (const SampleType*)sampleData;
+        typename InterpolatorFor< INTERPOLATION >::type interpolator;
+        for ( int s = 0; s < nrSamples; s++ ) {
+            float left;
+            float right;
+            interpolator.template get< isStereo >( pSmpData,position,left,right );
+            *pBuffer++ += left * leftGain;
+            *pBuffer++ += right * rightGain;
+            if ( isRamping ) {
+                leftGain += leftGainDelta;
+                rightGain += rightGainDelta;
             }
+            position = advance< isBackwards >( position,positionStep );
         }
     }
-}
 
-
-void Mixer::MixMonoSampleNoInterpolation( 
-    DestBufferType* pBuffer,
-    std::int16_t* pSmpData,
-    int nrSamples,
-    float leftGain,
-    float rightGain,
-    float fracOffset,
-    float freqInc
-    )
-{
-    for ( int s = 0; s < nrSamples; s++ ) {
-        float f = (float)pSmpData[(int)fracOffset];
-        *pBuffer++ += ((float)f * leftGain);
-        *pBuffer++ += ((float)f * rightGain);
-        fracOffset += freqInc;
+    template< int INTERPOLATION >
+    MixRoutine getScalarMixRoutine( int variant )
+    {
+        static const MixRoutine mixRoutines[MXR_MIX_ROUTINE_VARIANTS] = {
+            mixSample< INTERPOLATION,0 >,
+            mixSample< INTERPOLATION,1 >,
+            mixSample< INTERPOLATION,2 >,
+            mixSample< INTERPOLATION,3 >,
+            mixSample< INTERPOLATION,4 >,
+            mixSample< INTERPOLATION,5 >,
+            mixSample< INTERPOLATION,6 >,
+            mixSample< INTERPOLATION,7 >,
+            mixSample< INTERPOLATION,8 >,
+            mixSample< INTERPOLATION,9 >,
+            mixSample< INTERPOLATION,10 >,
+            mixSample< INTERPOLATION,11 >,
+            mixSample< INTERPOLATION,12 >,
+            mixSample< INTERPOLATION,13 >,
+            mixSample< INTERPOLATION,14 >,
+            mixSample< INTERPOLATION,15 >,
+            mixSample< INTERPOLATION,16 >,
+            mixSample< INTERPOLATION,17 >,
+            mixSample< INTERPOLATION,18 >,
+            mixSample< INTERPOLATION,19 >,
+            mixSample< INTERPOLATION,20 >,
+            mixSample< INTERPOLATION,21 >,
+            mixSample< INTERPOLATION,22 >,
+            mixSample< INTERPOLATION,23 >,
+            mixSample< INTERPOLATION,24 >,
+            mixSample< INTERPOLATION,25 >,
+            mixSample< INTERPOLATION,26 >,
+            mixSample< INTERPOLATION,27 >,
+            mixSample< INTERPOLATION,28 >,
+            mixSample< INTERPOLATION,29 >,
+            mixSample< INTERPOLATION,30 >,
+            mixSample< INTERPOLATION,31 >
+        };
+        return mixRoutines[variant];
     }
-}
 
-void Mixer::MixMonoSampleLinearInterpolation(
-    DestBufferType* pBuffer,
-    std::int16_t* pSmpData,
-    int nrSamples,
-    float leftGain,
-    float rightGain,
-    float fracOffset,
-    float freqInc
-)
-{
-    for ( int s = 0; s < nrSamples; s++ ) {
-        float p1 = (float)pSmpData[(int)fracOffset];
-        float p2 = (float)pSmpData[(int)fracOffset + 1];
-        float f = p1 + (p2 - p1) * (fracOffset - (float)((int)fracOffset));
-        *pBuffer++ += ((float)f * leftGain);
-        *pBuffer++ += ((float)f * rightGain);
-        fracOffset += freqInc;
-    }
-}
+    /*
+        The SIMD routines are templates as well, for the direction and for 
+        the type of the sample data. They hand the last frames over to the
+        scalar routine of the same variant.
+    */
+    template< bool IS_BACKWARDS,typename SampleType >
+    struct ScalarVariant {
+        static const int value = 
+            (IS_BACKWARDS ? MXR_MIX_BACKWARDS : 0) |
+            (std::is_same< SampleType,float >::value ? MXR_MIX_FLOAT_DATA : 0) |
+            (std::is_same< SampleType,std::int8_t >::value ? MXR_MIX_8BIT_DATA : 0);
+    };
 
-/*
-    This SSE4.1 optimized mixing function is copyright by:
-    Bart Goossens / Ghent University
+    /*
+        This SSE4.1 optimized mixing function is copyright by:
+        Bart Goossens / Ghent University
 
-*/
-void Mixer::MixMonoSampleLinearInterpolation_sse41_v2(
-    DestBufferType* pBuffer,
-    std::int16_t* pSmpData,
-    int nrSamples,
-    float leftGain,
-    float rightGain,
-    float fracOffset,
-    float freqInc
+        4 frames per loop, the buffer does not need to be aligned. The last
+        nrSamples % 4 frames are left to the scalar routine, so that nothing
+        is written beyond the end of the buffer.
+    */
+    template< bool IS_BACKWARDS,typename SampleType >
+    MXR_TARGET_SSE41 void mixMonoSampleLinearInterpolation_sse41(
+        DestBufferType* pBuffer,
+        const void* sampleData,
+        int nrSamples,
+        float leftGain,
+        float rightGain,
+        float /*leftGainDelta*/,
+        float /*rightGainDelta*/,
+        std::int64_t position,
+        std::int64_t positionStep
     )
-{
-    __m128 FreqInc = _mm_broadcast_ps( freqInc );
-    __m128 freqInc1 = { 0, 1, 0, 1 };
-    __m128 G = { leftGain, rightGain, leftGain, rightGain };
-    __m128i pattern1 = _mm_set_epi32( 0x00000001,0x00000001,0x00000001,0x00000001 ); // _mm_setr_epi16(1, 0, 1, 0, 1, 0, 1, 0);
-    __m128i pattern2 = _mm_set_epi32( 0x00010000,0x00010000,0x00010000,0x00010000 ); // _mm_setr_epi16(0, 1, 0, 1, 0, 1, 0, 1);
-
-    nrSamples <<= 1;
-    int s = 0;
-    for ( ; s < (nrSamples + 7); s += 8 )   // mix a few more bytes than we need
     {
-        // Part 3
-        __m128 A1 = _mm_load_ps( &pBuffer[s] );
-        __m128 A2 = _mm_load_ps( &pBuffer[s + 4] );
-
-        // Part 1 - calculate offset
-        //__m128 F = _mm_broadcast_ps(fracOffset);
-        /*
-        float fracOffset1 = fracOffset + freqInc;
-        float fracOffset2 = fracOffset1 + freqInc;
-        float fracOffset3 = fracOffset2 + freqInc;
-        __m128 F = _mm_setr_ps(fracOffset, fracOffset1, fracOffset2, fracOffset3);
-        */
-        __m128 delta = _mm_set1_ps( freqInc );
-        __m128 fracOffset0 = _mm_set1_ps( fracOffset );
-        __m128 fracOffset1 = _mm_add_ss( fracOffset0,delta );
-        __m128 fracOffset2 = _mm_add_ss( fracOffset1,delta );
-        __m128 fracOffset3 = _mm_add_ss( fracOffset2,delta );
-        __m128 F = _mm_shuffle_ps( _mm_shuffle_ps( fracOffset0,fracOffset1,0x0 ),
-            _mm_shuffle_ps( fracOffset2,fracOffset3,0x0 ),0x88 ); // 10001000
-
-// Part 1 - index calculations
-        __m128i I1 = _mm_cvttps_epi32( _mm_add_ps( _mm_shuffle_ps( F,F,0x50 ),freqInc1 ) ); // 01010000b
-        __m128i I2 = _mm_cvttps_epi32( _mm_add_ps( _mm_shuffle_ps( F,F,0xFA ),freqInc1 ) ); // 11111010b
-
-        // Part 1 - read pSmpData
-        __m128i P = _mm_setr_epi16(
-            pSmpData[I1.m128i_i32[0]],pSmpData[I1.m128i_i32[1]],
-            pSmpData[I1.m128i_i32[2]],pSmpData[I1.m128i_i32[3]],
-            pSmpData[I2.m128i_i32[0]],pSmpData[I2.m128i_i32[1]],
-            pSmpData[I2.m128i_i32[2]],pSmpData[I2.m128i_i32[3]] );
-
-        // Part 1 - convert uint16 to floating point
-        __m128i Q = P;
-        P = _mm_madd_epi16( P,pattern1 );
-        Q = _mm_madd_epi16( Q,pattern2 );
-
-        __m128 P1 = _mm_cvtepi32_ps( P );
-        __m128 P2 = _mm_cvtepi32_ps( Q );
-
-        // Part 2 - floor calculation
-        __m128 F2 = _mm_sub_ps( F,_mm_floor_ps( F ) );
+        using namespace MixerSse41HelperFn;
+        const SampleType* pSmpData = (const SampleType*)sampleData;
+        std::int64_t step = IS_BACKWARDS ? -positionStep : positionStep;
+        __m128i laneSteps0 = _mm_set_epi64x( step,0 );
+        __m128i laneSteps1 = _mm_set_epi64x( step * 3,step * 2 );
+        __m128 scale = _mm_set1_ps( MXR_FRACTION_SCALE );
+        __m128 G = { leftGain, rightGain, leftGain, rightGain };
+
+        int nrFloats = (nrSamples & ~0x3) << 1;
+        int s = 0;
+        for ( ; s < nrFloats; s += 8 )
+        {
+            // Part 3
+            __m128 A1 = _mm_loadu_ps( &pBuffer[s] );
+            __m128 A2 = _mm_loadu_ps( &pBuffer[s + 4] );
+
+            // Part 1 - calculate the 32.32 positions of 4 frames
+            __m128i pos = _mm_set1_epi64x( position );
+            __m128 pos0 = _mm_castsi128_ps( _mm_add_epi64( pos,laneSteps0 ) );
+            __m128 pos1 = _mm_castsi128_ps( _mm_add_epi64( pos,laneSteps1 ) );
+
+            // Part 1 - index calculations
+            __m128i I = _mm_castps_si128( _mm_shuffle_ps( pos0,pos1,0xDD ) ); // 11011101b
+
+            // Part 1 - read pSmpData as floating point
+            __m128 P1;
+            __m128 P2;
+            loadLinearPoints( pSmpData,I,P1,P2 );
+
+            // Part 2 - fraction calculation
+            __m128i fraction = _mm_srli_epi32( 
+                _mm_castps_si128( _mm_shuffle_ps( pos0,pos1,0x88 ) ), // 10001000b
+                MXR_POSITION_FRACTION_BITS - MXR_FRACTION_BITS );
+            __m128 F2 = _mm_mul_ps( _mm_cvtepi32_ps( fraction ),scale );
+
+            // Part 2 - main calculation
+            __m128 F3 = _mm_add_ps( P1,_mm_mul_ps( _mm_sub_ps( P2,P1 ),F2 ) );
+
+            // Part 3
+            // Shuffle because we need [f1, f1, f2, f2, f3, f3, f4, f4]
+            __m128 FF1 = _mm_shuffle_ps( F3,F3,0x50 ); // 01010000b
+            __m128 FF2 = _mm_shuffle_ps( F3,F3,0xFA ); // 11111010b
+
+            _mm_storeu_ps( &pBuffer[s],_mm_add_ps( A1,_mm_mul_ps( FF1,G ) ) );
+            _mm_storeu_ps( &pBuffer[s + 4],_mm_add_ps( A2,_mm_mul_ps( FF2,G ) ) );
+            position += step * 4;
+        }
+        mixSample< MXR_LINEAR_INTERPOLATION,ScalarVariant< IS_BACKWARDS,SampleType >::value >(
+            pBuffer + s,pSmpData,nrSamples & 0x3,leftGain,rightGain,0.0f,0.0f,
+            position,positionStep );
+    }
 
-        // Part 2 - main calculation
-        __m128 F3 = _mm_add_ps( P1,_mm_mul_ps( _mm_sub_ps( P2,P1 ),F2 ) );
+    /*
+        8 frames per loop, see cubicMono(). The last nrSamples % 8 frames 
+        are left to the scalar routine. 
+        
+        GCC does not clear the upper halves of the AVX registers before a 
+        tail call, the SSE code that runs next would then be slowed down by
+        false dependencies on them. Hence the explicit _mm256_zeroupper().
+    */
+    template< bool IS_BACKWARDS,typename SampleType >
+    MXR_TARGET_AVX2 void mixMonoSampleCubicInterpolation_avx2(
+        DestBufferType* pBuffer,
+        const void* sampleData,
+        int nrSamples,
+        float leftGain,
+        float rightGain,
+        float /*leftGainDelta*/,
+        float /*rightGainDelta*/,
+        std::int64_t position,
+        std::int64_t positionStep
+    )
+    {
+        using namespace MixerAvx2HelperFn;
+        const SampleType* pSmpData = (const SampleType*)sampleData;
+        std::int64_t step = IS_BACKWARDS ? -positionStep : positionStep;
+        __m256i laneSteps[2];
+        getLaneSteps( step,laneSteps );
+        __m256 gains = _mm256_setr_ps( 
+            leftGain,rightGain,leftGain,rightGain,leftGain,rightGain,leftGain,rightGain );
+        int s = 0;
+        for ( ; s + 8 <= nrSamples; s += 8 ) {
+            __m256i idx;
+            __m256 fract;
+            getPositions( position,laneSteps,idx,fract );
+
+            __m256 f = cubicMono( pSmpData,idx,fract );
+            addFrames( pBuffer,f,f,gains );
+
+            pBuffer += 16;
+            position += step * 8;
+        }
+        _mm256_zeroupper();
+        mixSample< MXR_CUBIC_INTERPOLATION,ScalarVariant< IS_BACKWARDS,SampleType >::value >(
+            pBuffer,pSmpData,nrSamples - s,leftGain,rightGain,0.0f,0.0f,position,positionStep );
+    }
 
-        // Part 3
-        // Shuffle because we need [f1, f1, f2, f2, f3, f3, f4, f4]
-        __m128 FF1 = _mm_shuffle_ps( F3,F3,0x50 ); // 01010000b
-        __m128 FF2 = _mm_shuffle_ps( F3,F3,0xFA ); // 11111010b
+    /*
+        Like the mono version, see cubicStereo()
+    */
+    template< bool IS_BACKWARDS,typename SampleType >
+    MXR_TARGET_AVX2 void mixStereoSampleCubicInterpolation_avx2(
+        DestBufferType* pBuffer,
+        const void* sampleData,
+        int nrSamples,
+        float leftGain,
+        float rightGain,
+        float /*leftGainDelta*/,
+        float /*rightGainDelta*/,
+        std::int64_t position,
+        std::int64_t positionStep
+    )
+    {
+        using namespace MixerAvx2HelperFn;
+        const SampleType* pSmpData = (const SampleType*)sampleData;
+        std::int64_t step = IS_BACKWARDS ? -positionStep : positionStep;
+        __m256i laneSteps[2];
+        getLaneSteps( step,laneSteps );
+        __m256 gains = _mm256_setr_ps( 
+            leftGain,rightGain,leftGain,rightGain,leftGain,rightGain,leftGain,rightGain );
+        int s = 0;
+        for ( ; s + 8 <= nrSamples; s += 8 ) {
+            __m256i idx;
+            __m256 fract;
+            getPositions( position,laneSteps,idx,fract );
+
+            __m256 left;
+            __m256 right;
+            cubicStereo( pSmpData,idx,fract,left,right );
+            addFrames( pBuffer,left,right,gains );
+
+            pBuffer += 16;
+            position += step * 8;
+        }
+        _mm256_zeroupper();
+        mixSample< MXR_CUBIC_INTERPOLATION,
+            MXR_MIX_STEREO | ScalarVariant< IS_BACKWARDS,SampleType >::value >(
+            pBuffer,pSmpData,nrSamples - s,leftGain,rightGain,0.0f,0.0f,position,positionStep );
+    }
 
-        _mm_store_ps( &pBuffer[s],_mm_add_ps( A1,_mm_mul_ps( FF1,G ) ) );
-        _mm_store_ps( &pBuffer[s + 4],_mm_add_ps( A2,_mm_mul_ps( FF2,G ) ) );
-        //fracOffset += 4 * freqInc;
-        fracOffset = F.m128_f32[3] + freqInc;
+    template< bool IS_BACKWARDS,typename SampleType >
+    void mixMonoSampleSincInterpolation_sse2(
+        DestBufferType* pBuffer,
+        const void* sampleData,
+        int nrSamples,
+        float leftGain,
+        float rightGain,
+        float /*leftGainDelta*/,
+        float /*rightGainDelta*/,
+        std::int64_t position,
+        std::int64_t positionStep
+    )
+    {
+        using namespace MixerSincHelperFn;
+        const SampleType* pSmpData = (const SampleType*)sampleData;
+        const SincTable& sincTable = SincTable::get();
+        for ( int s = 0; s < nrSamples; s++ ) {
+            const float* coefficients;
+            float weight;
+            int idx = getSincPhase( sincTable,position,coefficients,weight );
+            __m128 w = _mm_set1_ps( weight );
+            __m128 coefLo = getCoefficients( coefficients,w );
+            __m128 coefHi = getCoefficients( coefficients + 4,w );
+
+            __m128 pLo;
+            __m128 pHi;
+            loadTaps( pSmpData + idx - SINC_NR_TAPS_BEFORE,pLo,pHi );
+            __m128 partialSums = _mm_add_ps( _mm_mul_ps( pLo,coefLo ),_mm_mul_ps( pHi,coefHi ) );
+            float f = _mm_cvtss_f32( addPartialSums( partialSums,partialSums ) );
+            *pBuffer++ += f * leftGain;
+            *pBuffer++ += f * rightGain;
+            position = advance< IS_BACKWARDS >( position,positionStep );
+        }
     }
-}
 
+    template< bool IS_BACKWARDS,typename SampleType >
+    MXR_TARGET_AVX2 void mixMonoSampleSincInterpolation_avx2(
+        DestBufferType* pBuffer,
+        const void* sampleData,
+        int nrSamples,
+        float leftGain,
+        float rightGain,
+        float /*leftGainDelta*/,
+        float /*rightGainDelta*/,
+        std::int64_t position,
+        std::int64_t positionStep
+    )
+    {
+        using namespace MixerSincHelperFn;
+        const SampleType* pSmpData = (const SampleType*)sampleData;
+        const SincTable& sincTable = SincTable::get();
+        for ( int s = 0; s < nrSamples; s++ ) {
+            const float* coefficients;
+            float weight;
+            int idx = getSincPhase( sincTable,position,coefficients,weight );
+            __m256 coef = getCoefficients( coefficients,_mm256_set1_ps( weight ) );
+
+            __m256 taps;
+            loadTaps( pSmpData + idx - SINC_NR_TAPS_BEFORE,taps );
+            __m256 products = _mm256_mul_ps( taps,coef );
+            __m128 partialSums = addHalves( products );
+            float f = _mm_cvtss_f32( addPartialSums( partialSums,partialSums ) );
+            *pBuffer++ += f * leftGain;
+            *pBuffer++ += f * rightGain;
+            position = advance< IS_BACKWARDS >( position,positionStep );
+        }
+    }
 
+    template< bool IS_BACKWARDS,typename SampleType >
+    void mixStereoSampleSincInterpolation_sse2(
+        DestBufferType* pBuffer,
+        const void* sampleData,
+        int nrSamples,
+        float leftGain,
+        float rightGain,
+        float /*leftGainDelta*/,
+        float /*rightGainDelta*/,
+        std::int64_t position,
+        std::int64_t positionStep
+    )
+    {
+        using namespace MixerSincHelperFn;
+        const SampleType* pSmpData = (const SampleType*)sampleData;
+        const SincTable& sincTable = SincTable::get();
+        for ( int s = 0; s < nrSamples; s++ ) {
+            const float* coefficients;
+            float weight;
+            int idx = getSincPhase( sincTable,position,coefficients,weight );
+            __m128 w = _mm_set1_ps( weight );
+            __m128 coefLo = getCoefficients( coefficients,w );
+            __m128 coefHi = getCoefficients( coefficients + 4,w );
+
+            __m128 leftLo;
+            __m128 leftHi;
+            __m128 rightLo;
+            __m128 rightHi;
+            loadFrames( pSmpData + ((idx - SINC_NR_TAPS_BEFORE) << 1),
+                leftLo,leftHi,rightLo,rightHi );
+            __m128 sums = addPartialSums(
+                _mm_add_ps( _mm_mul_ps( leftLo,coefLo ),_mm_mul_ps( leftHi,coefHi ) ),
+                _mm_add_ps( _mm_mul_ps( rightLo,coefLo ),_mm_mul_ps( rightHi,coefHi ) ) );
+            *pBuffer++ += _mm_cvtss_f32( sums ) * leftGain;
+            *pBuffer++ += _mm_cvtss_f32( _mm_shuffle_ps( sums,sums,0x01 ) ) * rightGain;
+            position = advance< IS_BACKWARDS >( position,positionStep );
+        }
+    }
 
-void Mixer::MixMonoSampleCubicInterpolation(
-    DestBufferType* pBuffer,
-    std::int16_t* pSmpData,
-    int nrSamples,
-    float leftGain,
-    float rightGain,
-    float fracOffset,
-    float freqInc
-) 
-{
-    for ( int s = 0; s < nrSamples; s++ ) {
-        int p0 = pSmpData[(int)fracOffset - 1];
-        int p1 = pSmpData[(int)fracOffset];
-        int p2 = pSmpData[(int)fracOffset + 1];
-        int p3 = pSmpData[(int)fracOffset + 2];
-
-        float fract = fracOffset - (int)fracOffset;
-        int t = p1 - p2;
-        float a = (float)(((t << 1) + t - p0 + p3) >> 1);
-        float b = (float)((p2 << 1) + p0 - (((p1 << 2) + p1 + p3) >> 1));
-        float c = (float)((p2 - p0) >> 1);
-        float f = ((a * fract + b) * fract + c) * fract + (float)p1;
-        *pBuffer++ += f * leftGain;
-        *pBuffer++ += f * rightGain;
-#ifdef showdebuginfo
-        std::cout
-            << std::setw(16) << fracOffset;
-#endif
-        fracOffset += freqInc;
+    template< bool IS_BACKWARDS,typename SampleType >
+    MXR_TARGET_AVX2 void mixStereoSampleSincInterpolation_avx2(
+        DestBufferType* pBuffer,
+        const void* sampleData,
+        int nrSamples,
+        float leftGain,
+        float rightGain,
+        float /*leftGainDelta*/,
+        float /*rightGainDelta*/,
+        std::int64_t position,
+        std::int64_t positionStep
+    )
+    {
+        using namespace MixerAvx2HelperFn;
+        using namespace MixerSincHelperFn;
+        const SampleType* pSmpData = (const SampleType*)sampleData;
+        const SincTable& sincTable = SincTable::get();
+        for ( int s = 0; s < nrSamples; s++ ) {
+            const float* coefficients;
+            float weight;
+            int idx = getSincPhase( sincTable,position,coefficients,weight );
+            __m256 coef = getCoefficients( coefficients,_mm256_set1_ps( weight ) );
+
+            __m256 left;
+            __m256 right;
+            loadFrames( pSmpData + ((idx - SINC_NR_TAPS_BEFORE) << 1),left,right );
+            __m128 sums = addPartialSums( 
+                addHalves( _mm256_mul_ps( left,coef ) ),addHalves( _mm256_mul_ps( right,coef ) ) );
+            *pBuffer++ += _mm_cvtss_f32( sums ) * leftGain;
+            *pBuffer++ += _mm_cvtss_f32( _mm_shuffle_ps( sums,sums,0x01 ) ) * rightGain;
+            position = advance< IS_BACKWARDS >( position,positionStep );
+        }
     }
 }
 
-void Mixer::MixMonoSampleSincInterpolation(
-    DestBufferType* pBuffer,
-    std::int16_t* pSmpData,
-    int nrSamples,
-    float leftGain,
-    float rightGain,
-    float fracOffset,
-    float freqInc
-) 
+/*
+    Returns the fastest routine for the interpolation type and variant that
+    the instruction set allows. The SIMD routines only mix at a steady 
+    volume: volume ramps are short, they are left to the scalar routines.
+*/
+MixRoutine Mixer::getMixRoutine( int isa,int interpolationType,int variant )
 {
+    using namespace MixRoutines;
+    assert( (interpolationType >= 0) && (interpolationType < MXR_INTERPOLATION_TYPES) );
+    assert( (variant >= 0) && (variant < MXR_MIX_ROUTINE_VARIANTS) );
+    bool isBackwards = (variant & MXR_MIX_BACKWARDS) != 0;
+    bool isFloatData = (variant & MXR_MIX_FLOAT_DATA) != 0;
+    bool is8BitData = (variant & MXR_MIX_8BIT_DATA) != 0;
+
+// the SIMD routine for the direction and the sample data type of the variant:
+#define SIMD_ROUTINE_FOR_VARIANT( routine ) ( isFloatData ?     \
+    (isBackwards ? routine< true,float > : routine< false,float >) : is8BitData ?   \
+    (isBackwards ? routine< true,std::int8_t > : routine< false,std::int8_t >) :    \
+    (isBackwards ? routine< true,std::int16_t > : routine< false,std::int16_t >) )
+
+
+    if ( (variant & MXR_MIX_VOLUME_RAMP) == 0 ) {
+        if ( variant & MXR_MIX_STEREO ) {
+            if ( (isa >= CPU_ISA_AVX2) && (interpolationType == MXR_CUBIC_INTERPOLATION) )
+                return SIMD_ROUTINE_FOR_VARIANT( mixStereoSampleCubicInterpolation_avx2 );
+            if ( (isa >= CPU_ISA_AVX2) && (interpolationType == MXR_SINC_INTERPOLATION) )
+                return SIMD_ROUTINE_FOR_VARIANT( mixStereoSampleSincInterpolation_avx2 );
+            if ( (isa >= CPU_ISA_SSE2) && (interpolationType == MXR_SINC_INTERPOLATION) )
+                return SIMD_ROUTINE_FOR_VARIANT( mixStereoSampleSincInterpolation_sse2 );
+        } else {
+            if ( (isa >= CPU_ISA_AVX2) && (interpolationType == MXR_CUBIC_INTERPOLATION) )
+                return SIMD_ROUTINE_FOR_VARIANT( mixMonoSampleCubicInterpolation_avx2 );
+            if ( (isa >= CPU_ISA_AVX2) && (interpolationType == MXR_SINC_INTERPOLATION) )
+                return SIMD_ROUTINE_FOR_VARIANT( mixMonoSampleSincInterpolation_avx2 );
+            if ( (isa >= CPU_ISA_SSE41) && (interpolationType == MXR_LINEAR_INTERPOLATION) )
+                return SIMD_ROUTINE_FOR_VARIANT( mixMonoSampleLinearInterpolation_sse41 );
+            if ( (isa >= CPU_ISA_SSE2) && (interpolationType == MXR_SINC_INTERPOLATION) )
+                return SIMD_ROUTINE_FOR_VARIANT( mixMonoSampleSincInterpolation_sse2 );
+        }
+    }
+#undef SIMD_ROUTINE_FOR_VARIANT
+
+    switch ( interpolationType ) {
+        case MXR_NO_INTERPOLATION:
+            return getScalarMixRoutine< MXR_NO_INTERPOLATION >( variant );
+        case MXR_LINEAR_INTERPOLATION:
+            return getScalarMixRoutine< MXR_LINEAR_INTERPOLATION >( variant );
+        case MXR_CUBIC_INTERPOLATION:
+            return getScalarMixRoutine< MXR_CUBIC_INTERPOLATION >( variant );
+        default:
+            return getScalarMixRoutine< MXR_SINC_INTERPOLATION >( variant );
+    }
 }
 
-void Mixer::MixStereoSampleNoInterpolation(
-    DestBufferType* pBuffer,
-    std::int16_t* pSmpData,
-    int nrSamples,
-    float leftGain,
-    float rightGain,
-    float fracOffset,
-    float freqInc
-) 
+/*
+    Fills the table with the routine for each variant, for the current 
+    instruction set and interpolation type, and lets every channel pick its
+    routine from the new table.
+*/
+void Mixer::updateMixRoutines()
 {
-    for ( int s = 0; s < nrSamples; s++ ) {
-        float left = (float)pSmpData[(int)fracOffset << 1];
-        float right = (float)pSmpData[((int)fracOffset << 1) + 1];
-        *pBuffer++ += ((float)left * leftGain);
-        *pBuffer++ += ((float)right * rightGain);
-        fracOffset += freqInc;
-    }
+    for ( int variant = 0; variant < MXR_MIX_ROUTINE_VARIANTS; variant++ )
+        mixRoutines_[variant] = getMixRoutine( isa_,mxr_interpolationType_,variant );
+    for ( unsigned i = 0; i < MXR_MAX_PHYSICAL_CHANNELS; i++ )
+        physicalChannels_[i].setMixRoutines( mixRoutines_ );
 }
 
-void Mixer::MixStereoSampleLinearInterpolation(
-    DestBufferType* pBuffer,
-    std::int16_t* pSmpData,
-    int nrSamples,
-    float leftGain,
-    float rightGain,
-    float fracOffset,
-    float freqInc
-) 
+/*
+    The channels that play pick their routine again, for the new type of 
+    sample data
+*/
+void Mixer::setFloatSampleData( bool useFloatData )
 {
-    for ( int s = 0; s < nrSamples; s++ ) {
-        float left1 = (float)pSmpData[(int)fracOffset << 1];
-        float right1 = (float)pSmpData[((int)fracOffset << 1) + 1];
-        float left2 = (float)pSmpData[((int)fracOffset << 1) + 2];
-        float right2 = (float)pSmpData[((int)fracOffset << 1) + 3];
-
-        float left = left1 + (left2 - left1) * (fracOffset - (float)((int)fracOffset));
-        float right = right1 + (right2 - right1) * (fracOffset - (float)((int)fracOffset));
-
-        *pBuffer++ += ((float)left * leftGain);
-        *pBuffer++ += ((float)right * rightGain);
-        fracOffset += freqInc;
-    }
+    useFloatSampleData_ = useFloatData;
+    if ( module_ != nullptr )
+        module_->setFloatSampleData( useFloatData );
+    updateMixRoutines();
 }
 
-void Mixer::MixStereoSampleCubicInterpolation(
-    DestBufferType* pBuffer,
-    std::int16_t* pSmpData,
-    int nrSamples,
-    float leftGain,
-    float rightGain,
-    float fracOffset,
-    float freqInc
-) 
+int Mixer::setIsa( int isa )
 {
-    for ( int s = 0; s < nrSamples; s++ ) {
-        //std::int16_t* offset = pSmpData + (((int)fracOffset - 1) << 1);
-        //int left0 = *offset++;
-        //int right0 = *offset++;
-        //int left1 = *offset++;
-        //int right1 = *offset++;
-        //int left2 = *offset++;
-        //int right2 = *offset++;
-        //int left3 = *offset++;
-        //int right3 = *offset;
-
-        int offset = (int)fracOffset << 1;
-        int left0 = pSmpData[offset - 2];
-        int right0 = pSmpData[offset - 1];
-        int left1 = pSmpData[offset];
-        int right1 = pSmpData[offset + 1];
-        int left2 = pSmpData[offset + 2];
-        int right2 = pSmpData[offset + 3];
-        int left3 = pSmpData[offset + 4];
-        int right3 = pSmpData[offset + 5];
-
-        float fract = fracOffset - (int)fracOffset;
-        int t = left1 - left2;
-        float a = (float)(((t << 1) + t - left0 + left3) >> 1);
-        float b = (float)((left2 << 1) + left0 - (((left1 << 2) + left1 + left3) >> 1));
-        float c = (float)((left2 - left0) >> 1);
-        float f = ((a * fract + b) * fract + c) * fract + (float)left1;
-        *pBuffer++ += f * leftGain;
-
-        t = right1 - right2;
-        a = (float)(((t << 1) + t - right0 + right3) >> 1);
-        b = (float)((right2 << 1) + right0 - (((right1 << 2) + right1 + right3) >> 1));
-        c = (float)((right2 - right0) >> 1);
-        f = ((a * fract + b) * fract + c) * fract + (float)right1;
-        *pBuffer++ += f * rightGain;
-
-        fracOffset += freqInc;
+    if ( (isa < CPU_ISA_SCALAR) || (isa > cpuGetSupportedIsa()) ) {
+        std::cout << "\nThis cpu does not support " << cpuGetIsaName( isa ) << "\n";
+        return -1;
     }
+    isa_ = isa;
+    updateMixRoutines();
+    return 0;
 }
 
-void Mixer::MixStereoSampleSincInterpolation(
-    DestBufferType* pBuffer,
-    std::int16_t* pSmpData,
-    int nrSamples,
-    float leftGain,
-    float rightGain,
-    float fracOffset,
-    float freqInc
-) {}
-
 
 /******************************************************************************
 *******************************************************************************
@@ -1159,10 +2344,20 @@ void Mixer::updateNotes()
     unsigned        patternStartRow = 0;
     int             nextPatternDelta = 1;
 
+    /*
+        The last row of the song has been played completely if we arrive
+        here to read the first row of the second pass:
+    */
+    if ( (nrRowsRead_ == passNrRows_) && !songHasEnded_ ) {
+        songHasEnded_ = true;
+        songEndMixIndex_ = mixIndex_;
+    }
+    nrRowsRead_++;
+
 #ifdef debug_mixer
     //char    hex[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
     //unsigned p = module_->getPatternTable( patternTableIdx_ );
-    if ( nrChannels_ < 16 )
+    if ( module_->getVerboseMode() && (nrChannels_ < 16) )
         std::cout << std::setw( 2 ) << patternRow_;
     //std::cout << "\n";
     /*
@@ -1190,6 +2385,7 @@ void Mixer::updateNotes()
         bool        replay = false;
         unsigned    oldInstrument;
         int         finetune = 0;
+        int         nnaControl = -1;
 
         note = iNote_->note;
         instrument = iNote_->instrument;
@@ -1723,6 +2919,15 @@ void Mixer::updateNotes()
                 }
                 case EXTENDED_EFFECTS:
                 {
+                    /*
+                        IT effect S7x acts on the note of this row, so it 
+                        waits until that note has started, see below
+                    */
+                    if ( itStyleEffects_ && (fxloop == (MAX_EFFECT_COLUMNS - 1)) &&
+                        ((argument >> 4) == IT_NNA_CONTROL) ) {
+                        nnaControl = argument & 0xF;
+                        break;
+                    }
                     unsigned extFXArg = argument;
                     if ( st3StyleEffectMemory_ || itStyleEffects_ ) // itStyleEffects_ ?
                         extFXArg = channel.lastExtendedEffect;
@@ -1972,6 +3177,7 @@ void Mixer::updateNotes()
                 channelNr,
                 channel.pInstrument,
                 channel.pSample,
+                note,
                 channel.sampleOffset,
                 //channel.freq
                 FORWARD
@@ -1987,6 +3193,13 @@ void Mixer::updateNotes()
                 channelNr,
                 periodToFrequency( channel.period ) );
         }
+        if ( nnaControl >= 0 ) {
+            if ( nnaControl <= IT_PAST_NOTE_FADE )  // S70 .. S72 
+                doPastNoteAction( channelNr,nnaControl - IT_PAST_NOTE_CUT + DCA_CUT );
+            else if ( nnaControl <= IT_SET_NNA_NOTE_FADE ) // S73 .. S76
+                setNNAMode( channelNr,nnaControl - IT_SET_NNA_NOTE_CUT + NNA_NOTE_CUT );
+            // S77 .. S7C turn the envelopes on and off, the mixer has none yet
+        }
         if ( !isNoteDelayed ) {
             /*
                channel->panning = channel->newpanning;
@@ -1996,20 +3209,12 @@ void Mixer::updateNotes()
             //setVolume(channelNr, channel->volume);    // temp
         }
 #ifdef debug_mixer
-        if ( channelNr < 16 )
+        if ( module_->getVerboseMode() && (channelNr < 16) )
         {
-            // **************************************************
-            // colors in console requires weird shit in windows
-            HANDLE hStdin = GetStdHandle( STD_INPUT_HANDLE );
-            HANDLE hStdout = GetStdHandle( STD_OUTPUT_HANDLE );
-            CONSOLE_SCREEN_BUFFER_INFO csbiInfo;
-            GetConsoleScreenBufferInfo( hStdout,&csbiInfo );
-            // **************************************************
-
             // display note
-            //SetConsoleTextAttribute( hStdout,FOREGROUND_LIGHTGRAY );
+            //setConsoleTextColor( FOREGROUND_LIGHTGRAY );
             //std::cout << "|";
-            SetConsoleTextAttribute( hStdout,FOREGROUND_LIGHTCYAN );
+            setConsoleTextColor( FOREGROUND_LIGHTCYAN );
 
             if ( note < (MAXIMUM_NOTES + 2) ) std::cout << noteStrings[note];
             else if ( note == KEY_OFF || note == KEY_NOTE_CUT )
@@ -2018,13 +3223,13 @@ void Mixer::updateNotes()
                 std::cout << "!" << std::hex << std::setw( 2 ) << (unsigned)note << std::dec;
             }
             // display instrument
-            SetConsoleTextAttribute( hStdout,FOREGROUND_YELLOW );
+            setConsoleTextColor( FOREGROUND_YELLOW );
             if ( instrument )
                 std::cout << std::dec << std::setw( 2 ) << instrument;
             else std::cout << "  ";
             /*
             // display volume column
-            SetConsoleTextAttribute( hStdout,FOREGROUND_GREEN | FOREGROUND_INTENSITY );
+            setConsoleTextColor( FOREGROUND_GREEN | FOREGROUND_INTENSITY );
             if ( iNote_->effects[0].effect )
                 std::cout << std::hex << std::uppercase
                     << std::setw( 1 ) << iNote_->effects[0].effect
@@ -2033,21 +3238,21 @@ void Mixer::updateNotes()
             */
             // display volume:
             /*
-            SetConsoleTextAttribute( hStdout,FOREGROUND_GREEN | FOREGROUND_INTENSITY );
+            setConsoleTextColor( FOREGROUND_GREEN | FOREGROUND_INTENSITY );
             std::cout << std::hex << std::uppercase
                 << std::setw( 2 ) << channel.volume;
             */
 
             /*
             // effect & argument
-            SetConsoleTextAttribute( hStdout,FOREGROUND_LIGHTGRAY );
+            setConsoleTextColor( FOREGROUND_LIGHTGRAY );
             for ( unsigned fxloop = 1; fxloop < 2; fxloop++ ) {
                 if ( iNote_->effects[fxloop].effect )
                     std::cout
                     << std::hex << std::uppercase
                     << std::setw( 2 ) << (unsigned)iNote_->effects[fxloop].effect;
                 else std::cout << "--";
-                SetConsoleTextAttribute( hStdout,FOREGROUND_BROWN );
+                setConsoleTextColor( FOREGROUND_BROWN );
                 if ( iNote_->effects[fxloop].argument )
                     std::cout
                     << std::setw( 2 ) << ((unsigned)iNote_->effects[fxloop].argument)
@@ -2055,13 +3260,13 @@ void Mixer::updateNotes()
                 else std::cout << "--";
             }
             */
-            SetConsoleTextAttribute( hStdout,FOREGROUND_LIGHTGRAY );
+            setConsoleTextColor( FOREGROUND_LIGHTGRAY );
         }
 #endif
         iNote_++;
     } // end of effect processing
 #ifdef debug_mixer
-    if ( nrChannels_ < 16 )
+    if ( module_->getVerboseMode() && (nrChannels_ < 16) )
         std::cout << "\n";
 #endif
     /*
@@ -2117,7 +3322,8 @@ void Mixer::updateNotes()
     }
     if ( patternRow_ >= pattern_->getnRows() ) {
 #ifdef debug_mixer
-        std::cout << "\n";
+        if ( module_->getVerboseMode() )
+            std::cout << "\n";
         //_getch();
 #endif
         patternRow_ = patternStartRow;
@@ -2156,7 +3362,8 @@ void Mixer::updateNotes()
             patternRow_ = 0;
         iNote_ = pattern_->getRow( patternRow_ );
 #ifdef debug_mixer
-        std::cout
+        if ( module_->getVerboseMode() )
+            std::cout
             << "Playing pattern # "
             << module_->getPatternTable( patternTableIdx_ )
             << ", order # " << patternTableIdx_
@@ -2632,6 +3839,7 @@ void Mixer::updateEffects() {
                                     playSample( channelNr,
                                         channel.pInstrument,
                                         channel.pSample,
+                                        channel.lastNote,
                                         channel.sampleOffset,
                                         FORWARD );
                                 }
@@ -2658,6 +3866,7 @@ void Mixer::updateEffects() {
                                     playSample( channelNr,
                                         channel.pInstrument,
                                         channel.pSample,
+                                        channel.lastNote,
                                         channel.sampleOffset,
                                         FORWARD );
                                     setFrequency( channelNr,
@@ -2762,6 +3971,7 @@ void Mixer::updateEffects() {
                                 channelNr,
                                 channel.pInstrument,
                                 channel.pSample,
+                                channel.lastNote,
                                 channel.sampleOffset,
                                 FORWARD );
 
@@ -2778,8 +3988,46 @@ void Mixer::updateEffects() {
     }
 }
 
+/*
+    Once per tick: the background voices that fade out get quieter by the 
+    fade out speed of their instrument, and stop when they reach zero. A 
+    speed of zero keeps them playing, as in Impulse Tracker.
+*/
+void Mixer::updateFadeOuts()
+{
+    for ( int i = 0; i < nrActiveChannels_; i++ ) {
+        int physicalChannelNr = activeChannels_[i];
+        MixerChannel& mChn = physicalChannels_[physicalChannelNr];
+        if ( !mChn.isActive() || mChn.isDying() || !mChn.isFadingOut() )
+            continue;
+        unsigned fadeOutSpeed = mChn.getInstrumentPtr()->getVolumeFadeOut();
+        unsigned fadeOut = mChn.getFadeOut();
+        if ( fadeOutSpeed == 0 )
+            continue;
+        if ( fadeOut <= fadeOutSpeed ) {
+            fadeOutPhysicalChannel( physicalChannelNr );
+            continue;
+        }
+        float fadeFactor = (float)(fadeOut - fadeOutSpeed) / (float)fadeOut;
+        float leftStartVolume = mChn.getCurrentLeftVolume();
+        float rightStartVolume = mChn.getCurrentRightVolume();
+        mChn.setFadeOut( fadeOut - fadeOutSpeed );
+        mChn.setVolume( 
+            mChn.getLeftVolume() * fadeFactor,
+            mChn.getRightVolume() * fadeFactor );
+        mChn.setVolumeRamp(
+            MXR_VOLUME_RAMP_DOWN,
+            leftStartVolume,
+            rightStartVolume,
+            mChn.getLeftVolume(),
+            mChn.getRightVolume()
+            );
+    }
+}
+
 void Mixer::updateBpm()
 {
+    updateFadeOuts();
     tickNr_++;
     if ( tickNr_ < ticksPerRow_ ) {
         updateEffects();
@@ -2793,6 +4041,17 @@ void Mixer::updateBpm()
     }
 }
 
+/*
+    Sets the length of the tick that is about to be mixed, after the notes 
+    and effects of the tick were processed (they can change the tempo).
+*/
+void Mixer::startTick()
+{
+    double tickLength = (double)mixRate_ * 2.5 / (double)tempo_ + tickFraction_;
+    callBpm_ = (unsigned)tickLength;
+    tickFraction_ = tickLength - (double)callBpm_;
+}
+
 /*
 
 AMIGA calculations:
@@ -2826,19 +4085,14 @@ unsigned Mixer::noteToPeriod( unsigned note,int finetune )
     if ( module_->useLinearFrequencies() ) {
         return (7680 - ((note - 1) << 6) - (finetune >> 1));
     } else {
-        return (unsigned)(
-            pow( 2.0,
-            ((11.0 * 12.0) - ((double)(note - 1) + ((double)finetune / 128.0))) / 12.0
-            )
-            * (1712.0 / 128.0)
-            );
+        return PeriodTable::get().getAmigaPeriod( note,finetune );
     }
 }
 
 unsigned Mixer::periodToFrequency( unsigned period )
 {
     return module_->useLinearFrequencies() ?
-        (unsigned)(8363 * pow( 2,((4608.0 - (double)period) / 768.0) ))
+        PeriodTable::get().getLinearFrequency( period )
         :
         (period ? ((8363 * 1712) / period) : 0);
 }
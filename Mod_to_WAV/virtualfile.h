@@ -6,6 +6,7 @@
 #include <fstream>
 #include <string>
 #include <memory>
+#include <cstring>
 
 #include "assert.h"
 
@@ -66,7 +67,7 @@ template <class P> class MemoryBlock  // not used
 public:
     MemoryBlock( P *source,unsigned nElements ) :
         data_( source ),
-        size_( nElements )
+        nElements_( nElements )
     {
         assert( source != nullptr );
         assert( nElements != 0 );
@@ -232,7 +233,7 @@ public:
     }
     template<class PTR> MemoryBlock<PTR> getPointer( unsigned nElements )
     {
-        unsigned byteSize = nElements * sizeof( *PTR );
+        unsigned byteSize = nElements * sizeof( PTR );
         if ( filePos_ + byteSize <= fileEOF_ ) {
             ioError_ = VIRTFILE_NO_ERROR;
             MemoryBlock<PTR> memoryBlock( (PTR*)filePos_,nElements );
@@ -15,10 +15,12 @@
 This code requires a byte to be 8 bits wide
 #endif
 
+#ifdef _WIN32
 #include <conio.h>
 #include <windows.h>
 #include <mmsystem.h>
 #pragma comment (lib, "winmm.lib") 
+#endif
 #include <iostream>
 #include <fstream>
 #include <bitset>
@@ -26,7 +28,7 @@ This code requires a byte to be 8 bits wide
 #include <vector>
 #include <iterator>
 
-#include "module.h"
+#include "Module.h"
 #include "virtualfile.h"
                        
 
@@ -316,6 +318,7 @@ int Module::loadXmInstrument( VirtualFile& xmFile,int instrumentNr )
 
         // tell the envelope functions we want XM style envelope processing:
         instHdr.volumeEnvelope.setEnvelopeStyle( xmEnvelopeStyle );
+        instHdr.panningEnvelope.setEnvelopeStyle( xmEnvelopeStyle );
 
         // initialize envelope parameters. First the volume envelope:
         unsigned char flags = 0;
@@ -795,7 +798,9 @@ void XmDebugShow::illegalNote( int patternNr,int nRows,int idx,int note )
         << ", row " << (idx / nRows)
         << ", column " << (idx % nRows)
         << ": " << note << "\n";
+#ifdef _WIN32
     _getch();
+#endif
 }
 
 void XmDebugShow::fileHeader( XmHeader& xmHeader )